@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "cat_cache.h"
+
+static double now()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+// keys drawn from a Zipf distribution of exponent 1 by inverting its cumulative weights
+static uint64_t* zipf_keys(size_t n, size_t universe)
+{
+    double* cdf = malloc(universe * sizeof(double));
+    double total = 0;
+    for (size_t i = 0; i < universe; i++) {
+        total += 1.0 / (double)(i + 1);
+        cdf[i] = total;
+    }
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    uint64_t state = 88172645463325252ULL;
+    for (size_t i = 0; i < n; i++) {
+        double u = (double)(xorshift64(&state) >> 11) / 9007199254740992.0 * total;
+        size_t lo = 0, hi = universe - 1;
+        while (lo < hi) {
+            size_t mid = (lo + hi) / 2;
+            if (cdf[mid] < u) lo = mid + 1; else hi = mid;
+        }
+        /* Scatter the ranks so that popular keys do not hash next to each other */
+        keys[i] = lo * 0x9E3779B97F4A7C15ULL;
+    }
+    free(cdf);
+    return keys;
+}
+
+// read-through workload: a miss puts the key, interleaved with one-off scans
+static void bench_policy(const char* name, int policy, const uint64_t* keys, size_t n, size_t capacity)
+{
+    cache_t c = cache(uint64_t, uint64_t, capacity, policy);
+    double start = now();
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v;
+        if (cache_get(c, (void*)&keys[i], &v) != COMPLETE)
+            cache_put(c, (void*)&keys[i], (void*)&keys[i]);
+    }
+    double elapsed = now() - start;
+    double ratio = (double)cache_hits(c) / (double)(cache_hits(c) + cache_misses(c));
+    printf("%-12s %8.2f ns/op %8.2f%% hits %10zu evictions\n",
+           name, elapsed * 1e9 / (double)n, ratio * 100, cache_evictions(c));
+    cache_deinit(c);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)1 << 22;
+    size_t universe = 1 << 20, capacity = 1 << 14;
+    uint64_t* keys = zipf_keys(n, universe);
+    /* Every eighth block of accesses is a scan over keys never seen again */
+    for (size_t i = 0; i < n; i++)
+        if ((i / 4096) % 8 == 7) keys[i] = ~(uint64_t)i;
+    printf("%zu accesses, %zu keys, capacity %zu\n", n, universe, capacity);
+    bench_policy("lru", CACHE_LRU, keys, n, capacity);
+    bench_policy("clock", CACHE_CLOCK, keys, n, capacity);
+    bench_policy("tinylfu", CACHE_TINYLFU, keys, n, capacity);
+    free(keys);
+    return 0;
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "cat_chashmap.h"
+#include "../src/cat_thread.h"
+
+#define MAX_THREADS 64
+#define KEY_RANGE (1 << 20)
+
+static double now()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+typedef struct {
+    chashmap_t cht;
+    hashmap_t ht;
+    cat_mutex_t* lock;
+    size_t ops;
+    uint64_t seed;
+} worker_t;
+
+// 87.5% queries and 12.5% assignments on random keys
+static void sharded_worker(void* arg)
+{
+    worker_t* w = arg;
+    uint64_t state = w->seed;
+    for (size_t i = 0; i < w->ops; i++) {
+        uint64_t r = xorshift64(&state);
+        uint64_t k = r % KEY_RANGE;
+        if (r >> 60 < 2) {
+            chashmap_assign(w->cht, &k, &r);
+        } else {
+            chashmap_query(w->cht, &k, &r);
+        }
+    }
+}
+
+static void global_lock_worker(void* arg)
+{
+    worker_t* w = arg;
+    uint64_t state = w->seed;
+    for (size_t i = 0; i < w->ops; i++) {
+        uint64_t r = xorshift64(&state);
+        uint64_t k = r % KEY_RANGE;
+        cat_mutex_lock(w->lock);
+        if (r >> 60 < 2) {
+            hashmap_assign(w->ht, &k, &r);
+        } else {
+            hashmap_query(w->ht, &k, &r);
+        }
+        cat_mutex_unlock(w->lock);
+    }
+}
+
+// Same mix on a single map whose queries never lock
+static void lockfree_worker(void* arg)
+{
+    worker_t* w = arg;
+    uint64_t state = w->seed;
+    for (size_t i = 0; i < w->ops; i++) {
+        uint64_t r = xorshift64(&state);
+        uint64_t k = r % KEY_RANGE;
+        if (r >> 60 < 2) {
+            hashmap_assign(w->ht, &k, &r);
+        } else {
+            hashmap_query(w->ht, &k, &r);
+        }
+    }
+}
+
+static double run(void (*fn)(void*), worker_t* proto, int nthreads, size_t ops)
+{
+    worker_t workers[MAX_THREADS];
+    cat_thread_t threads[MAX_THREADS];
+    double start = now();
+    for (int i = 0; i < nthreads; i++) {
+        workers[i] = *proto;
+        workers[i].ops = ops / nthreads;
+        workers[i].seed = 88172645463325252ULL + (uint64_t)i * 0x9E3779B97F4A7C15ULL;
+        cat_thread_create(&threads[i], fn, &workers[i]);
+    }
+    for (int i = 0; i < nthreads; i++)
+        cat_thread_join(threads[i]);
+    return now() - start;
+}
+
+int main(int argc, char** argv)
+{
+    size_t ops = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)1 << 23;
+    printf("%zu operations, 87.5%% query / 12.5%% assign over %d keys\n", ops, KEY_RANGE);
+    printf("%-8s %16s %16s %16s\n", "threads", "global Mops/s", "sharded Mops/s", "lockfree Mops/s");
+
+    for (int nthreads = 1; nthreads <= MAX_THREADS; nthreads <<= 1) {
+        cat_mutex_t lock;
+        cat_mutex_init(&lock);
+        worker_t proto = {0};
+        proto.ht = hashmap(uint64_t, uint64_t, KEY_RANGE);
+        proto.lock = &lock;
+        double global = run(global_lock_worker, &proto, nthreads, ops);
+        hashmap_deinit(proto.ht);
+        cat_mutex_destroy(&lock);
+
+        proto.cht = chashmap(uint64_t, uint64_t, KEY_RANGE);
+        double sharded = run(sharded_worker, &proto, nthreads, ops);
+        chashmap_deinit(proto.cht);
+
+        proto.ht = hashmap_flags(uint64_t, uint64_t, KEY_RANGE, HASHMAP_LOCKFREE_READ);
+        double lockfree = run(lockfree_worker, &proto, nthreads, ops);
+        hashmap_deinit(proto.ht);
+
+        printf("%-8d %16.2f %16.2f %16.2f\n", nthreads, (double)ops / global * 1e-6,
+               (double)ops / sharded * 1e-6, (double)ops / lockfree * 1e-6);
+    }
+    return 0;
+}
@@ -0,0 +1,748 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "cat_array.h"
+#include "cat_hashmap.h"
+#include "cat_hashset.h"
+
+static double now()
+{
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t xorshift64(uint64_t* state)
+{
+    uint64_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+static void report(const char* name, double elapsed, size_t ops)
+{
+    printf("%-36s %8.2f ns/op\n", name, elapsed * 1e9 / (double)ops);
+}
+
+// scalar loop against the batch API, keys are random 64-bit integers hashed by cityhash64
+static void bench_batch(const char* engine_name, unsigned flags, size_t n)
+{
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    uint64_t* probes = malloc(n * sizeof(uint64_t));
+    uint64_t* vals = malloc(n * sizeof(uint64_t));
+    stat_t* stats = malloc(n * sizeof(stat_t));
+    uint64_t state = 88172645463325252ULL;
+    char name[64];
+
+    for (size_t i = 0; i < n; i++) {
+        keys[i] = xorshift64(&state);
+        vals[i] = i;
+    }
+    // half of the probes hit, half miss
+    for (size_t i = 0; i < n; i++)
+        probes[i] = i % 2 ? keys[xorshift64(&state) % n] : xorshift64(&state);
+
+    hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, flags);
+    double start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_assign(ht, &keys[i], &vals[i]);
+    snprintf(name, sizeof(name), "%s assign scalar", engine_name);
+    report(name, now() - start, n);
+
+    start = now();
+    size_t found = 0;
+    for (size_t i = 0; i < n; i++)
+        found += hashmap_query(ht, &probes[i], &vals[i]) == COMPLETE;
+    snprintf(name, sizeof(name), "%s query scalar", engine_name);
+    report(name, now() - start, n);
+
+    start = now();
+    size_t batch_found = hashmap_query_batch(ht, probes, vals, n, stats);
+    snprintf(name, sizeof(name), "%s query batch", engine_name);
+    report(name, now() - start, n);
+    if (found != batch_found)
+        printf("mismatch: %zu scalar hits, %zu batch hits\n", found, batch_found);
+    hashmap_deinit(ht);
+
+    ht = hashmap_flags(uint64_t, uint64_t, 8, flags);
+    start = now();
+    hashmap_assign_batch(ht, keys, vals, n, stats);
+    snprintf(name, sizeof(name), "%s assign batch", engine_name);
+    report(name, now() - start, n);
+    hashmap_deinit(ht);
+
+    free(keys);
+    free(probes);
+    free(vals);
+    free(stats);
+}
+
+static uint64_t city(const char* s, size_t len) { return cityhash64(s, len); }
+static uint64_t xxh3(const char* s, size_t len) { return xxh3hash64(s, len, 0); }
+static uint64_t wy(const char* s, size_t len) { return wyhash64(s, len, 0); }
+static uint64_t mix(const char* s, size_t len)
+{
+    if (len == sizeof(uint32_t)) {
+        uint32_t x;
+        memcpy(&x, s, sizeof(x));
+        return intmix64(x, 0);
+    }
+    uint64_t x;
+    memcpy(&x, s, sizeof(x));
+    return intmix64(x, 0);
+}
+
+static const struct {
+    const char* name;
+    uint64_t (*fn)(const char*, size_t);
+    size_t max_len;
+} hash_fns[] = {
+    {"cityhash64", city, SIZE_MAX},
+    {"xxh3hash64", xxh3, SIZE_MAX},
+    {"wyhash64", wy, SIZE_MAX},
+    {"intmix64", mix, sizeof(uint64_t)},
+};
+
+// raw hash throughput over one key distribution, keys are packed back to back
+static void bench_hash_keys(const char* dist,
+                            const char* keys,
+                            const size_t* lens,
+                            size_t n,
+                            size_t key_max)
+{
+    char name[64];
+    for (size_t f = 0; f < sizeof(hash_fns) / sizeof(hash_fns[0]); f++) {
+        if (key_max > hash_fns[f].max_len) continue;
+        uint64_t sink = 0;
+        const char* p = keys;
+        double start = now();
+        for (size_t i = 0; i < n; i++) {
+            sink += hash_fns[f].fn(p, lens[i]);
+            p += lens[i];
+        }
+        snprintf(name, sizeof(name), "%s %s", hash_fns[f].name, dist);
+        report(name, now() - start, n);
+        if (sink == 42) printf("\n");
+    }
+}
+
+static void bench_hash(size_t n)
+{
+    char* keys = malloc(n * 256);
+    size_t* lens = calloc(n, sizeof(size_t));
+    uint64_t state = 88172645463325252ULL;
+
+    for (size_t i = 0; i < n; i++) {
+        uint32_t k = (uint32_t)i;
+        memcpy(keys + i * 4, &k, 4);
+        lens[i] = 4;
+    }
+    bench_hash_keys("seq u32", keys, lens, n, 4);
+
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = xorshift64(&state);
+        memcpy(keys + i * 8, &k, 8);
+        lens[i] = 8;
+    }
+    bench_hash_keys("rand u64", keys, lens, n, 8);
+
+    for (size_t i = 0; i < n * 2; i++) {
+        uint64_t k = xorshift64(&state);
+        memcpy(keys + i * 8, &k, 8);
+        lens[i / 2] = 16;
+    }
+    bench_hash_keys("16B struct", keys, lens, n, 16);
+
+    char* p = keys;
+    for (size_t i = 0; i < n; i++) {
+        lens[i] = 5 + xorshift64(&state) % 20;
+        for (size_t j = 0; j < lens[i]; j++)
+            *p++ = (char)('a' + xorshift64(&state) % 26);
+    }
+    bench_hash_keys("5-24B string", keys, lens, n, 24);
+
+    for (size_t i = 0; i < n * 32; i++) {
+        uint64_t k = xorshift64(&state);
+        memcpy(keys + i * 8, &k, 8);
+    }
+    for (size_t i = 0; i < n; i++)
+        lens[i] = 256;
+    bench_hash_keys("256B blob", keys, lens, n, 256);
+
+    free(keys);
+    free(lens);
+}
+
+// hashmap built with each selectable hash function on sequential integer keys
+static void bench_hash_map(const char* engine_name, unsigned engine, size_t n)
+{
+    static const struct {
+        const char* name;
+        unsigned flags;
+    } hashes[] = {
+        {"city", HASHMAP_HASH_CITY},
+        {"xxh3", HASHMAP_HASH_XXH3},
+        {"wyhash", HASHMAP_HASH_WYHASH},
+        {"int", HASHMAP_HASH_INT},
+    };
+    char name[64];
+
+    for (size_t h = 0; h < sizeof(hashes) / sizeof(hashes[0]); h++) {
+        hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, engine | hashes[h].flags);
+        double start = now();
+        for (uint64_t i = 0; i < n; i++)
+            hashmap_assign(ht, &i, &i);
+        snprintf(name, sizeof(name), "%s %s assign", engine_name, hashes[h].name);
+        report(name, now() - start, n);
+
+        uint64_t v;
+        size_t found = 0;
+        start = now();
+        for (uint64_t i = 0; i < n; i++)
+            found += hashmap_query(ht, &i, &v) == COMPLETE;
+        snprintf(name, sizeof(name), "%s %s query", engine_name, hashes[h].name);
+        report(name, now() - start, n);
+        if (found != n) printf("missing %zu keys\n", n - found);
+        hashmap_deinit(ht);
+    }
+}
+
+// cursor walk over a full hashmap, then over the same capacity after most keys are removed
+static void bench_iter(const char* engine_name, unsigned engine, size_t n)
+{
+    hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, engine);
+    for (uint64_t i = 0; i < n; i++)
+        hashmap_assign(ht, &i, &i);
+    char name[64];
+
+    for (int sparse = 0; sparse < 2; sparse++) {
+        hashmap_iter_t it;
+        void* val;
+        uint64_t sum = 0;
+        size_t visited = 0;
+        double start = now();
+        for (int r = 0; r < 8; r++) {
+            hashmap_iter_init(&it, ht);
+            while (hashmap_iter_next(&it, NULL, &val)) {
+                sum += *(uint64_t*)val;
+                visited++;
+            }
+        }
+        snprintf(name, sizeof(name), "%s iter %s", engine_name, sparse ? "sparse" : "full");
+        report(name, now() - start, visited);
+        if (!sum) printf("empty walk\n");
+
+        // keep one key in 1024, the capacity stays the same
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, NULL, &val)) {
+            if (*(uint64_t*)val % 1024 != 1) hashmap_iter_remove(&it, NULL);
+        }
+    }
+    hashmap_deinit(ht);
+}
+
+// hashmap_copy against a plain memcpy of the keys and values
+static void bench_copy(const char* engine_name, unsigned engine, size_t n)
+{
+    hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, engine);
+    for (uint64_t i = 0; i < n; i++)
+        hashmap_assign(ht, &i, &i);
+    char name[64];
+
+    hashmap_t cp;
+    double start = now();
+    hashmap_copy(&cp, ht);
+    snprintf(name, sizeof(name), "%s copy", engine_name);
+    report(name, now() - start, n);
+    hashmap_deinit(cp);
+    hashmap_deinit(ht);
+
+    uint64_t* src = malloc(n * 2 * sizeof(uint64_t));
+    uint64_t* dst = malloc(n * 2 * sizeof(uint64_t));
+    for (size_t i = 0; i < n * 2; i++)
+        src[i] = i;
+    start = now();
+    memcpy(dst, src, n * 2 * sizeof(uint64_t));
+    report("memcpy of the mappings", now() - start, n);
+    if (dst[n] != n) printf("bad memcpy\n");
+    free(src);
+    free(dst);
+}
+
+// rebuilding a hashmap by insertion against mapping a snapshot of it
+static void bench_snapshot(size_t n)
+{
+    const char* path = "bench_hashmap.snapshot";
+    hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, HASHMAP_SWISS);
+    double start = now();
+    for (uint64_t i = 0; i < n; i++)
+        hashmap_assign(ht, &i, &i);
+    report("rebuild by insertion", now() - start, n);
+    start = now();
+    hashmap_save(ht, path);
+    report("snapshot save", now() - start, n);
+    hashmap_deinit(ht);
+
+    start = now();
+    ht = hashmap_load_mmap(path);
+    double loaded = now() - start;
+    printf("%-36s %8.3f ms\n", "snapshot load", loaded * 1e3);
+    uint64_t v;
+    size_t found = 0;
+    start = now();
+    for (uint64_t i = 0; i < n; i++)
+        found += hashmap_query(ht, &i, &v) == COMPLETE;
+    report("snapshot query", now() - start, n);
+    if (found != n) printf("missing %zu keys\n", n - found);
+    hashmap_deinit(ht);
+    remove(path);
+}
+
+// one assign per key against a single bulk build of the same arrays
+static void bench_from_arrays(const char* name, unsigned flags, size_t n)
+{
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    uint64_t state = 88172645463325252ULL;
+    for (size_t i = 0; i < n; i++)
+        keys[i] = xorshift64(&state);
+    char label[64];
+
+    double start = now();
+    hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, flags);
+    for (size_t i = 0; i < n; i++)
+        hashmap_assign(ht, &keys[i], &keys[i]);
+    snprintf(label, sizeof(label), "%s assign loop", name);
+    report(label, now() - start, n);
+    hashmap_deinit(ht);
+
+    start = now();
+    ht = hashmap_from_arrays(uint64_t, uint64_t, keys, keys, n, HASHMAP_LAST_WINS, flags);
+    snprintf(label, sizeof(label), "%s from_arrays", name);
+    report(label, now() - start, n);
+    hashmap_deinit(ht);
+    free(keys);
+}
+
+static size_t live_bytes;
+
+// allocator that keeps track of the bytes currently allocated
+static void* counting_alloc(size_t size)
+{
+    size_t* p = malloc(size + 16);
+    if (!p) return NULL;
+    *p = size;
+    live_bytes += size;
+    return (char*)p + 16;
+}
+
+static void counting_free(void* ptr)
+{
+    size_t* p = (size_t*)((char*)ptr - 16);
+    live_bytes -= *p;
+    free(p);
+}
+
+typedef struct { char str[256]; } padded_key;
+
+// short string keys padded to fixed 256 byte keys against the key arena
+static void bench_string_keys(size_t n)
+{
+    char (*words)[24] = malloc(n * sizeof(*words));
+    hashmap_str_t* keys = malloc(n * sizeof(hashmap_str_t));
+    uint64_t state = 88172645463325252ULL;
+    for (size_t i = 0; i < n; i++) {
+        keys[i].len = (size_t)snprintf(words[i], sizeof(words[i]), "user:%llu",
+                                       (unsigned long long)(xorshift64(&state) % 100000000));
+        keys[i].str = words[i];
+    }
+
+    hashmap_t ht = hashmap_custom(padded_key, uint64_t, 8, NULL, NULL,
+                                  counting_alloc, counting_free);
+    padded_key pk;
+    memset(&pk, 0, sizeof(pk));
+    double start = now();
+    for (size_t i = 0; i < n; i++) {
+        memcpy(pk.str, keys[i].str, keys[i].len + 1);
+        hashmap_assign(ht, &pk, &i);
+    }
+    report("padded 256B key assign", now() - start, n);
+    start = now();
+    uint64_t v;
+    for (size_t i = 0; i < n; i++) {
+        memcpy(pk.str, keys[i].str, keys[i].len + 1);
+        hashmap_query(ht, &pk, &v);
+    }
+    report("padded 256B key query", now() - start, n);
+    printf("%-36s %8.2f bytes/key\n", "padded 256B key memory", (double)live_bytes / (double)n);
+    hashmap_deinit(ht);
+
+    ht = hashmap_custom_flags(hashmap_str_t, uint64_t, 8, HASHMAP_STRING_KEYS,
+                              NULL, NULL, counting_alloc, counting_free);
+    start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_assign(ht, &keys[i], &i);
+    report("string key assign", now() - start, n);
+    start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_query(ht, &keys[i], &v);
+    report("string key query", now() - start, n);
+    printf("%-36s %8.2f bytes/key\n", "string key memory", (double)live_bytes / (double)n);
+    hashmap_deinit(ht);
+
+    free(words);
+    free(keys);
+}
+
+// bytes per mapping of 8 byte keys and values in each engine
+static void bench_memory(const char* engine_name, unsigned engine, size_t n)
+{
+    hashmap_t ht = hashmap_custom_flags(uint64_t, uint64_t, 8, engine, NULL, NULL,
+                                        counting_alloc, counting_free);
+    for (uint64_t i = 0; i < n; i++)
+        hashmap_assign(ht, &i, &i);
+    char name[64];
+    snprintf(name, sizeof(name), "%s memory", engine_name);
+    printf("%-36s %8.2f bytes/key\n", name, (double)live_bytes / (double)n);
+    hashmap_deinit(ht);
+}
+
+// hashmap_freeze against the swiss engine it is frozen from
+static void bench_freeze(size_t n)
+{
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+    uint64_t* keys = malloc(2 * n * sizeof(uint64_t));
+    for (size_t i = 0; i < 2 * n; i++)
+        keys[i] = xorshift64(&state);
+    hashmap_t ht = hashmap_custom_flags(uint64_t, uint64_t, 8, HASHMAP_SWISS, NULL, NULL,
+                                        counting_alloc, counting_free);
+    for (size_t i = 0; i < n; i++)
+        hashmap_assign(ht, &keys[i], &keys[i]);
+    printf("%-36s %8.2f bytes/key\n", "unfrozen swiss memory", (double)live_bytes / (double)n);
+
+    for (int frozen = 0; frozen < 2; frozen++) {
+        const char* name = frozen ? "frozen" : "swiss";
+        char label[64];
+        uint64_t v;
+        size_t found = 0;
+        double start = now();
+        for (size_t i = 0; i < n; i++)
+            found += hashmap_query(ht, &keys[i], &v) == COMPLETE;
+        snprintf(label, sizeof(label), "%s query hit", name);
+        report(label, now() - start, n);
+        start = now();
+        for (size_t i = n; i < 2 * n; i++)
+            found += hashmap_query(ht, &keys[i], &v) == COMPLETE;
+        snprintf(label, sizeof(label), "%s query miss", name);
+        report(label, now() - start, n);
+        if (found != n) printf("%s found %zu of %zu keys\n", name, found, n);
+
+        if (!frozen) {
+            start = now();
+            hashmap_freeze(ht);
+            report("freeze", now() - start, n);
+            printf("%-36s %8.2f bytes/key\n", "frozen memory", (double)live_bytes / (double)n);
+        }
+    }
+    hashmap_deinit(ht);
+    free(keys);
+}
+
+// Queries of which 19 in 20 miss, without and with the membership filter
+static void bench_filter(const char* engine_name, unsigned engine, size_t n)
+{
+    uint64_t state = 0x2545F4914F6CDD1DULL;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = xorshift64(&state);
+    size_t live = n / 20 ? n / 20 : 1;
+
+    for (int filtered = 0; filtered < 2; filtered++) {
+        unsigned flags = engine | (filtered ? HASHMAP_FILTER : 0);
+        hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, flags);
+        for (size_t i = 0; i < n; i += n / live)
+            hashmap_assign(ht, &keys[i], &keys[i]);
+        char label[64];
+        uint64_t v;
+        size_t found = 0;
+        double start = now();
+        for (size_t i = 0; i < n; i++)
+            found += hashmap_query(ht, &keys[i], &v) == COMPLETE;
+        snprintf(label, sizeof(label), "%s %s query 95%% miss", engine_name,
+                 filtered ? "filtered" : "unfiltered");
+        report(label, now() - start, n);
+        if (found != hashmap_size(ht))
+            printf("%s found %zu of %zu keys\n", label, found, hashmap_size(ht));
+        if (filtered)
+            printf("%-36s %8.4f%%\n", "filter false positive rate", 100 * hashmap_filter_fpr(ht));
+        hashmap_deinit(ht);
+    }
+    free(keys);
+}
+
+// Multimap fan-out against a hashmap of array_t handles, 8 values per key
+static void bench_multi(size_t n)
+{
+    uint64_t state = 0x7FB5D329728EA185ULL;
+    size_t keys_n = n / 8 ? n / 8 : 1;
+    uint64_t* keys = malloc(keys_n * sizeof(uint64_t));
+    for (size_t i = 0; i < keys_n; i++)
+        keys[i] = xorshift64(&state);
+    uint64_t sum = 0;
+
+    hashmap_t handles = hashmap(uint64_t, array_t, 8);
+    double start = now();
+    for (size_t i = 0; i < n; i++) {
+        int created;
+        array_t* arr = hashmap_emplace(handles, &keys[i % keys_n], &created);
+        if (created) *arr = array(uint64_t, 1);
+        array_push_back(*arr, &i);
+    }
+    report("array_t values append", now() - start, n);
+    start = now();
+    for (size_t i = 0; i < keys_n; i++) {
+        array_t arr = *(array_t*)hashmap_find(handles, &keys[i]);
+        const uint64_t* vals = array_data(arr);
+        for (size_t j = 0; j < array_size(arr); j++)
+            sum += vals[j];
+    }
+    report("array_t values fan-out", now() - start, n);
+    hashmap_iter_t it;
+    void* val;
+    hashmap_iter_init(&it, handles);
+    while (hashmap_iter_next(&it, NULL, &val))
+        array_deinit(*(array_t*)val);
+    hashmap_deinit(handles);
+
+    hashmap_t multi = hashmap_multi(uint64_t, uint64_t, 8);
+    start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_multi_append(multi, &keys[i % keys_n], &i);
+    report("multimap append", now() - start, n);
+    start = now();
+    for (size_t i = 0; i < keys_n; i++) {
+        size_t count;
+        const uint64_t* vals = hashmap_multi_values(multi, &keys[i], &count);
+        for (size_t j = 0; j < count; j++)
+            sum -= vals[j];
+    }
+    report("multimap fan-out", now() - start, n);
+    if (sum) printf("multimap values differ from the array_t ones\n");
+    hashmap_deinit(multi);
+    free(keys);
+}
+
+// hashmap with a dummy char value used as a set against hashset_t
+static void bench_set(const char* name, unsigned flags, size_t n)
+{
+    uint64_t state = 88172645463325252ULL;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = xorshift64(&state);
+    char label[64];
+    char none = 0;
+
+    live_bytes = 0;
+    hashmap_t ht = hashmap_custom_flags(uint64_t, char, 8, flags, NULL, NULL,
+                                        counting_alloc, counting_free);
+    double start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_assign(ht, &keys[i], &none);
+    snprintf(label, sizeof(label), "%s map as set insert", name);
+    report(label, now() - start, n);
+    snprintf(label, sizeof(label), "%s map as set memory", name);
+    printf("%-36s %8.2f bytes/key\n", label, (double)live_bytes / (double)n);
+    hashmap_deinit(ht);
+
+    live_bytes = 0;
+    hashset_t set = hashset_custom_flags(uint64_t, 8, flags, NULL, NULL,
+                                         counting_alloc, counting_free);
+    start = now();
+    for (size_t i = 0; i < n; i++)
+        hashset_add(set, &keys[i]);
+    snprintf(label, sizeof(label), "%s hashset insert", name);
+    report(label, now() - start, n);
+    snprintf(label, sizeof(label), "%s hashset memory", name);
+    printf("%-36s %8.2f bytes/key\n", label, (double)live_bytes / (double)n);
+    hashset_deinit(set);
+    free(keys);
+}
+
+// hits and misses at fixed loads, the capacity is reserved up front so only engines
+// with a lower growth threshold resize; probe counts need a CAT_HASHMAP_STATS build
+static void bench_load(const char* engine_name, unsigned engine, size_t n)
+{
+    static const double loads[] = {0.5, 0.75, 0.9};
+    uint64_t state = 2463534242ULL;
+    size_t capacity = 1;
+    while (capacity < n) capacity <<= 1;
+    uint64_t* keys = malloc(2 * capacity * sizeof(uint64_t));
+    for (size_t i = 0; i < 2 * capacity; i++)
+        keys[i] = xorshift64(&state);
+    char label[64];
+
+    for (size_t l = 0; l < sizeof(loads) / sizeof(loads[0]); l++) {
+        size_t count = (size_t)(capacity * loads[l]);
+        hashmap_t ht = hashmap_flags(uint64_t, uint64_t, 8, engine);
+        hashmap_reserve(ht, capacity);
+        for (size_t i = 0; i < count; i++)
+            hashmap_assign(ht, &keys[i], &keys[i]);
+        hashmap_stats_reset(ht);
+
+        uint64_t v;
+        size_t found = 0;
+        double start = now();
+        for (size_t i = 0; i < count; i++)
+            found += hashmap_query(ht, &keys[i], &v) == COMPLETE;
+        snprintf(label, sizeof(label), "%s load %.2f hit", engine_name, hashmap_load(ht));
+        report(label, now() - start, count);
+        if (found != count) printf("missing %zu keys\n", count - found);
+
+        hashmap_stats_t st;
+        int stats = hashmap_stats(ht, &st) == COMPLETE;
+        size_t hit_probes = stats ? st.probes[HASHMAP_OP_QUERY] : 0;
+
+        start = now();
+        for (size_t i = capacity; i < capacity + count; i++)
+            found += hashmap_query(ht, &keys[i], &v) == COMPLETE;
+        snprintf(label, sizeof(label), "%s load %.2f miss", engine_name, hashmap_load(ht));
+        report(label, now() - start, count);
+
+        if (stats && hashmap_stats(ht, &st) == COMPLETE) {
+            size_t max = 0;
+            for (size_t i = 0; i < HASHMAP_STATS_HISTOGRAM; i++)
+                if (st.histogram[i]) max = i;
+            printf("%-36s %8.2f hit %8.2f miss, longest %zu%s\n", "  probes/op",
+                   (double)hit_probes / (double)count,
+                   (double)(st.probes[HASHMAP_OP_QUERY] - hit_probes) / (double)count,
+                   max, max == HASHMAP_STATS_HISTOGRAM - 1 ? "+" : "");
+        }
+        hashmap_deinit(ht);
+    }
+    free(keys);
+}
+
+// doubling a full chained hashmap and bulk loading it with 1, 2, 4 and 8 threads
+static void bench_parallel(size_t n)
+{
+    static const size_t threads[] = {1, 2, 4, 8};
+    uint64_t state = 1181783497276652981ULL;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = xorshift64(&state);
+    char label[64];
+
+    for (size_t t = 0; t < sizeof(threads) / sizeof(threads[0]); t++) {
+        hashmap_t ht = hashmap(uint64_t, uint64_t, n);
+        hashmap_set_threads(ht, threads[t]);
+        for (size_t i = 0; i < n; i++)
+            hashmap_assign(ht, &keys[i], &keys[i]);
+        double start = now();
+        hashmap_reserve(ht, hashmap_capacity(ht) * 2);
+        snprintf(label, sizeof(label), "resize %zu threads", threads[t]);
+        report(label, now() - start, n);
+        hashmap_deinit(ht);
+
+        start = now();
+        ht = hashmap_from_arrays_parallel(uint64_t, uint64_t, keys, keys, n,
+                                          HASHMAP_LAST_WINS, HASHMAP_CHAINED, threads[t]);
+        snprintf(label, sizeof(label), "from_arrays %zu threads", threads[t]);
+        report(label, now() - start, n);
+        hashmap_deinit(ht);
+    }
+    free(keys);
+}
+
+static void add_u64(void* acc, const void* val)
+{
+    *(uint64_t*)acc += *(const uint64_t*)val;
+}
+
+// group-by sum over uniformly random groups: query then assign, a single
+// aggregate call, and the same split over partial maps merged at the end
+static void bench_aggregate(size_t n)
+{
+    size_t groups = n / 16 ? n / 16 : 1;
+    uint64_t state = 7640891576956012809ULL;
+    uint64_t* keys = malloc(n * sizeof(uint64_t));
+    for (size_t i = 0; i < n; i++)
+        keys[i] = xorshift64(&state) % groups;
+    uint64_t one = 1;
+
+    hashmap_t ht = hashmap(uint64_t, uint64_t, 8);
+    double start = now();
+    for (size_t i = 0; i < n; i++) {
+        uint64_t v = 0;
+        hashmap_query(ht, &keys[i], &v);
+        v++;
+        hashmap_assign(ht, &keys[i], &v);
+    }
+    report("group-by query+assign", now() - start, n);
+    hashmap_deinit(ht);
+
+    ht = hashmap(uint64_t, uint64_t, 8);
+    start = now();
+    for (size_t i = 0; i < n; i++)
+        hashmap_aggregate(ht, &keys[i], &one, add_u64);
+    report("group-by aggregate", now() - start, n);
+    hashmap_deinit(ht);
+
+    enum { PARTS = 4 };
+    hashmap_t partials[PARTS];
+    ht = hashmap(uint64_t, uint64_t, 8);
+    hashmap_set_threads(ht, PARTS);
+    hashmap_partials(ht, partials, PARTS);
+    start = now();
+    for (size_t p = 0; p < PARTS; p++)
+        for (size_t i = p * n / PARTS; i < (p + 1) * n / PARTS; i++)
+            hashmap_aggregate(partials[p], &keys[i], &one, add_u64);
+    double merge = now();
+    hashmap_merge(ht, partials, PARTS, add_u64);
+    report("group-by 4 partials", now() - start, n);
+    report("  of which merge", now() - merge, n);
+    hashmap_deinit(ht);
+    free(keys);
+}
+
+int main(int argc, char** argv)
+{
+    size_t n = argc > 1 ? (size_t)strtoull(argv[1], NULL, 10) : (size_t)1 << 21;
+    printf("%zu keys\n", n);
+
+    bench_hash(n);
+    bench_hash_map("chained", HASHMAP_CHAINED, n);
+    bench_hash_map("swiss", HASHMAP_SWISS, n);
+    bench_hash_map("robin", HASHMAP_ROBIN, n);
+    bench_hash_map("ordered", HASHMAP_ORDERED, n);
+    bench_load("chained", HASHMAP_CHAINED, n);
+    bench_load("swiss", HASHMAP_SWISS, n);
+    bench_load("robin", HASHMAP_ROBIN, n);
+    bench_string_keys(n);
+    bench_memory("chained", HASHMAP_CHAINED, n);
+    bench_memory("swiss", HASHMAP_SWISS, n);
+    bench_memory("robin", HASHMAP_ROBIN, n);
+    bench_memory("ordered", HASHMAP_ORDERED, n);
+    bench_set("chained", HASHMAP_CHAINED, n);
+    bench_set("swiss", HASHMAP_SWISS, n);
+    bench_iter("chained", HASHMAP_CHAINED, n);
+    bench_iter("swiss", HASHMAP_SWISS, n);
+    bench_iter("ordered", HASHMAP_ORDERED, n);
+    bench_copy("chained", HASHMAP_CHAINED, n);
+    bench_copy("swiss", HASHMAP_SWISS, n);
+    bench_copy("ordered", HASHMAP_ORDERED, n);
+    bench_snapshot(n);
+    bench_freeze(n);
+    bench_filter("chained", HASHMAP_CHAINED, n);
+    bench_filter("swiss", HASHMAP_SWISS, n);
+    bench_multi(n);
+    bench_from_arrays("chained", HASHMAP_CHAINED, n);
+    bench_from_arrays("swiss", HASHMAP_SWISS, n);
+    bench_batch("chained", HASHMAP_CHAINED | HASHMAP_HASH_CITY, n);
+    bench_batch("swiss", HASHMAP_SWISS | HASHMAP_HASH_CITY, n);
+    bench_parallel(n);
+    bench_aggregate(n);
+    return 0;
+}
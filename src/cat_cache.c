@@ -0,0 +1,604 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "cat_cache.h"
+#include "cat_hashmap_internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_SKETCH_ROWS 4
+#define CACHE_COUNTER_MAX 15
+#define CACHE_SAMPLE_FACTOR 10
+#define CACHE_WINDOW_PERCENT 1
+#define CACHE_PROTECTED_PERCENT 80
+
+/* Lists of W-TinyLFU, LRU and CLOCK keep every node in the first one */
+enum {
+    SEG_WINDOW,
+    SEG_PROBATION,
+    SEG_PROTECTED,
+    SEG_COUNT,
+};
+
+/* Recency links stored at the front of every value of the map, entries of
+ * the chained engine never move and the map is sized never to resize, so
+ * the links stay valid for as long as the mapping exists */
+typedef struct cache_node_s {
+    struct cache_node_s        *prev;
+    struct cache_node_s        *next;
+    uint64_t                    hash;
+    unsigned char               segment;
+    unsigned char               referenced;
+} cache_node_s, *cache_node_t;
+
+/* The value of a mapping follows its node at the strictest alignment,
+ * map values are padded to a multiple of 8 so nodes are never misaligned */
+#define CACHE_NODE_SIZE ((sizeof(cache_node_s) + 15) & ~(size_t)15)
+#define CACHE_SLOT_SIZE(elem_size) ((CACHE_NODE_SIZE + (elem_size) + 7) & ~(size_t)7)
+#define node_val(node) ((char*)(node) + CACHE_NODE_SIZE)
+
+typedef struct cache_s {
+    hashmap_t                   map;
+    cache_node_s                lists[SEG_COUNT];
+    size_t                      counts[SEG_COUNT];
+    size_t                      limits[SEG_COUNT];
+    cache_node_t                hand;
+    uint8_t                    *sketch;
+    size_t                      sketch_mask;
+    size_t                      additions;
+    size_t                      sample;
+    size_t                      capacity;
+    size_t                      elem_size;
+    size_t                      hits;
+    size_t                      misses;
+    size_t                      evictions;
+    int                         policy;
+
+    void                      (*evict_fn)(void*, void*);
+    void                      (*free_fn)(void*);
+} cache_s;
+
+/* Odd multipliers spreading a hash over the rows of the sketch */
+static const uint64_t sketch_seeds[CACHE_SKETCH_ROWS] = {
+    0x9E3779B97F4A7C15ULL, 0xC2B2AE3D27D4EB4FULL, 0x165667B19E3779F9ULL, 0xD6E8FEB86659FD93ULL,
+};
+
+static void lists_reset(cache_t cache);
+static void node_link(cache_t cache, int segment, cache_node_t at, cache_node_t node);
+static void node_unlink(cache_t cache, cache_node_t node);
+static cache_node_t node_lru(cache_t cache, int segment);
+static void node_touch(cache_t cache, cache_node_t node);
+static void node_admit(cache_t cache, cache_node_t node);
+static void cache_evict(cache_t cache);
+static void evict_node(cache_t cache, cache_node_t node);
+static cache_node_t clock_sweep(cache_t cache);
+static size_t sketch_index(cache_t cache, uint64_t hash, int row);
+static void sketch_add(cache_t cache, uint64_t hash);
+static unsigned sketch_estimate(cache_t cache, uint64_t hash);
+
+/**
+ * Get the number of mappings in the cache
+ * 
+ * @param cache Cache
+ * @return Size of the cache
+ */
+size_t cache_size(cache_t cache)
+{
+    return hashmap_size(cache->map);
+}
+
+/**
+ * Get the maximum number of mappings the cache holds
+ * 
+ * @param cache Cache
+ * @return Capacity of the cache
+ */
+size_t cache_capacity(cache_t cache)
+{
+    return cache->capacity;
+}
+
+/**
+ * Get the number of cache_get calls that found their key
+ * 
+ * @param cache Cache
+ * @return Number of hits
+ */
+size_t cache_hits(cache_t cache)
+{
+    return cache->hits;
+}
+
+/**
+ * Get the number of cache_get calls that missed their key
+ * 
+ * @param cache Cache
+ * @return Number of misses
+ */
+size_t cache_misses(cache_t cache)
+{
+    return cache->misses;
+}
+
+/**
+ * Get the number of mappings evicted to make room for others
+ * 
+ * @param cache Cache
+ * @return Number of evictions
+ */
+size_t cache_evictions(cache_t cache)
+{
+    return cache->evictions;
+}
+
+/**
+ * Check if a key is in the cache without counting as an access
+ * 
+ * @param cache Cache
+ * @param key Key to check
+ * @return 1 if the key is in the cache, 0 otherwise
+ */
+int cache_contains(cache_t cache, void* key)
+{
+    return key && hashmap_contains_key(cache->map, key);
+}
+
+/**
+ * Initialize a cache
+ * 
+ * @param capacity Maximum number of mappings, at least 1
+ * @param key_len Length of the key
+ * @param elem_size Size of each element in the cache
+ * @param policy CACHE_LRU, CACHE_CLOCK or CACHE_TINYLFU
+ * @param flags HASHMAP_CHAINED, optionally with a HASHMAP_HASH_* hash function
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized cache on success, NULL on failure
+ */
+cache_t _cache_init(size_t capacity,
+                    size_t key_len,
+                    size_t elem_size,
+                    int policy,
+                    unsigned flags,
+                    uint64_t (*hash_fn)(const char*),
+                    int (*cmp_fn)(const void*, const void*),
+                    void* (*alloc_fn)(size_t),
+                    void (*free_fn)(void*))
+{
+    if (capacity == 0 || capacity > SIZE_MAX / 4 || policy < CACHE_LRU || policy > CACHE_TINYLFU)
+        return NULL;
+    /* Nodes must not move and their hashes must not change */
+    if (flags & ~(unsigned)HASHMAP_HASH_MASK)
+        return NULL;
+    if (elem_size > SIZE_MAX - CACHE_NODE_SIZE - 8)
+        return NULL;
+
+    cache_t cache = (cache_t)malloc(sizeof(cache_s));
+    if (!cache) return NULL;
+
+    /* Room for every mapping below the load threshold, so the map never resizes */
+    cache->map = _hashmap_init(capacity + capacity / 3 + 1,
+                               key_len,
+                               CACHE_SLOT_SIZE(elem_size),
+                               flags,
+                               hash_fn,
+                               cmp_fn,
+                               alloc_fn,
+                               free_fn);
+    if (!cache->map) {
+        free(cache);
+        return NULL;
+    }
+
+    cache->sketch = NULL;
+    cache->sketch_mask = 0;
+    if (policy == CACHE_TINYLFU) {
+        size_t width = 16;
+        while (width < capacity) width <<= 1;
+        void* (*alloc)(size_t) = alloc_fn ? alloc_fn : malloc;
+        cache->sketch = alloc(width * CACHE_SKETCH_ROWS);
+        if (!cache->sketch) {
+            hashmap_deinit(cache->map);
+            free(cache);
+            return NULL;
+        }
+        memset(cache->sketch, 0, width * CACHE_SKETCH_ROWS);
+        cache->sketch_mask = width - 1;
+    }
+
+    /* The window takes a small share, the rest is split between the
+     * probation and protected segments */
+    size_t window = capacity * CACHE_WINDOW_PERCENT / 100;
+    if (window == 0) window = 1;
+    cache->limits[SEG_WINDOW] = policy == CACHE_TINYLFU ? window : capacity;
+    cache->limits[SEG_PROTECTED] = (capacity - window) * CACHE_PROTECTED_PERCENT / 100;
+    cache->limits[SEG_PROBATION] = capacity - window - cache->limits[SEG_PROTECTED];
+
+    cache->additions = 0;
+    cache->sample = capacity * CACHE_SAMPLE_FACTOR;
+    cache->capacity = capacity;
+    cache->elem_size = elem_size;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+    cache->policy = policy;
+    cache->evict_fn = NULL;
+    cache->free_fn = free_fn;
+    lists_reset(cache);
+    return cache;
+}
+
+/**
+ * Set the function called with the key and value of every mapping
+ * evicted to make room, before it is removed
+ * 
+ * @param cache Cache
+ * @param evict_fn Eviction callback, NULL for none
+ */
+void cache_set_evict_fn(cache_t cache, void (*evict_fn)(void*, void*))
+{
+    cache->evict_fn = evict_fn;
+}
+
+/**
+ * Insert or update a mapping, evicting one by the policy of the cache
+ * if it is full
+ * 
+ * @param cache Cache
+ * @param key Key to insert, not NULL
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t cache_put(cache_t cache, void* key, void* val)
+{
+    if (!key) return ERR_INVALID_OPERATION;
+    uint64_t hash = _hashmap_hash(cache->map, key);
+    if (cache->sketch) sketch_add(cache, hash);
+
+    cache_node_t node = _hashmap_find_hashed(cache->map, key, hash);
+    if (node) {
+        memcpy(node_val(node), val, cache->elem_size);
+        node_touch(cache, node);
+        return COMPLETE;
+    }
+
+    if (hashmap_size(cache->map) >= cache->capacity)
+        cache_evict(cache);
+    int created;
+    node = _hashmap_emplace_hashed(cache->map, key, hash, &created);
+    if (!node) return ERR_MEMORY_ALLOCATION;
+    node->hash = hash;
+    node->referenced = 0;
+    memcpy(node_val(node), val, cache->elem_size);
+    node_admit(cache, node);
+    return COMPLETE;
+}
+
+/**
+ * Query a mapping, counted as a hit or a miss and as an access by the policy
+ * 
+ * @param cache Cache
+ * @param key Key to query
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on a hit, ERR_INVALID_OPERATION on a miss
+ */
+stat_t cache_get(cache_t cache, void* key, void* ret_val)
+{
+    if (!key) return ERR_INVALID_OPERATION;
+    uint64_t hash = _hashmap_hash(cache->map, key);
+    if (cache->sketch) sketch_add(cache, hash);
+
+    cache_node_t node = _hashmap_find_hashed(cache->map, key, hash);
+    if (!node) {
+        cache->misses++;
+        return ERR_INVALID_OPERATION;
+    }
+    cache->hits++;
+    node_touch(cache, node);
+    memcpy(ret_val, node_val(node), cache->elem_size);
+    return COMPLETE;
+}
+
+/**
+ * Remove a mapping, the eviction callback is not called
+ * 
+ * @param cache Cache
+ * @param key Key to remove
+ * @param ret_val Pointer to the value to return, can be NULL
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if the key is not in the cache
+ */
+stat_t cache_remove(cache_t cache, void* key, void* ret_val)
+{
+    if (!key) return ERR_INVALID_OPERATION;
+    uint64_t hash = _hashmap_hash(cache->map, key);
+    cache_node_t node = _hashmap_find_hashed(cache->map, key, hash);
+    if (!node) return ERR_INVALID_OPERATION;
+    if (ret_val) memcpy(ret_val, node_val(node), cache->elem_size);
+    node_unlink(cache, node);
+    return _hashmap_remove_hashed(cache->map, key, hash, NULL);
+}
+
+/**
+ * Remove every mapping and forget the access history
+ * 
+ * @param cache Cache
+ */
+void cache_clear(cache_t cache)
+{
+    hashmap_clear(cache->map);
+    lists_reset(cache);
+    if (cache->sketch)
+        memset(cache->sketch, 0, (cache->sketch_mask + 1) * CACHE_SKETCH_ROWS);
+    cache->additions = 0;
+}
+
+/**
+ * Deinitialize the cache
+ * 
+ * @param cache Cache
+ */
+void cache_deinit(cache_t cache)
+{
+    hashmap_deinit(cache->map);
+    if (cache->sketch) {
+        if (cache->free_fn) {
+            cache->free_fn(cache->sketch);
+        } else {
+            free(cache->sketch);
+        }
+    }
+    free(cache);
+}
+
+/**
+ * Empty every list of the cache
+ * 
+ * @param cache Cache
+ */
+static void lists_reset(cache_t cache)
+{
+    for (int i = 0; i < SEG_COUNT; i++) {
+        cache->lists[i].prev = &cache->lists[i];
+        cache->lists[i].next = &cache->lists[i];
+        cache->counts[i] = 0;
+    }
+    cache->hand = &cache->lists[SEG_WINDOW];
+}
+
+/**
+ * Link a node into a list in front of another node of it
+ * 
+ * @param cache Cache
+ * @param segment List to link into
+ * @param at Node to link in front of, the list head for the least recent end
+ * @param node Node to link
+ */
+static void node_link(cache_t cache, int segment, cache_node_t at, cache_node_t node)
+{
+    node->prev = at->prev;
+    node->next = at;
+    at->prev->next = node;
+    at->prev = node;
+    node->segment = (unsigned char)segment;
+    cache->counts[segment]++;
+}
+
+/**
+ * Unlink a node from its list
+ * 
+ * @param cache Cache
+ * @param node Node to unlink
+ */
+static void node_unlink(cache_t cache, cache_node_t node)
+{
+    if (cache->hand == node) cache->hand = node->next;
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    cache->counts[node->segment]--;
+}
+
+/**
+ * Get the least recently used node of a list, most recent nodes are
+ * linked right after the head
+ * 
+ * @param cache Cache
+ * @param segment List
+ * @return Least recently used node, NULL if the list is empty
+ */
+static cache_node_t node_lru(cache_t cache, int segment)
+{
+    cache_node_t head = &cache->lists[segment];
+    return head->prev == head ? NULL : head->prev;
+}
+
+/**
+ * Record an access to a mapping of the cache
+ * 
+ * @param cache Cache
+ * @param node Node of the mapping
+ */
+static void node_touch(cache_t cache, cache_node_t node)
+{
+    if (cache->policy == CACHE_CLOCK) {
+        node->referenced = 1;
+        return;
+    }
+    int segment = node->segment;
+    /* A second access in probation earns the protected segment, which
+     * hands its least recent node back to probation when it overflows */
+    if (segment == SEG_PROBATION) segment = SEG_PROTECTED;
+    node_unlink(cache, node);
+    node_link(cache, segment, cache->lists[segment].next, node);
+    if (cache->counts[SEG_PROTECTED] > cache->limits[SEG_PROTECTED]) {
+        cache_node_t demoted = node_lru(cache, SEG_PROTECTED);
+        node_unlink(cache, demoted);
+        node_link(cache, SEG_PROBATION, cache->lists[SEG_PROBATION].next, demoted);
+    }
+}
+
+/**
+ * Link a new mapping into the lists of the cache
+ * 
+ * @param cache Cache
+ * @param node Node of the mapping
+ */
+static void node_admit(cache_t cache, cache_node_t node)
+{
+    if (cache->policy == CACHE_CLOCK) {
+        /* Behind the hand, so it is the last one the sweep reaches */
+        node_link(cache, SEG_WINDOW, cache->hand, node);
+        return;
+    }
+    node_link(cache, SEG_WINDOW, cache->lists[SEG_WINDOW].next, node);
+    if (cache->counts[SEG_WINDOW] > cache->limits[SEG_WINDOW]) {
+        cache_node_t moved = node_lru(cache, SEG_WINDOW);
+        node_unlink(cache, moved);
+        node_link(cache, SEG_PROBATION, cache->lists[SEG_PROBATION].next, moved);
+    }
+}
+
+/**
+ * Evict one mapping chosen by the policy of the cache
+ * 
+ * @param cache Cache
+ */
+static void cache_evict(cache_t cache)
+{
+    if (cache->policy == CACHE_LRU) {
+        evict_node(cache, node_lru(cache, SEG_WINDOW));
+        return;
+    }
+    if (cache->policy == CACHE_CLOCK) {
+        evict_node(cache, clock_sweep(cache));
+        return;
+    }
+
+    /* The least recent node of a full window competes with the victim of
+     * the main segments, and only stays if it is accessed more often */
+    cache_node_t candidate = cache->counts[SEG_WINDOW] >= cache->limits[SEG_WINDOW] ?
+                             node_lru(cache, SEG_WINDOW) : NULL;
+    cache_node_t victim = node_lru(cache, SEG_PROBATION);
+    if (!victim) victim = node_lru(cache, SEG_PROTECTED);
+    if (!victim) {
+        evict_node(cache, node_lru(cache, SEG_WINDOW));
+    } else if (!candidate) {
+        evict_node(cache, victim);
+    } else if (sketch_estimate(cache, candidate->hash) > sketch_estimate(cache, victim->hash)) {
+        evict_node(cache, victim);
+        node_unlink(cache, candidate);
+        node_link(cache, SEG_PROBATION, cache->lists[SEG_PROBATION].next, candidate);
+    } else {
+        evict_node(cache, candidate);
+    }
+}
+
+/**
+ * Remove a mapping to make room, after passing it to the eviction callback
+ * 
+ * @param cache Cache
+ * @param node Node of the mapping
+ */
+static void evict_node(cache_t cache, cache_node_t node)
+{
+    void* key = _hashmap_elem_key(cache->map, node);
+    if (cache->evict_fn) cache->evict_fn(key, node_val(node));
+    node_unlink(cache, node);
+    _hashmap_remove_hashed(cache->map, key, node->hash, NULL);
+    cache->evictions++;
+}
+
+/**
+ * Advance the hand of a CLOCK cache to the first node not referenced since
+ * the last sweep, clearing the reference bits on the way
+ * 
+ * @param cache Non-empty CLOCK cache
+ * @return Node to evict
+ */
+static cache_node_t clock_sweep(cache_t cache)
+{
+    cache_node_t head = &cache->lists[SEG_WINDOW];
+    for (;;) {
+        if (cache->hand == head) cache->hand = head->next;
+        if (!cache->hand->referenced) return cache->hand;
+        cache->hand->referenced = 0;
+        cache->hand = cache->hand->next;
+    }
+}
+
+/**
+ * Get the counter of a hash in a row of the frequency sketch
+ * 
+ * @param cache TinyLFU cache
+ * @param hash Hash of the key
+ * @param row Row of the sketch
+ * @return Index of the counter
+ */
+static size_t sketch_index(cache_t cache, uint64_t hash, int row)
+{
+    uint64_t h = hash * sketch_seeds[row];
+    return (size_t)row * (cache->sketch_mask + 1) + ((size_t)(h >> 32) & cache->sketch_mask);
+}
+
+/**
+ * Count an access in the frequency sketch, all counters are halved once
+ * a sample of accesses proportional to the capacity has been counted
+ * 
+ * @param cache TinyLFU cache
+ * @param hash Hash of the key
+ */
+static void sketch_add(cache_t cache, uint64_t hash)
+{
+    /* Only the smallest counters are raised, which keeps the overestimate low */
+    unsigned min = sketch_estimate(cache, hash);
+    if (min < CACHE_COUNTER_MAX) {
+        for (int row = 0; row < CACHE_SKETCH_ROWS; row++) {
+            uint8_t* counter = &cache->sketch[sketch_index(cache, hash, row)];
+            if (*counter == min) (*counter)++;
+        }
+    }
+    if (++cache->additions < cache->sample) return;
+    size_t len = (cache->sketch_mask + 1) * CACHE_SKETCH_ROWS;
+    for (size_t i = 0; i < len; i++)
+        cache->sketch[i] >>= 1;
+    cache->additions /= 2;
+}
+
+/**
+ * Estimate the access frequency of a hash
+ * 
+ * @param cache TinyLFU cache
+ * @param hash Hash of the key
+ * @return Smallest counter of the hash over the rows
+ */
+static unsigned sketch_estimate(cache_t cache, uint64_t hash)
+{
+    unsigned min = CACHE_COUNTER_MAX;
+    for (int row = 0; row < CACHE_SKETCH_ROWS; row++) {
+        unsigned counter = cache->sketch[sketch_index(cache, hash, row)];
+        if (counter < min) min = counter;
+    }
+    return min;
+}
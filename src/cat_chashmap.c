@@ -0,0 +1,426 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "cat_chashmap.h"
+#include "cat_hashmap_internal.h"
+#include "cat_thread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define CHASHMAP_CACHE_LINE 64
+
+/* Every shard is a complete hashmap behind its own lock, the shards are
+ * cache line aligned so that locking one never invalidates its neighbours */
+typedef struct chashmap_shard_s {
+    cat_mutex_t                 lock;
+    hashmap_t                   map;
+} chashmap_shard_s;
+
+typedef union {
+    chashmap_shard_s            shard;
+    char                        pad[(sizeof(chashmap_shard_s) + CHASHMAP_CACHE_LINE - 1) /
+                                    CHASHMAP_CACHE_LINE * CHASHMAP_CACHE_LINE];
+} chashmap_shard_t;
+
+typedef struct chashmap_s {
+    chashmap_shard_t           *shards;
+    void                       *shards_mem;
+    size_t                      nshards;
+    unsigned                    shard_bits;
+} chashmap_s;
+
+static chashmap_shard_s* shard_of(chashmap_t ht, uint64_t hash);
+static size_t roundup_pow2(size_t n);
+
+/**
+ * Get the size of the concurrent hashmap, exact only if no writer runs
+ * 
+ * @param ht Concurrent hashmap
+ * @return Size of the concurrent hashmap
+ */
+size_t chashmap_size(chashmap_t ht)
+{
+    size_t size = 0;
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        size += hashmap_size(shard->map);
+        cat_mutex_unlock(&shard->lock);
+    }
+    return size;
+}
+
+/**
+ * Get the capacity of the concurrent hashmap, summed over the shards
+ * 
+ * @param ht Concurrent hashmap
+ * @return Capacity of the concurrent hashmap
+ */
+size_t chashmap_capacity(chashmap_t ht)
+{
+    size_t capacity = 0;
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        capacity += hashmap_capacity(shard->map);
+        cat_mutex_unlock(&shard->lock);
+    }
+    return capacity;
+}
+
+/**
+ * Get the number of shards of the concurrent hashmap
+ * 
+ * @param ht Concurrent hashmap
+ * @return Number of shards
+ */
+size_t chashmap_shards(chashmap_t ht)
+{
+    return ht->nshards;
+}
+
+/**
+ * Check if the concurrent hashmap is empty
+ * 
+ * @param ht Concurrent hashmap
+ * @return 1 if the concurrent hashmap is empty, 0 otherwise
+ */
+int chashmap_is_empty(chashmap_t ht)
+{
+    return chashmap_size(ht) == 0;
+}
+
+/**
+ * Check if the concurrent hashmap contains a key
+ * 
+ * @param ht Concurrent hashmap
+ * @param key Key to check
+ * @return 1 if the concurrent hashmap contains the key, 0 otherwise
+ */
+int chashmap_contains_key(chashmap_t ht, void* key)
+{
+    if (!key) {
+        chashmap_shard_s* shard = &ht->shards[0].shard;
+        cat_mutex_lock(&shard->lock);
+        int found = hashmap_contains_key(shard->map, NULL);
+        cat_mutex_unlock(&shard->lock);
+        return found;
+    }
+    uint64_t hash = _hashmap_hash(ht->shards[0].shard.map, key);
+    chashmap_shard_s* shard = shard_of(ht, hash);
+    cat_mutex_lock(&shard->lock);
+    /* A lock-free read shard hands out no pointers into itself */
+    int found = _hashmap_query_hashed(shard->map, key, hash, NULL) == COMPLETE;
+    cat_mutex_unlock(&shard->lock);
+    return found;
+}
+
+/**
+ * Initialize a concurrent hashmap
+ * 
+ * @param shards Number of shards, rounded up to a power of 2
+ * @param capacity Initial capacity of the concurrent hashmap
+ * @param key_len Length of the key
+ * @param elem_size Size of each element in the concurrent hashmap
+ * @param flags Flags of the shards as for _hashmap_init,
+ *              except HASHMAP_CHAIN_GUARD
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized concurrent hashmap on success, NULL on failure
+ */
+chashmap_t _chashmap_init(size_t shards,
+                          size_t capacity,
+                          size_t key_len,
+                          size_t elem_size,
+                          unsigned flags,
+                          uint64_t (*hash_fn)(const char*),
+                          int (*cmp_fn)(const void*, const void*),
+                          void* (*alloc_fn)(size_t),
+                          void (*free_fn)(void*))
+{
+    /* A shard reseeding on its own would no longer agree on the hash
+     * that routed the key to it */
+    if (flags & HASHMAP_CHAIN_GUARD) return NULL;
+    if (shards == 0 || shards > ((size_t)1 << 16)) return NULL;
+    shards = roundup_pow2(shards);
+
+    chashmap_t ht = (chashmap_t)malloc(sizeof(chashmap_s));
+    if (!ht) return NULL;
+    ht->shards_mem = malloc(shards * sizeof(chashmap_shard_t) + CHASHMAP_CACHE_LINE);
+    if (!ht->shards_mem) {
+        free(ht);
+        return NULL;
+    }
+    uintptr_t base = ((uintptr_t)ht->shards_mem + CHASHMAP_CACHE_LINE - 1) &
+                     ~(uintptr_t)(CHASHMAP_CACHE_LINE - 1);
+    ht->shards = (chashmap_shard_t*)base;
+    ht->nshards = shards;
+    ht->shard_bits = 0;
+    while (((size_t)1 << ht->shard_bits) < shards) ht->shard_bits++;
+
+    size_t shard_capacity = (capacity + shards - 1) / shards;
+    for (size_t i = 0; i < shards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        shard->map = _hashmap_init(shard_capacity,
+                                   key_len,
+                                   elem_size,
+                                   flags,
+                                   hash_fn,
+                                   cmp_fn,
+                                   alloc_fn,
+                                   free_fn);
+        if (shard->map && cat_mutex_init(&shard->lock)) {
+            hashmap_deinit(shard->map);
+            shard->map = NULL;
+        }
+        if (!shard->map) {
+            ht->nshards = i;
+            chashmap_deinit(ht);
+            return NULL;
+        }
+    }
+    return ht;
+}
+
+/**
+ * Reserve capacity in every shard, so that none of them resizes before
+ * the concurrent hashmap holds that many mappings evenly spread
+ * 
+ * @param ht Concurrent hashmap
+ * @param capacity Capacity to reserve
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t chashmap_reserve(chashmap_t ht, size_t capacity)
+{
+    size_t shard_capacity = (capacity + ht->nshards - 1) / ht->nshards;
+    stat_t stat = ERR_INVALID_OPERATION;
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        stat_t shard_stat = hashmap_reserve(shard->map, shard_capacity);
+        cat_mutex_unlock(&shard->lock);
+        if (shard_stat == COMPLETE && stat == ERR_INVALID_OPERATION) stat = COMPLETE;
+        if (shard_stat != COMPLETE && shard_stat != ERR_INVALID_OPERATION) return shard_stat;
+    }
+    return stat;
+}
+
+/**
+ * Insert or update a mapping into the concurrent hashmap
+ * 
+ * @param ht Concurrent hashmap
+ * @param key Key to insert
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t chashmap_assign(chashmap_t ht, void* key, void* val)
+{
+    chashmap_shard_s* shard = &ht->shards[0].shard;
+    stat_t stat;
+    if (!key) {
+        cat_mutex_lock(&shard->lock);
+        stat = hashmap_assign(shard->map, NULL, val);
+        cat_mutex_unlock(&shard->lock);
+        return stat;
+    }
+    uint64_t hash = _hashmap_hash(shard->map, key);
+    shard = shard_of(ht, hash);
+    cat_mutex_lock(&shard->lock);
+    stat = _hashmap_assign_hashed(shard->map, key, hash, val);
+    cat_mutex_unlock(&shard->lock);
+    return stat;
+}
+
+/**
+ * Remove a mapping from the concurrent hashmap
+ * 
+ * @param ht Concurrent hashmap
+ * @param key Key to remove
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t chashmap_remove(chashmap_t ht, void* key, void* ret_val)
+{
+    chashmap_shard_s* shard = &ht->shards[0].shard;
+    stat_t stat;
+    if (!key) {
+        cat_mutex_lock(&shard->lock);
+        stat = hashmap_remove(shard->map, NULL, ret_val);
+        cat_mutex_unlock(&shard->lock);
+        return stat;
+    }
+    uint64_t hash = _hashmap_hash(shard->map, key);
+    shard = shard_of(ht, hash);
+    cat_mutex_lock(&shard->lock);
+    stat = _hashmap_remove_hashed(shard->map, key, hash, ret_val);
+    cat_mutex_unlock(&shard->lock);
+    return stat;
+}
+
+/**
+ * Query a mapping from the concurrent hashmap
+ * 
+ * @param ht Concurrent hashmap
+ * @param key Key to query
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t chashmap_query(chashmap_t ht, void* key, void* ret_val)
+{
+    chashmap_shard_s* shard = &ht->shards[0].shard;
+    stat_t stat;
+    if (!key) {
+        cat_mutex_lock(&shard->lock);
+        stat = hashmap_query(shard->map, NULL, ret_val);
+        cat_mutex_unlock(&shard->lock);
+        return stat;
+    }
+    uint64_t hash = _hashmap_hash(shard->map, key);
+    shard = shard_of(ht, hash);
+    cat_mutex_lock(&shard->lock);
+    stat = _hashmap_query_hashed(shard->map, key, hash, ret_val);
+    cat_mutex_unlock(&shard->lock);
+    return stat;
+}
+
+/**
+ * Map a function over the key-value pairs of the concurrent hashmap,
+ * one shard at a time with the shard locked
+ * 
+ * @param ht Concurrent hashmap
+ * @param fn Function to map
+ */
+void chashmap_map(chashmap_t ht, void (*fn)(void*, void*))
+{
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        hashmap_map(shard->map, fn);
+        cat_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * Map a function over the keys of the concurrent hashmap,
+ * one shard at a time with the shard locked
+ * 
+ * @param ht Concurrent hashmap
+ * @param fn Function to map
+ */
+void chashmap_key_map(chashmap_t ht, void (*fn)(void*))
+{
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        hashmap_key_map(shard->map, fn);
+        cat_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * Map a function over the values of the concurrent hashmap,
+ * one shard at a time with the shard locked
+ * 
+ * @param ht Concurrent hashmap
+ * @param fn Function to map
+ */
+void chashmap_val_map(chashmap_t ht, void (*fn)(void*))
+{
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        hashmap_val_map(shard->map, fn);
+        cat_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * Free the entries of the concurrent hashmap
+ * 
+ * @param ht Concurrent hashmap
+ */
+void chashmap_clear(chashmap_t ht)
+{
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        cat_mutex_lock(&shard->lock);
+        hashmap_clear(shard->map);
+        cat_mutex_unlock(&shard->lock);
+    }
+}
+
+/**
+ * Free the concurrent hashmap and its entries, no other thread
+ * may be using it
+ * 
+ * @param ht Concurrent hashmap
+ */
+void chashmap_deinit(chashmap_t ht)
+{
+    for (size_t i = 0; i < ht->nshards; i++) {
+        chashmap_shard_s* shard = &ht->shards[i].shard;
+        hashmap_deinit(shard->map);
+        cat_mutex_destroy(&shard->lock);
+    }
+    free(ht->shards_mem);
+    free(ht);
+}
+
+/**
+ * Get the shard a hash belongs to, from its high bits since the
+ * shards index their own tables with the low ones
+ * 
+ * @param ht Concurrent hashmap
+ * @param hash Hash of the key
+ * @return Shard of the key
+ */
+static chashmap_shard_s* shard_of(chashmap_t ht, uint64_t hash)
+{
+    if (ht->shard_bits == 0) return &ht->shards[0].shard;
+    return &ht->shards[hash >> (64 - ht->shard_bits)].shard;
+}
+
+/**
+ * Round up to the nearest power of 2
+ * See: https://graphics.stanford.edu/~seander/bithacks.html
+ * 
+ * @param n Number to round up
+ * @return Nearest power of 2
+ */
+static size_t roundup_pow2(size_t n)
+{
+    n--;
+    n |= n >> 1;
+    n |= n >> 2;
+    n |= n >> 4;
+    n |= n >> 8;
+    n |= n >> 16;
+#if SIZE_MAX > 0xFFFFFFFF
+    n |= n >> 32;
+#endif
+    n++;
+    return n;
+}
@@ -0,0 +1,85 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "cat_epoch.h"
+#include "cat_thread.h"
+
+#define EPOCH_STRIPES 64
+#define EPOCH_CACHE_LINE 64
+
+typedef union {
+    size_t                      count;
+    char                        pad[EPOCH_CACHE_LINE];
+} epoch_counter_t;
+
+static epoch_counter_t readers[2 * EPOCH_STRIPES];
+static size_t epoch;
+static size_t next_stripe;
+static cat_mutex_t sync_lock = CAT_MUTEX_INITIALIZER;
+
+/* Stripe of the calling thread plus one, 0 until it first reads */
+static CAT_THREAD_LOCAL size_t thread_stripe;
+
+/**
+ * Enter a read-side critical section, wait-free
+ * 
+ * @return Slot to hand back to cat_epoch_exit
+ */
+size_t cat_epoch_enter(void)
+{
+    size_t stripe = thread_stripe;
+    if (!stripe) {
+        stripe = cat_atomic_fetch_add_size(&next_stripe, 1) % EPOCH_STRIPES + 1;
+        thread_stripe = stripe;
+    }
+    size_t slot = (cat_atomic_load_size(&epoch) & 1) * EPOCH_STRIPES + stripe - 1;
+    cat_atomic_fetch_add_size(&readers[slot].count, 1);
+    return slot;
+}
+
+/**
+ * Leave a read-side critical section
+ * 
+ * @param slot Slot returned by cat_epoch_enter
+ */
+void cat_epoch_exit(size_t slot)
+{
+    cat_atomic_fetch_sub_size(&readers[slot].count, 1);
+}
+
+/**
+ * Wait until every read-side critical section that was running when
+ * this was called has finished
+ */
+void cat_epoch_synchronize(void)
+{
+    cat_mutex_lock(&sync_lock);
+    for (int phase = 0; phase < 2; phase++) {
+        size_t parity = cat_atomic_fetch_add_size(&epoch, 1) & 1;
+        for (size_t i = 0; i < EPOCH_STRIPES; i++) {
+            while (cat_atomic_load_size(&readers[parity * EPOCH_STRIPES + i].count))
+                cat_thread_yield();
+        }
+    }
+    cat_mutex_unlock(&sync_lock);
+}
@@ -0,0 +1,42 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+/* Private epoch based reclamation shared by the lock-free readers of the
+ * library, not installed
+ * 
+ * Readers announce themselves in one of two reader counts, picked by the
+ * parity of a global epoch and striped over cache lines per thread. A
+ * writer that unlinked memory calls cat_epoch_synchronize, which flips
+ * the epoch twice and each time waits for the count of the previous
+ * parity to drain; afterwards no reader can still hold what was unlinked */
+
+#ifndef __CAT_EPOCH_H__
+#define __CAT_EPOCH_H__
+
+#include <stddef.h>
+
+size_t cat_epoch_enter(void);
+void cat_epoch_exit(size_t slot);
+void cat_epoch_synchronize(void);
+
+#endif
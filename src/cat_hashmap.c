@@ -22,49 +22,514 @@
 */
 
 #include "cat_hashmap.h"
+#include "cat_hashmap_internal.h"
+#include "cat_epoch.h"
+#include "cat_thread.h"
+#include "cat_mmap.h"
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define HASHMAP_SSE2
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define HASHMAP_NEON
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define hashmap_prefetch(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define hashmap_prefetch(p) _mm_prefetch((const char*)(p), _MM_HINT_T0)
+#else
+#define hashmap_prefetch(p) ((void)(p))
+#endif
 
 #define HASHMAP_LOAD_THRESHOLD 0.75
+#define HASHMAP_MAX_LOW_WATER (HASHMAP_LOAD_THRESHOLD / 4)
 #define HASHMAP_MIN_CAPACITY 8
 #define HASHMAP_MAX_CAPACITY (SIZE_MAX / 2 + 1)
+#define HASHMAP_MAX_ALIGN 16
+#define HASHMAP_REHASH_STEP 4
+#define HASHMAP_BATCH 16
+#define HASHMAP_MAX_CHAIN 32
+#define HASHMAP_ARENA_MIN 256
+#define HASHMAP_RCU_BATCH 64
+#define HASHMAP_MAX_THREADS 64
+#define HASHMAP_PARALLEL_GRAIN (1 << 14)
+#define HASHMAP_FILE_MAGIC "CATHMAP"
+#define HASHMAP_FILE_VERSION 2
+#define HASHMAP_FILE_BYTE_ORDER 0x01020304
+
+#define SWISS_GROUP_WIDTH 16
+#define SWISS_EMPTY ((uint8_t)0x80)
+#define SWISS_DELETED ((uint8_t)0xFE)
+
+#define ROBIN_MAX_DIST 255
+#define ROBIN_HOME_MIX 0x9E3779B97F4A7C15ULL
+
+#define FILTER_BLOCK_WORDS 8
+#define FILTER_BLOCK_KEYS 48
+#define FILTER_MIN_DEAD 64
+
+#define FROZEN_BUCKET_KEYS 4
+#define FROZEN_MAX_SHAPES 256
+#define FROZEN_MAX_TRIES 4
+
+#define ORDERED_EMPTY ((uint32_t)0)
+#define ORDERED_DUMMY UINT32_MAX
+
+#define hashmap_engine(ht) ((ht)->flags & HASHMAP_ENGINE_MASK)
+#define hashmap_strkeys(ht) ((ht)->flags & HASHMAP_STRING_KEYS)
+#define swiss_is_full(c) (!((c) & 0x80))
+#define swiss_h2(hash) ((uint8_t)((hash) & 0x7F))
+#define swiss_slot(ht, i) ((ht)->slots + (i) * (ht)->slot_size)
+#define swiss_elem(ht, i) (swiss_slot(ht, i) + (ht)->elem_offset)
+#define swiss_max_load(capacity) ((capacity) - (capacity) / 8)
+#define robin_end(ht) \
+    ((ht)->capacity + ((ht)->capacity < ROBIN_MAX_DIST ? (ht)->capacity : ROBIN_MAX_DIST))
+#define robin_home(ht, hash) \
+    ((size_t)(((hash) * ROBIN_HOME_MIX) >> (64 - ctz64((ht)->capacity))))
+#define robin_slot(ht, i) ((ht)->slots + (i) * (ht)->hashed_stride)
+#define robin_elem(ht, i) (robin_slot(ht, i) + (ht)->elem_offset)
+#define robin_hash(ht, i) \
+    (*(uint64_t*)(robin_slot(ht, i) + (ht)->hashed_stride - sizeof(uint64_t)))
+#define robin_max_load(capacity) ((capacity) - ((capacity) + 9) / 10)
+#define ordered_index(ht) ((uint32_t*)(ht)->ctrl)
+#define ordered_live(ht) ((uint64_t*)((ht)->ctrl + (ht)->capacity * sizeof(uint32_t)))
+#define ordered_head(capacity) \
+    (((capacity) * sizeof(uint32_t) + bucket_words(ordered_max_load(capacity)) * sizeof(uint64_t) + \
+      HASHMAP_MAX_ALIGN - 1) & ~(size_t)(HASHMAP_MAX_ALIGN - 1))
+#define ordered_slot(ht, e) ((ht)->slots + (e) * (ht)->hashed_stride)
+#define ordered_elem(ht, e) (ordered_slot(ht, e) + (ht)->elem_offset)
+#define ordered_hash(ht, e) \
+    (*(uint64_t*)(ordered_slot(ht, e) + (ht)->hashed_stride - sizeof(uint64_t)))
+#define ordered_max_load(capacity) ((capacity) - (capacity) / 4)
+#define ordered_used(ht) (ordered_max_load((ht)->capacity) - (ht)->growth_left)
+#define entry_key(entry) ((char*)((entry) + 1))
+
+/* Diagnostic counters, compiled out unless CAT_HASHMAP_STATS is defined */
+#ifdef CAT_HASHMAP_STATS
+#define stats_op(ht, op) ((ht)->stats_op = (op), (ht)->stats.ops[op]++)
+#define stats_filter(ht, field) ((ht)->stats.field++)
+#define stats_probe(ht) ((ht)->stats.probes[(ht)->stats_op]++)
+#define stats_compare(ht) ((ht)->stats.compares[(ht)->stats_op]++)
+#define stats_alloc(ht, bytes) ((ht)->stats.bytes_allocated += (bytes))
+#define stats_clock() stats_clock_ns()
+#define stats_resize(ht, start) \
+    ((ht)->stats.resizes++, (ht)->stats.resize_ns += stats_clock_ns() - (start))
+#else
+#define stats_op(ht, op) ((void)0)
+#define stats_filter(ht, field) ((void)0)
+#define stats_probe(ht) ((void)0)
+#define stats_compare(ht) ((void)0)
+#define stats_alloc(ht, bytes) ((void)0)
+#define stats_clock() ((uint64_t)0)
+#define stats_resize(ht, start) ((void)(start))
+#endif
+#define bucket_words(capacity) (((capacity) + 63) / 64)
+#define bucket_bitmap(entries, capacity) ((uint64_t*)((entries) + (capacity)))
+#define entry_elem(ht, entry) (entry_key(entry) + (ht)->elem_offset)
+#define mapped_slot(ht, i) ((ht)->mapped->slots + (i) * (ht)->slot_size)
+#define file_align(n) (((n) + HASHMAP_MAX_ALIGN - 1) & ~(uint64_t)(HASHMAP_MAX_ALIGN - 1))
+#define frozen_bucket(mix, buckets) ((size_t)((((mix) >> 32) * (uint64_t)(buckets)) >> 32))
+#define frozen_home(mix, count) ((size_t)((((mix) & 0xFFFFFFFF) * (uint64_t)(count)) >> 32))
+#define filter_block(ht, hash) \
+    ((ht)->filter + ((size_t)((hash) >> 32) & ((ht)->filter_blocks - 1)) * FILTER_BLOCK_WORDS)
+#define filter_bit(hash, w) ((uint64_t)1 << (((uint32_t)(hash) * filter_salt[w]) >> 26))
+
+static inline unsigned ctz64(uint64_t x)
+{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long i;
+    _BitScanForward64(&i, x);
+    return (unsigned)i;
+#elif defined(_MSC_VER)
+    unsigned long i;
+    if (_BitScanForward(&i, (unsigned long)x)) return (unsigned)i;
+    _BitScanForward(&i, (unsigned long)(x >> 32));
+    return (unsigned)i + 32;
+#else
+    return (unsigned)__builtin_ctzll(x);
+#endif
+}
+
+static inline unsigned popcount64(uint64_t x)
+{
+#if defined(_MSC_VER)
+    x -= (x >> 1) & 0x5555555555555555ull;
+    x = (x & 0x3333333333333333ull) + ((x >> 2) & 0x3333333333333333ull);
+    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+    return (unsigned)((x * 0x0101010101010101ull) >> 56);
+#else
+    return (unsigned)__builtin_popcountll(x);
+#endif
+}
 
+/* An entry is a single block, the key and the value are stored inline
+ * after the header with the same layout as an open addressing slot */
 typedef struct hashmap_entry_s {
     struct hashmap_entry_s     *next;
     uint64_t                    hash;
-    void                       *key;
-    void                       *elem;
 } hashmap_entry_s, *hashmap_entry_t;
 
+/* Bucket array of a HASHMAP_LOCKFREE_READ hashmap, published as a whole
+ * so that readers always see a capacity matching the buckets; the
+ * capacity is 64-bit so the occupancy bitmap after the buckets stays aligned */
+typedef struct hashmap_table_s {
+    uint64_t                    capacity;
+    struct hashmap_entry_s     *entries[];
+} hashmap_table_s, *hashmap_table_t;
+
+/* Writer side of a HASHMAP_LOCKFREE_READ hashmap: the lock serializing
+ * writers and the memory they unlinked that readers may still be using */
+typedef struct hashmap_rcu_s {
+    hashmap_table_t             table;
+    cat_mutex_t                 lock;
+    void                      **retired;
+    size_t                      nretired;
+    size_t                      retired_capacity;
+} hashmap_rcu_s, *hashmap_rcu_t;
+
+/* Snapshot loaded by hashmap_load_mmap, the mappings are sorted by bucket
+ * and bucket i holds the indices from buckets[i] to buckets[i + 1]; a frozen
+ * snapshot has pilots instead, which place every mapping at its own index */
+typedef struct hashmap_mapped_s {
+    cat_mmap_t                  file;
+    char                       *image;
+    const uint64_t             *buckets;
+    const uint64_t             *pilots;
+    const uint64_t             *hashes;
+    const char                 *slots;
+    size_t                      count;
+    size_t                      pilot_count;
+    uint64_t                    salt;
+} hashmap_mapped_s, *hashmap_mapped_t;
+
+/* Header of a file written by hashmap_save, the sections follow in the order
+ * of their offsets, which count from the start of the file and are aligned
+ * to HASHMAP_MAX_ALIGN */
+typedef struct {
+    char                        magic[8];
+    uint32_t                    version;
+    uint32_t                    byte_order;
+    uint32_t                    word_size;
+    uint32_t                    flags;
+    uint64_t                    key_len;
+    uint64_t                    elem_size;
+    uint64_t                    elem_offset;
+    uint64_t                    slot_size;
+    uint64_t                    seed;
+    uint64_t                    capacity;
+    uint64_t                    count;
+    uint64_t                    buckets_offset;
+    uint64_t                    hashes_offset;
+    uint64_t                    slots_offset;
+    uint64_t                    arena_offset;
+    uint64_t                    arena_len;
+    uint64_t                    null_offset;
+    uint64_t                    pilots_offset;
+    uint64_t                    pilot_count;
+    uint64_t                    salt;
+    uint64_t                    file_size;
+} hashmap_file_t;
+
+/* Value of a key in a multimap: the values mapped to it, in append order
+ * in a single block that doubles as they are appended */
+typedef struct {
+    char                       *values;
+    size_t                      count;
+    size_t                      capacity;
+} hashmap_run_t;
+
+/* A string key as stored in an entry or slot, the bytes live in the arena */
+typedef struct {
+    size_t                      offset;
+    size_t                      len;
+} hashmap_strref_t;
+
+/* Share of a parallel rehash: the old buckets whose index modulo the smaller
+ * of both capacities falls in [begin, end), whose entries can only land in new
+ * buckets of the same residues; the bounds are multiples of 64 so no two
+ * threads write the same word of the bitmap */
+typedef struct {
+    hashmap_t                   ht;
+    hashmap_entry_t            *entries;
+    size_t                      capacity;
+    size_t                      begin;
+    size_t                      end;
+} hashmap_rehash_task_t;
+
+/* Share of a parallel bulk load: a range of the input to hash and partition,
+ * then a partition of the buckets to insert into */
+typedef struct {
+    hashmap_t                   ht;
+    const char                 *keys;
+    const char                 *vals;
+    uint64_t                   *hashes;
+    size_t                     *order;
+    size_t                     *counts;
+    size_t                      parts;
+    size_t                      part_len;
+    size_t                      stride;
+    size_t                      begin;
+    size_t                      end;
+    size_t                      bytes;
+    size_t                      inserted;
+    int                         policy;
+} hashmap_bulk_task_t;
+
+/* Share of a parallel merge of partial hashmaps: the buckets of every partial,
+ * and of the destination, whose index modulo the smallest capacity falls in
+ * [begin, end), a range of whole bitmap words as for a rehash */
+typedef struct {
+    hashmap_t                   ht;
+    hashmap_t                  *partials;
+    size_t                      n;
+    size_t                      small;
+    size_t                      begin;
+    size_t                      end;
+    size_t                      inserted;
+    void                      (*combine_fn)(void*, const void*);
+} hashmap_merge_task_t;
+
 typedef struct hashmap_s {
     struct hashmap_entry_s    **entries;
+    struct hashmap_entry_s    **old_entries;
+    struct hashmap_rcu_s       *rcu;
+    struct hashmap_mapped_s    *mapped;
+    uint8_t                    *ctrl;
+    char                       *slots;
+    void                       *null_elem;
+    char                       *arena;
+    char                       *slab;
+    char                       *slab_end;
+    uint64_t                   *filter;
+    void                       *filter_mem;
+    size_t                      filter_blocks;
+    size_t                      filter_count;
+    size_t                      filter_dead;
+    size_t                      arena_used;
+    size_t                      arena_dead;
+    size_t                      arena_capacity;
     size_t                      size;
     size_t                      capacity;
+    size_t                      old_capacity;
+    size_t                      rehash_idx;
+    size_t                      growth_left;
     size_t                      elem_size;
+    size_t                      run_size;
     size_t                      key_len;
+    size_t                      elem_offset;
+    size_t                      slot_size;
+    size_t                      hashed_stride;
+    size_t                      reseed_capacity;
+    uint64_t                    seed;
+    double                      low_water;
+    size_t                      threads;
+    unsigned                    flags;
+#ifdef CAT_HASHMAP_STATS
+    int                         stats_op;
+    hashmap_stats_t             stats;
+#endif
 
     uint64_t                  (*hash_fn)(const char*);
+    uint64_t                  (*seeded_hash_fn)(const void*, size_t, uint64_t);
     int                       (*cmp_fn)(const void*, const void*);
     void                      (*free_fn)(void*);
     void                     *(*alloc_fn)(size_t);
 } hashmap_s;
 
+/* Progress of a hashmap_iter_t */
+enum {
+    ITER_START,                 /* before the first mapping */
+    ITER_NULL,                  /* at the mapping of NULL */
+    ITER_TABLE,                 /* at the entry or slot of index */
+    ITER_REMOVED,               /* the mapping at index was removed */
+    ITER_END,
+};
+
+static stat_t null_entry_emplace(hashmap_t ht, void** ret_elem, int* created);
 static stat_t null_entry_assign(hashmap_t ht, void* val);
 static stat_t null_entry_remove(hashmap_t ht, void* ret_val);
 static stat_t null_entry_query(hashmap_t ht, void* ret_val);
 
+static hashmap_entry_t* buckets_alloc(hashmap_t ht, size_t capacity);
+static void bucket_mark(hashmap_entry_t* entries, size_t capacity, size_t i);
+static void bucket_sync(hashmap_t ht, uint64_t hash);
+static size_t bucket_next(hashmap_entry_t* entries, size_t capacity, size_t i);
 static stat_t hashmap_alloc(hashmap_t ht, size_t capacity);
+static stat_t hashmap_resize(hashmap_t ht, size_t capacity);
+static void hashmap_shrink_check(hashmap_t ht);
 static void hashmap_rehash(hashmap_t ht,
                            hashmap_entry_t* entries,
                            size_t capacity);
+static void rehash_slice(void* arg);
+static size_t parallel_threads(hashmap_t ht, size_t work);
+static void parallel_run(void (*fn)(void*), void* tasks, size_t task_size, size_t n);
+static stat_t hashmap_rehash_begin(hashmap_t ht, size_t capacity);
+static void hashmap_rehash_step(hashmap_t ht, size_t steps);
+static void hashmap_rehash_finish(hashmap_t ht);
+static stat_t hashmap_reseed(hashmap_t ht);
+static uint64_t hashmap_random_seed(hashmap_t ht);
+
+static hashmap_entry_t* chain_find(hashmap_t ht, void* key, uint64_t hash);
+static stat_t chain_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created);
+static stat_t chain_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void chain_unlink(hashmap_t ht, hashmap_entry_t* link, void* ret_val);
+
+static void* find_hashed(hashmap_t ht, void* key, uint64_t hash);
+static stat_t emplace_hashed(hashmap_t ht,
+                             void* key,
+                             uint64_t hash,
+                             void** ret_elem,
+                             int* created);
+static stat_t assign_hashed(hashmap_t ht, void* key, uint64_t hash, void* val);
+static stat_t remove_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static stat_t query_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void prefetch_bucket(hashmap_t ht, uint64_t hash);
+static void prefetch_entry(hashmap_t ht, uint64_t hash);
 
 static stat_t entry_alloc(hashmap_t ht, hashmap_entry_t* entry);
-static stat_t null_entry_alloc(hashmap_t ht, hashmap_entry_t* entry);
+static void entry_free(hashmap_t ht, hashmap_entry_t entry);
+static stat_t bulk_load(hashmap_t ht, const char* keys, const char* vals, size_t n, int policy);
+static stat_t bulk_link(hashmap_t ht,
+                        hashmap_entry_t entry,
+                        void* key,
+                        const char* val,
+                        uint64_t hash,
+                        int policy,
+                        int* used);
+static void bulk_hash(void* arg);
+static void bulk_scatter(void* arg);
+static void bulk_insert(void* arg);
+static stat_t aggregate_hashed(hashmap_t ht,
+                               void* key,
+                               uint64_t hash,
+                               const void* val,
+                               void (*combine_fn)(void*, const void*));
+static int merge_parallel(hashmap_t ht,
+                          hashmap_t* partials,
+                          size_t n,
+                          void (*combine_fn)(void*, const void*));
+static void merge_slice(void* arg);
+#ifdef CAT_HASHMAP_STATS
+static uint64_t stats_clock_ns(void);
+static void stats_histogram(hashmap_t ht, size_t* histogram);
+#endif
+
+static stat_t rcu_init(hashmap_t ht);
+static void rcu_lock(hashmap_t ht);
+static void rcu_unlock(hashmap_t ht);
+static stat_t rcu_table_alloc(hashmap_t ht, size_t capacity, hashmap_table_t* table);
+static stat_t rcu_retire(hashmap_t ht, void* ptr);
+static void rcu_reclaim(hashmap_t ht);
+static stat_t rcu_resize(hashmap_t ht, size_t capacity);
+static stat_t rcu_assign(hashmap_t ht, void* key, uint64_t hash, void* val);
+static stat_t rcu_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void rcu_unlink(hashmap_t ht, hashmap_entry_t* link, void* ret_val);
+static stat_t rcu_query(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void rcu_clear(hashmap_t ht);
+static void rcu_deinit(hashmap_t ht);
+static stat_t copy_mappings(hashmap_t* dst, hashmap_t src);
+static int iter_emit(hashmap_iter_t* it, void** key, void** val);
+static char* iter_slot(hashmap_iter_t* it, uint64_t* hash);
+
+static stat_t save_mappings(hashmap_t ht, const char* path);
+static int file_pad(FILE* fp, uint64_t* pos, uint64_t offset);
+static int file_range(uint64_t offset, uint64_t count, uint64_t size, uint64_t len);
+static int file_valid(const hashmap_file_t* hdr, size_t len);
+static stat_t mapped_query(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void mapped_attach(hashmap_t ht, hashmap_mapped_t mapped, const hashmap_file_t* hdr);
+static size_t frozen_index(hashmap_mapped_t mapped, uint64_t hash);
+static stat_t frozen_image(hashmap_t ht, char** image, size_t* len);
+static stat_t frozen_place(const uint64_t* hashes,
+                           size_t count,
+                           size_t buckets,
+                           uint64_t salt,
+                           uint64_t* pilots,
+                           uint32_t* index);
+static void hashmap_release(hashmap_t ht);
+
+static stat_t filter_alloc(hashmap_t ht, size_t live);
+static void filter_fill(hashmap_t ht);
+static void filter_set(hashmap_t ht, uint64_t hash);
+static int filter_check(hashmap_t ht, uint64_t hash);
+static void filter_add(hashmap_t ht, uint64_t hash);
+static void filter_remove(hashmap_t ht);
+static stat_t filter_copy(hashmap_t ht, hashmap_t src);
+
+static hashmap_run_t* run_find(hashmap_t ht, void* key);
+static stat_t run_grow(hashmap_t ht, hashmap_run_t* run);
+static void run_free(hashmap_t ht, hashmap_run_t* run);
+static void run_release(hashmap_t ht);
+static stat_t run_copy(hashmap_t ht);
+static void* find_elem(hashmap_t ht, void* key, uint64_t hash);
+
+static stat_t swiss_alloc(hashmap_t ht, size_t capacity);
+static stat_t swiss_grow(hashmap_t ht);
+static size_t swiss_find(hashmap_t ht, void* key, uint64_t hash);
+static size_t swiss_find_free(hashmap_t ht, uint64_t hash);
+static size_t swiss_next(hashmap_t ht, size_t i);
+static stat_t swiss_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created);
+static stat_t swiss_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void swiss_erase(hashmap_t ht, size_t i, void* ret_val);
+
+static stat_t robin_alloc(hashmap_t ht, size_t capacity);
+static stat_t robin_grow(hashmap_t ht);
+static size_t robin_find(hashmap_t ht, void* key, uint64_t hash);
+static size_t robin_place(hashmap_t ht, uint64_t hash);
+static size_t robin_collisions(hashmap_t ht, uint64_t hash);
+static void robin_unlink(hashmap_t ht, size_t i);
+static size_t robin_next(hashmap_t ht, size_t i);
+static stat_t robin_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created);
+static stat_t robin_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void robin_erase(hashmap_t ht, size_t i, void* ret_val);
+
+static stat_t ordered_alloc(hashmap_t ht, size_t capacity);
+static size_t ordered_find(hashmap_t ht, void* key, uint64_t hash);
+static size_t ordered_locate(hashmap_t ht, size_t e);
+static size_t ordered_next(hashmap_t ht, size_t e);
+static stat_t ordered_emplace(hashmap_t ht,
+                              void* key,
+                              uint64_t hash,
+                              void** ret_elem,
+                              int* created);
+static stat_t ordered_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+static void ordered_erase(hashmap_t ht, size_t i, void* ret_val);
 
 static size_t roundup_pow2(size_t n);
+static size_t size_align(size_t size);
+static uint64_t fetch64(const char *p);
+static uint32_t fetch32(const char *p);
+static uint64_t cityhash64_seed(const char *s, size_t len, uint64_t seed);
 
 static uint64_t hashmap_hash(hashmap_t ht, void* key);
+static int key_match(hashmap_t ht, const void* stored, const void* key);
+static stat_t key_store(hashmap_t ht, char* stored, const void* key);
+static void key_release(hashmap_t ht, const char* stored);
+static void* key_load(hashmap_t ht, char* stored, hashmap_str_t* view);
+static size_t arena_move(hashmap_t ht, char* arena, size_t used, char* stored);
+static stat_t arena_reserve(hashmap_t ht, size_t len);
 
 /**
  * Get the size of the hashmap
@@ -74,6 +539,7 @@ static uint64_t hashmap_hash(hashmap_t ht, void* key);
  */
 size_t hashmap_size(hashmap_t ht)
 {
+    if (ht->rcu) return cat_atomic_load_size(&ht->size);
     return ht->size;
 }
 
@@ -85,9 +551,21 @@ size_t hashmap_size(hashmap_t ht)
  */
 size_t hashmap_capacity(hashmap_t ht)
 {
+    if (ht->rcu) return cat_atomic_load_size(&ht->capacity);
     return ht->capacity;
 }
 
+/**
+ * Get the seed the hashmap hashes keys with
+ * 
+ * @param ht Hashmap
+ * @return Seed of the hashmap, 0 unless initialized with _hashmap_init_seeded
+ */
+uint64_t hashmap_seed(hashmap_t ht)
+{
+    return ht->seed;
+}
+
 /**
  * Get the load factor of the hashmap
  * 
@@ -96,6 +574,7 @@ size_t hashmap_capacity(hashmap_t ht)
  */
 double hashmap_load(hashmap_t ht)
 {
+    if (ht->rcu) return (double)hashmap_size(ht) / hashmap_capacity(ht);
     return (double)ht->size / ht->capacity;
 }
 
@@ -107,7 +586,7 @@ double hashmap_load(hashmap_t ht)
  */
 int hashmap_is_empty(hashmap_t ht)
 {
-    return ht->size == 0;
+    return hashmap_size(ht) == 0;
 }
 
 /**
@@ -119,27 +598,12 @@ int hashmap_is_empty(hashmap_t ht)
  */
 int hashmap_contains_key(hashmap_t ht, void* key)
 {
-    if (!key) {
-        hashmap_entry_t entry = ht->entries[0];
-        while (entry) {
-            if (!entry->key) return 1;
-            entry = entry->next;
-        }
-    } else {
-        uint64_t hash = hashmap_hash(ht, key);
-        size_t i = hash & (ht->capacity - 1);
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            if (entry->key) {
-                int match = ht->cmp_fn ?
-                    ht->cmp_fn(entry->key, key) :
-                    memcmp(entry->key, key, ht->key_len);
-                if (match == 0) return 1;
-            }
-            entry = entry->next;
-        }
-    }
-    return 0;
+    if (!key) return ht->null_elem != NULL;
+
+    uint64_t hash = hashmap_hash(ht, key);
+    if (ht->rcu) return rcu_query(ht, key, hash, NULL) == COMPLETE;
+    if (ht->mapped) return mapped_query(ht, key, hash, NULL) == COMPLETE;
+    return find_hashed(ht, key, hash) != NULL;
 }
 
 /**
@@ -151,20 +615,136 @@ int hashmap_contains_key(hashmap_t ht, void* key)
  */
 size_t hashmap_contains_val(hashmap_t ht, void* val)
 {
+    hashmap_iter_t it;
+    void* elem;
     size_t count = 0;
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            int match = ht->cmp_fn ?
-                ht->cmp_fn(entry->elem, val) :
-                memcmp(entry->elem, val, ht->elem_size);
-            if (match == 0) count++;
-            entry = entry->next;
-        }
+    rcu_lock(ht);
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &elem)) {
+        int match = ht->cmp_fn ?
+            ht->cmp_fn(elem, val) :
+            memcmp(elem, val, ht->elem_size);
+        if (match == 0) count++;
     }
+    rcu_unlock(ht);
     return count;
 }
 
+/**
+ * Get the diagnostic counters of the hashmap along with a histogram of
+ * its chain lengths, or of the probe lengths in groups for the open
+ * addressing engine. The counters are not synchronized: lookups of a
+ * lock-free read hashmap or of a mapped snapshot are not counted
+ * 
+ * @param ht Hashmap
+ * @param stats Pointer to the statistics to return
+ * @return COMPLETE on success, ERR_INVALID_OPERATION unless the library
+ *         is built with CAT_HASHMAP_STATS
+ */
+stat_t hashmap_stats(hashmap_t ht, hashmap_stats_t* stats)
+{
+#ifdef CAT_HASHMAP_STATS
+    rcu_lock(ht);
+    *stats = ht->stats;
+    memset(stats->histogram, 0, sizeof(stats->histogram));
+    stats_histogram(ht, stats->histogram);
+    rcu_unlock(ht);
+    return COMPLETE;
+#else
+    (void)ht;
+    (void)stats;
+    return ERR_INVALID_OPERATION;
+#endif
+}
+
+/**
+ * Reset the diagnostic counters of the hashmap
+ * 
+ * @param ht Hashmap
+ */
+void hashmap_stats_reset(hashmap_t ht)
+{
+#ifdef CAT_HASHMAP_STATS
+    rcu_lock(ht);
+    memset(&ht->stats, 0, sizeof(ht->stats));
+    rcu_unlock(ht);
+#else
+    (void)ht;
+#endif
+}
+
+#ifdef CAT_HASHMAP_STATS
+/**
+ * Read a clock for timing resizes
+ * 
+ * @return Time in nanoseconds
+ */
+static uint64_t stats_clock_ns(void)
+{
+    struct timespec ts;
+    if (!timespec_get(&ts, TIME_UTC)) return 0;
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Count the chains of each length, or the slots at each probe length
+ * 
+ * @param ht Hashmap
+ * @param histogram Counts to add to, the last one takes every longer length
+ */
+static void stats_histogram(hashmap_t ht, size_t* histogram)
+{
+    size_t last = HASHMAP_STATS_HISTOGRAM - 1;
+    if (ht->mapped && ht->mapped->pilots) {
+        histogram[0] += ht->mapped->count;
+    } else if (ht->mapped) {
+        hashmap_mapped_t mapped = ht->mapped;
+        for (size_t i = 0; i < ht->capacity; i++) {
+            uint64_t end = mapped->buckets[i + 1] < mapped->count ? mapped->buckets[i + 1] : mapped->count;
+            uint64_t len = end > mapped->buckets[i] ? end - mapped->buckets[i] : 0;
+            histogram[len < last ? len : last]++;
+        }
+    } else if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        size_t mask = ht->capacity / SWISS_GROUP_WIDTH - 1;
+        for (size_t i = swiss_next(ht, 0); i < ht->capacity; i = swiss_next(ht, i + 1)) {
+            hashmap_str_t view;
+            uint64_t hash = hashmap_hash(ht, key_load(ht, swiss_slot(ht, i), &view));
+            size_t group = (size_t)(hash >> 7) & mask;
+            size_t len = 0;
+            /* Walk the probe sequence of swiss_find up to the group of the slot */
+            for (size_t step = 1; group != i / SWISS_GROUP_WIDTH; step++) {
+                group = (group + step) & mask;
+                len++;
+            }
+            histogram[len < last ? len : last]++;
+        }
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        for (size_t i = robin_next(ht, 0); i < robin_end(ht); i = robin_next(ht, i + 1)) {
+            size_t len = ht->ctrl[i] - 1u;
+            histogram[len < last ? len : last]++;
+        }
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        size_t mask = ht->capacity - 1;
+        for (size_t e = ordered_next(ht, 0); e < ordered_used(ht); e = ordered_next(ht, e + 1)) {
+            size_t home = (size_t)ordered_hash(ht, e) & mask;
+            size_t len = (ordered_locate(ht, e) - home) & mask;
+            histogram[len < last ? len : last]++;
+        }
+    } else {
+        hashmap_entry_t* tables[] = {ht->entries, ht->old_entries};
+        size_t capacities[] = {ht->capacity, ht->old_capacity};
+        for (int t = 0; t < 2; t++) {
+            for (size_t i = 0; i < capacities[t]; i++) {
+                size_t len = 0;
+                for (hashmap_entry_t entry = tables[t][i]; entry; entry = entry->next)
+                    len++;
+                histogram[len < last ? len : last]++;
+            }
+        }
+    }
+}
+#endif
+
 /**
  * Allocate or reallocate memory for the hashmap entries
  * 
@@ -174,510 +754,4917 @@ size_t hashmap_contains_val(hashmap_t ht, void* val)
  */
 static stat_t hashmap_alloc(hashmap_t ht, size_t capacity)
 {
-    hashmap_entry_t* entries = NULL;
-    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
     void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
 
-    entries = alloc(capacity * sizeof(hashmap_entry_t));
+    uint64_t start = stats_clock();
+    hashmap_entry_t* entries = buckets_alloc(ht, capacity);
     if (!entries) return ERR_MEMORY_ALLOCATION;
-    memset(entries, 0, capacity * sizeof(hashmap_entry_t));
 
     if (ht->entries) {
         hashmap_rehash(ht, entries, capacity);
         dealloc(ht->entries);
+        stats_resize(ht, start);
     }
     ht->entries = entries;
     return COMPLETE;
 }
 
 /**
- * Rehash the hashmap entries
+ * Allocate an empty bucket array, followed by the bitmap of its non-empty
+ * buckets so that scans skip the empty ones a word at a time
  * 
  * @param ht Hashmap
- * @param entries New entries to rehash into
- * @param capacity New capacity of the hashmap
+ * @param capacity Number of buckets
+ * @return Bucket array on success, NULL on failure
  */
-static void hashmap_rehash(hashmap_t ht, hashmap_entry_t* entries, size_t capacity)
+static hashmap_entry_t* buckets_alloc(hashmap_t ht, size_t capacity)
 {
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            hashmap_entry_t next = entry->next;
-            size_t j = entry->hash & (capacity - 1);
-            entry->next = entries[j];
-            entries[j] = entry;
-            entry = next;
-        }
-    }
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+
+    size_t size = capacity * sizeof(hashmap_entry_t) + bucket_words(capacity) * sizeof(uint64_t);
+    hashmap_entry_t* entries = alloc(size);
+    if (!entries) return NULL;
+    stats_alloc(ht, size);
+    memset(entries, 0, size);
+    return entries;
 }
 
 /**
- * Initialize a hashmap
+ * Mark a bucket as non-empty in the bitmap of its array
  * 
- * @param capacity Initial capacity of the hashmap
- * @param key_len Length of the key
- * @param elem_size Size of each element in the hashmap
- * @param hash_fn Hash function, NULL for default cityhash64
- * @param cmp_fn Comparison function, NULL for default memcmp
- * @param alloc_fn Allocation function, NULL for default malloc
- * @param free_fn Free function, NULL for default free
- * @return Initialized hashmap on success, NULL on failure
+ * @param entries Bucket array
+ * @param capacity Number of buckets
+ * @param i Bucket to mark
  */
-hashmap_t _hashmap_init(size_t capacity,
-                        size_t key_len,
-                        size_t elem_size,
-                        uint64_t (*hash_fn)(const char*),
-                        int (*cmp_fn)(const void*, const void*),
-                        void* (*alloc_fn)(size_t),
-                        void (*free_fn)(void*))
+static void bucket_mark(hashmap_entry_t* entries, size_t capacity, size_t i)
 {
-    if (capacity >= ((size_t)0 - 1) / sizeof(hashmap_entry_t))
-        return NULL;
-    hashmap_t ht = (hashmap_t)malloc(sizeof(hashmap_s));
-    if (!ht) return NULL;
-
-    ht->capacity = capacity <= HASHMAP_MIN_CAPACITY ?
-                   HASHMAP_MIN_CAPACITY : roundup_pow2(capacity);
-    ht->size = 0;
-    ht->elem_size = elem_size;
-    ht->key_len = key_len;
-    ht->entries = NULL;
-
-    ht->hash_fn = hash_fn;
-    ht->cmp_fn = cmp_fn;
-    ht->alloc_fn = alloc_fn;
-    ht->free_fn = free_fn;
+    bucket_bitmap(entries, capacity)[i / 64] |= (uint64_t)1 << (i % 64);
+}
 
-    if (hashmap_alloc(ht, ht->capacity)) {
-        free(ht);
-        return NULL;
+/**
+ * Update the bitmap bits of the buckets a hash maps to after a removal
+ * 
+ * @param ht Hashmap
+ * @param hash Hash of the removed key
+ */
+static void bucket_sync(hashmap_t ht, uint64_t hash)
+{
+    size_t i = hash & (ht->capacity - 1);
+    if (!ht->entries[i])
+        bucket_bitmap(ht->entries, ht->capacity)[i / 64] &= ~((uint64_t)1 << (i % 64));
+    if (ht->old_entries) {
+        i = hash & (ht->old_capacity - 1);
+        if (!ht->old_entries[i])
+            bucket_bitmap(ht->old_entries, ht->old_capacity)[i / 64] &= ~((uint64_t)1 << (i % 64));
     }
-    return ht;
 }
 
 /**
- * Reserve memory for the hashmap
+ * Find the next non-empty bucket
  * 
- * @param ht Hashmap
- * @param capacity Capacity of the buffer to reserve
- * @return COMPLETE on success, corresponding error code on failure
+ * @param entries Bucket array
+ * @param capacity Number of buckets
+ * @param i Bucket to start from
+ * @return Index of the first non-empty bucket from i, capacity if none
  */
-stat_t hashmap_reserve(hashmap_t ht, size_t capacity)
+static size_t bucket_next(hashmap_entry_t* entries, size_t capacity, size_t i)
 {
-    if (capacity <= ht->capacity ||
-        capacity >= HASHMAP_MAX_CAPACITY >> 1)
-        return ERR_INVALID_OPERATION;
-    size_t new = roundup_pow2(capacity);
-    if (hashmap_alloc(ht, new))
-        return ERR_MEMORY_ALLOCATION;
-    ht->capacity = new;
-    return COMPLETE;
+    const uint64_t* bits = bucket_bitmap(entries, capacity);
+    size_t words = bucket_words(capacity);
+    size_t w = i / 64;
+    if (w >= words) return capacity;
+    uint64_t word = bits[w] & (~(uint64_t)0 << (i % 64));
+    while (!word) {
+        if (++w == words) return capacity;
+        word = bits[w];
+    }
+    return w * 64 + ctz64(word);
 }
 
 /**
- * Allocate memory for an entry
+ * Rehash the hashmap entries, split over the threads set for the hashmap
  * 
  * @param ht Hashmap
- * @param entry Pointer to the entry to allocate
- * @return COMPLETE on success, corresponding error code on failure
+ * @param entries New entries to rehash into
+ * @param capacity New capacity of the hashmap
  */
-static stat_t entry_alloc(hashmap_t ht, hashmap_entry_t* entry)
+static void hashmap_rehash(hashmap_t ht, hashmap_entry_t* entries, size_t capacity)
 {
-    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
-    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+    hashmap_rehash_task_t tasks[HASHMAP_MAX_THREADS];
+    size_t small = capacity < ht->capacity ? capacity : ht->capacity;
+    size_t n = parallel_threads(ht, ht->size);
+    if (n > small / 64) n = small < 64 ? 1 : small / 64;
+    size_t share = n == 1 ? small : (small / 64 + n - 1) / n * 64;
 
-    *entry = (hashmap_entry_t)alloc(sizeof(hashmap_entry_s));
-    if (!*entry) return ERR_MEMORY_ALLOCATION;
-
-    (*entry)->key = alloc(ht->key_len);
-    if (!(*entry)->key) {
-        dealloc(*entry);
-        return ERR_MEMORY_ALLOCATION;
+    for (size_t t = 0; t < n; t++) {
+        tasks[t].ht = ht;
+        tasks[t].entries = entries;
+        tasks[t].capacity = capacity;
+        tasks[t].begin = t * share < small ? t * share : small;
+        tasks[t].end = t + 1 == n || (t + 1) * share > small ? small : (t + 1) * share;
     }
+    parallel_run(rehash_slice, tasks, sizeof(tasks[0]), n);
+}
 
-    (*entry)->elem = alloc(ht->elem_size);
-    if (!(*entry)->elem) {
-        dealloc((*entry)->key);
-        dealloc(*entry);
-        return ERR_MEMORY_ALLOCATION;
-    }
+/**
+ * Move the entries of a share of the old buckets into the new ones
+ * 
+ * @param arg Rehash task
+ */
+static void rehash_slice(void* arg)
+{
+    hashmap_rehash_task_t* task = (hashmap_rehash_task_t*)arg;
+    hashmap_t ht = task->ht;
+    hashmap_entry_t* entries = task->entries;
+    size_t capacity = task->capacity;
+    size_t small = capacity < ht->capacity ? capacity : ht->capacity;
 
-    (*entry)->next = NULL;
-    return COMPLETE;
+    for (size_t base = 0; base < ht->capacity; base += small) {
+        for (size_t i = base + task->begin; i < base + task->end; i++) {
+            hashmap_entry_t entry = ht->entries[i];
+            while (entry) {
+                hashmap_entry_t next = entry->next;
+                size_t j = entry->hash & (capacity - 1);
+                entry->next = entries[j];
+                entries[j] = entry;
+                bucket_mark(entries, capacity, j);
+                entry = next;
+            }
+        }
+    }
 }
 
 /**
- * Allocate memory for a null entry
+ * Get the number of threads worth starting for an amount of work
  * 
  * @param ht Hashmap
- * @param entry Pointer to the entry to allocate
- * @return COMPLETE on success, corresponding error code on failure
+ * @param work Number of entries or keys to process
+ * @return Threads set for the hashmap, fewer if each would get too little work
  */
-static stat_t null_entry_alloc(hashmap_t ht, hashmap_entry_t* entry)
+static size_t parallel_threads(hashmap_t ht, size_t work)
 {
-    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
-    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+    size_t n = work / HASHMAP_PARALLEL_GRAIN;
+    if (n > ht->threads) n = ht->threads;
+    return n ? n : 1;
+}
 
-    *entry = (hashmap_entry_t)alloc(sizeof(hashmap_entry_s));
-    if (!*entry) return ERR_MEMORY_ALLOCATION;
-    
-    (*entry)->elem = alloc(ht->elem_size);
-    if (!(*entry)->elem) {
-        dealloc(*entry);
-        return ERR_MEMORY_ALLOCATION;
+/**
+ * Run tasks on their own threads, the first one on the calling thread;
+ * a task whose thread cannot be started runs on the calling thread as well
+ * 
+ * @param fn Function to run on each task
+ * @param tasks Array of tasks
+ * @param task_size Size of each task
+ * @param n Number of tasks, at most HASHMAP_MAX_THREADS
+ */
+static void parallel_run(void (*fn)(void*), void* tasks, size_t task_size, size_t n)
+{
+    cat_thread_t threads[HASHMAP_MAX_THREADS];
+    int started[HASHMAP_MAX_THREADS];
+    for (size_t t = 1; t < n; t++)
+        started[t] = cat_thread_create(&threads[t], fn, (char*)tasks + t * task_size) == COMPLETE;
+    fn(tasks);
+    for (size_t t = 1; t < n; t++) {
+        if (started[t]) {
+            cat_thread_join(threads[t]);
+        } else {
+            fn((char*)tasks + t * task_size);
+        }
     }
-
-    (*entry)->key = NULL;
-    (*entry)->hash = 0;
-    (*entry)->next = NULL;
-    return COMPLETE;
 }
 
 /**
- * Insert or update a mapping for NULL into the hashmap
+ * Start an incremental rehash, the current entries are kept as the old
+ * table and moved into the new one bucket by bucket
  * 
  * @param ht Hashmap
- * @param val Value to insert
+ * @param capacity New capacity of the hashmap
  * @return COMPLETE on success, corresponding error code on failure
  */
-static stat_t null_entry_assign(hashmap_t ht, void* val)
+static stat_t hashmap_rehash_begin(hashmap_t ht, size_t capacity)
 {
-    hashmap_entry_t entry = ht->entries[0];
-    while (entry) {
-        if (!entry->key) {
-            memcpy(entry->elem, val, ht->elem_size);
-            return COMPLETE;
-        }
-        entry = entry->next;
-    }
-
-    hashmap_entry_t null_entry = NULL;
-    if (null_entry_alloc(ht, &null_entry))
-        return ERR_MEMORY_ALLOCATION;
-    null_entry->next = ht->entries[0];
-    memcpy(null_entry->elem, val, ht->elem_size);
-    ht->entries[0] = null_entry;
-    ht->size++;
+    hashmap_rehash_finish(ht);
+    uint64_t start = stats_clock();
+    hashmap_entry_t* entries = buckets_alloc(ht, capacity);
+    if (!entries) return ERR_MEMORY_ALLOCATION;
 
+    /* Only the allocation is timed, the moves are spread over later operations */
+    stats_resize(ht, start);
+    ht->old_entries = ht->entries;
+    ht->old_capacity = ht->capacity;
+    ht->rehash_idx = 0;
+    ht->entries = entries;
+    ht->capacity = capacity;
     return COMPLETE;
 }
 
 /**
- * Remove a mapping for NULL from the hashmap
+ * Move a bounded number of buckets from the old table into the new one
  * 
  * @param ht Hashmap
- * @param ret_val Pointer to the value to return
- * @return COMPLETE on success, corresponding error code on failure
+ * @param steps Number of non-empty buckets to move, empty buckets
+ *              visited are bounded to ten times as many
  */
-static stat_t null_entry_remove(hashmap_t ht, void* ret_val)
+static void hashmap_rehash_step(hashmap_t ht, size_t steps)
 {
-    hashmap_entry_t entry = ht->entries[0];
-    hashmap_entry_t prev = NULL;
+    if (!ht->old_entries) return;
 
-    while (entry) {
-        if (!entry->key) {
-            if (prev) prev->next = entry->next;
-            else ht->entries[0] = entry->next;
-            if (ret_val)
-                memcpy(ret_val, entry->elem, ht->elem_size);
-            if (ht->free_fn) {
-                ht->free_fn(entry->elem);
-                ht->free_fn(entry);
-            } else {
-                free(entry->elem);
-                free(entry);
-            }
-            ht->size--;
-            return COMPLETE;
+    size_t empty_visits = steps * 10;
+    while (steps && ht->rehash_idx < ht->old_capacity) {
+        hashmap_entry_t entry = ht->old_entries[ht->rehash_idx];
+        if (!entry) {
+            ht->rehash_idx++;
+            if (--empty_visits == 0) break;
+            continue;
+        }
+        while (entry) {
+            hashmap_entry_t next = entry->next;
+            size_t j = entry->hash & (ht->capacity - 1);
+            entry->next = ht->entries[j];
+            ht->entries[j] = entry;
+            bucket_mark(ht->entries, ht->capacity, j);
+            entry = next;
         }
-        prev = entry;
-        entry = entry->next;
+        ht->old_entries[ht->rehash_idx++] = NULL;
+        steps--;
+    }
+
+    if (ht->rehash_idx == ht->old_capacity) {
+        if (ht->free_fn) {
+            ht->free_fn(ht->old_entries);
+        } else {
+            free(ht->old_entries);
+        }
+        ht->old_entries = NULL;
+        ht->old_capacity = 0;
     }
-    return ERR_INVALID_OPERATION;
 }
 
 /**
- * Query a mapping for NULL from the hashmap
+ * Complete an incremental rehash in progress
+ * 
+ * @param ht Hashmap
+ */
+static void hashmap_rehash_finish(hashmap_t ht)
+{
+    while (ht->old_entries)
+        hashmap_rehash_step(ht, SIZE_MAX);
+}
+
+/**
+ * Draw a new seed and rehash every entry with it
  * 
  * @param ht Hashmap
- * @param ret_val Pointer to the value to return
  * @return COMPLETE on success, corresponding error code on failure
  */
-static stat_t null_entry_query(hashmap_t ht, void* ret_val)
+static stat_t hashmap_reseed(hashmap_t ht)
+{
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    hashmap_rehash_finish(ht);
+    uint64_t start = stats_clock();
+    hashmap_entry_t* entries = buckets_alloc(ht, ht->capacity);
+    if (!entries) return ERR_MEMORY_ALLOCATION;
+
+    ht->seed = hashmap_random_seed(ht);
+    for (size_t i = 0; i < ht->capacity; i++) {
+        hashmap_entry_t entry = ht->entries[i];
+        while (entry) {
+            hashmap_entry_t next = entry->next;
+            hashmap_str_t view;
+            entry->hash = hashmap_hash(ht, key_load(ht, entry_key(entry), &view));
+            size_t j = entry->hash & (ht->capacity - 1);
+            entry->next = entries[j];
+            entries[j] = entry;
+            bucket_mark(entries, ht->capacity, j);
+            entry = next;
+        }
+    }
+    dealloc(ht->entries);
+    ht->entries = entries;
+    ht->reseed_capacity = ht->capacity;
+    if (ht->filter) filter_fill(ht);
+    stats_resize(ht, start);
+    return COMPLETE;
+}
+
+/**
+ * Draw a seed from the clock, the address of the hashmap and a counter
+ * 
+ * @param ht Hashmap
+ * @return Non-zero seed
+ */
+static uint64_t hashmap_random_seed(hashmap_t ht)
+{
+    static size_t counter = 0;
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+
+    uint64_t seed = intmix64((uint64_t)ts.tv_sec, (uint64_t)ts.tv_nsec);
+    seed = intmix64(seed ^ (uint64_t)clock(), (uint64_t)(uintptr_t)ht);
+    seed = intmix64(seed, (uint64_t)(cat_atomic_fetch_add_size(&counter, 1) + 1) ^ ht->seed);
+    return seed ? seed : 1;
+}
+
+/**
+ * Find the link to the entry of a key in the chained engine
+ * 
+ * During an incremental rehash, the old table is searched first
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Pointer to the link holding the entry, NULL if not found
+ */
+static hashmap_entry_t* chain_find(hashmap_t ht, void* key, uint64_t hash)
+{
+    hashmap_entry_t* link;
+    if (ht->old_entries) {
+        link = &ht->old_entries[hash & (ht->old_capacity - 1)];
+        for (; *link; link = &(*link)->next) {
+            stats_probe(ht);
+            if ((*link)->hash != hash) continue;
+            stats_compare(ht);
+            if (key_match(ht, entry_key(*link), key)) return link;
+        }
+    }
+    link = &ht->entries[hash & (ht->capacity - 1)];
+    for (; *link; link = &(*link)->next) {
+        stats_probe(ht);
+        if ((*link)->hash != hash) continue;
+        stats_compare(ht);
+        if (key_match(ht, entry_key(*link), key)) return link;
+    }
+    return NULL;
+}
+
+/**
+ * Initialize a hashmap
+ * 
+ * @param capacity Initial capacity of the hashmap
+ * @param key_len Length of the key
+ * @param elem_size Size of each element in the hashmap
+ * @param flags Storage engine, HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_ROBIN
+ *              or HASHMAP_ORDERED,
+ *              optionally combined with HASHMAP_INCREMENTAL for chaining
+ *              and a HASHMAP_HASH_* hash function, HASHMAP_STRING_KEYS
+ *              takes hashmap_str_t keys whose bytes are copied into the map,
+ *              HASHMAP_LOCKFREE_READ makes queries wait-free,
+ *              HASHMAP_FILTER puts a membership filter in front of lookups
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized hashmap on success, NULL on failure
+ */
+hashmap_t _hashmap_init(size_t capacity,
+                        size_t key_len,
+                        size_t elem_size,
+                        unsigned flags,
+                        uint64_t (*hash_fn)(const char*),
+                        int (*cmp_fn)(const void*, const void*),
+                        void* (*alloc_fn)(size_t),
+                        void (*free_fn)(void*))
+{
+    if (capacity >= ((size_t)0 - 1) / sizeof(hashmap_entry_t))
+        return NULL;
+    if ((flags & HASHMAP_ENGINE_MASK) > HASHMAP_ORDERED)
+        return NULL;
+    if ((flags & (HASHMAP_INCREMENTAL | HASHMAP_CHAIN_GUARD | HASHMAP_LOCKFREE_READ)) &&
+        (flags & HASHMAP_ENGINE_MASK) != HASHMAP_CHAINED)
+        return NULL;
+    /* Lock-free readers need entries that never move or change in place */
+    if ((flags & HASHMAP_LOCKFREE_READ) &&
+        (flags & (HASHMAP_INCREMENTAL | HASHMAP_CHAIN_GUARD | HASHMAP_STRING_KEYS |
+                  HASHMAP_FILTER)))
+        return NULL;
+    if ((flags & HASHMAP_HASH_MASK) > HASHMAP_HASH_INT)
+        return NULL;
+    /* A hash function without a seed collides the same way after a reseed */
+    if ((flags & HASHMAP_CHAIN_GUARD) && hash_fn)
+        return NULL;
+    if ((flags & HASHMAP_STRING_KEYS) && (key_len != sizeof(hashmap_str_t) || hash_fn))
+        return NULL;
+    int int_key = !(flags & HASHMAP_STRING_KEYS) &&
+                  (key_len == sizeof(uint32_t) || key_len == sizeof(uint64_t));
+    if ((flags & HASHMAP_HASH_MASK) == HASHMAP_HASH_INT && !int_key && !hash_fn)
+        return NULL;
+    /* Integer keys default to a single multiply mixer, anything else to cityhash */
+    if ((flags & HASHMAP_HASH_MASK) == HASHMAP_HASH_AUTO)
+        flags |= int_key ? HASHMAP_HASH_INT : HASHMAP_HASH_CITY;
+    hashmap_t ht = (hashmap_t)malloc(sizeof(hashmap_s));
+    if (!ht) return NULL;
+
+    ht->capacity = capacity <= HASHMAP_MIN_CAPACITY ?
+                   HASHMAP_MIN_CAPACITY : roundup_pow2(capacity);
+    ht->size = 0;
+    ht->elem_size = elem_size;
+    ht->run_size = 0;
+    ht->key_len = key_len;
+    ht->flags = flags;
+    ht->entries = NULL;
+    ht->old_entries = NULL;
+    ht->rcu = NULL;
+    ht->mapped = NULL;
+    ht->old_capacity = 0;
+    ht->rehash_idx = 0;
+    ht->ctrl = NULL;
+    ht->slots = NULL;
+    ht->null_elem = NULL;
+    ht->arena = NULL;
+    ht->slab = NULL;
+    ht->slab_end = NULL;
+    ht->filter = NULL;
+    ht->filter_mem = NULL;
+    ht->filter_blocks = 0;
+    ht->filter_count = 0;
+    ht->filter_dead = 0;
+    ht->arena_used = 0;
+    ht->arena_dead = 0;
+    ht->arena_capacity = 0;
+    ht->reseed_capacity = 0;
+    ht->low_water = 0;
+    ht->threads = 1;
+    ht->seed = 0;
+#ifdef CAT_HASHMAP_STATS
+    ht->stats_op = HASHMAP_OP_QUERY;
+    memset(&ht->stats, 0, sizeof(ht->stats));
+#endif
+
+    /* Keys and values are stored inline in entries and slots,
+     * aligned as strictly as their sizes allow */
+    size_t stored_len = flags & HASHMAP_STRING_KEYS ? sizeof(hashmap_strref_t) : key_len;
+    size_t align = size_align(elem_size);
+    ht->elem_offset = (stored_len + align - 1) & ~(align - 1);
+    if (size_align(stored_len) > align) align = size_align(stored_len);
+    ht->slot_size = (ht->elem_offset + elem_size + align - 1) & ~(align - 1);
+    if (ht->slot_size == 0) ht->slot_size = 1;
+    /* The Robin Hood and ordered engines keep the hash after the value, 8-byte aligned */
+    if (align < sizeof(uint64_t)) align = sizeof(uint64_t);
+    ht->hashed_stride = ((ht->slot_size + 7) & ~(size_t)7) + sizeof(uint64_t);
+    ht->hashed_stride = (ht->hashed_stride + align - 1) & ~(align - 1);
+
+    ht->hash_fn = hash_fn;
+    ht->seeded_hash_fn = NULL;
+    ht->cmp_fn = cmp_fn;
+    ht->alloc_fn = alloc_fn;
+    ht->free_fn = free_fn;
+
+    stat_t stat;
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        size_t swiss_capacity = ht->capacity < SWISS_GROUP_WIDTH ?
+                                SWISS_GROUP_WIDTH : ht->capacity;
+        stat = swiss_alloc(ht, swiss_capacity);
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        stat = robin_alloc(ht, ht->capacity);
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        stat = ordered_alloc(ht, ht->capacity);
+    } else if (flags & HASHMAP_LOCKFREE_READ) {
+        stat = rcu_init(ht);
+    } else {
+        stat = hashmap_alloc(ht, ht->capacity);
+    }
+    if (stat) {
+        free(ht);
+        return NULL;
+    }
+    /* Sized for the mappings the initial capacity holds */
+    if ((flags & HASHMAP_FILTER) && filter_alloc(ht, ht->capacity / 2)) {
+        hashmap_deinit(ht);
+        return NULL;
+    }
+    return ht;
+}
+
+/**
+ * Initialize a hashmap with a length-aware hash function and a random seed
+ * 
+ * @param capacity Initial capacity of the hashmap
+ * @param key_len Length of the key
+ * @param elem_size Size of each element in the hashmap
+ * @param flags Same as _hashmap_init, HASHMAP_CHAIN_GUARD reseeds the map
+ *              when a chain grows too long
+ * @param hash_fn Hash function called with the key, its length and the seed,
+ *                NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized hashmap on success, NULL on failure
+ */
+hashmap_t _hashmap_init_seeded(size_t capacity,
+                               size_t key_len,
+                               size_t elem_size,
+                               unsigned flags,
+                               uint64_t (*hash_fn)(const void*, size_t, uint64_t),
+                               int (*cmp_fn)(const void*, const void*),
+                               void* (*alloc_fn)(size_t),
+                               void (*free_fn)(void*))
+{
+    if (hash_fn) flags &= ~HASHMAP_HASH_MASK;
+    hashmap_t ht = _hashmap_init(capacity,
+                                 key_len,
+                                 elem_size,
+                                 flags,
+                                 NULL,
+                                 cmp_fn,
+                                 alloc_fn,
+                                 free_fn);
+    if (!ht) return NULL;
+    ht->seeded_hash_fn = hash_fn;
+    ht->seed = hashmap_random_seed(ht);
+    return ht;
+}
+
+/**
+ * Build a hashmap from parallel arrays of keys and values
+ * 
+ * The table is sized once for n keys and every hash is computed before
+ * any insertion. Chained entries are carved from a single block, which is
+ * freed as a whole by hashmap_clear or hashmap_deinit
+ * 
+ * @param keys Array of n keys
+ * @param vals Array of n values
+ * @param n Number of mappings
+ * @param policy HASHMAP_LAST_WINS or HASHMAP_FIRST_WINS for repeated keys
+ * @param threads Threads to hash and link the keys with, kept for later
+ *                resizes as by hashmap_set_threads
+ * @param key_len Length of the key
+ * @param elem_size Size of each element in the hashmap
+ * @param flags Same as _hashmap_init
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Hashmap holding the mappings on success, NULL on failure
+ */
+hashmap_t _hashmap_from_arrays(const void* keys,
+                               const void* vals,
+                               size_t n,
+                               int policy,
+                               size_t threads,
+                               size_t key_len,
+                               size_t elem_size,
+                               unsigned flags,
+                               uint64_t (*hash_fn)(const char*),
+                               int (*cmp_fn)(const void*, const void*),
+                               void* (*alloc_fn)(size_t),
+                               void (*free_fn)(void*))
+{
+    if (policy != HASHMAP_LAST_WINS && policy != HASHMAP_FIRST_WINS)
+        return NULL;
+    if (threads == 0 || threads > HASHMAP_MAX_THREADS)
+        return NULL;
+    /* Room for every key without reaching the load threshold of either engine */
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    while (capacity < HASHMAP_MAX_CAPACITY >> 1 && n >= capacity * HASHMAP_LOAD_THRESHOLD)
+        capacity <<= 1;
+    hashmap_t ht = _hashmap_init(capacity,
+                                 key_len,
+                                 elem_size,
+                                 flags,
+                                 hash_fn,
+                                 cmp_fn,
+                                 alloc_fn,
+                                 free_fn);
+    if (!ht) return NULL;
+    ht->threads = threads;
+    if (bulk_load(ht, keys, vals, n, policy) ||
+        (ht->filter && filter_alloc(ht, ht->size))) {
+        hashmap_deinit(ht);
+        return NULL;
+    }
+    return ht;
+}
+
+/**
+ * Insert arrays of mappings into a new hashmap sized for them
+ * 
+ * Keys are hashed on the threads set for the hashmap. Chained entries are
+ * then partitioned by ranges of buckets, whole words of the bitmap each, and
+ * every range is linked by its own thread; string keys share the arena, so
+ * they are linked on the calling thread
+ * 
+ * @param ht Hashmap
+ * @param keys Array of n keys
+ * @param vals Array of n values
+ * @param n Number of mappings
+ * @param policy HASHMAP_LAST_WINS or HASHMAP_FIRST_WINS
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t bulk_load(hashmap_t ht, const char* keys, const char* vals, size_t n, int policy)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    if (!n) return COMPLETE;
+    if (n > SIZE_MAX / sizeof(uint64_t)) return ERR_CAPACITY_OVERFLOW;
+    uint64_t* hashes = malloc(n * sizeof(uint64_t));
+    if (!hashes) return ERR_MEMORY_ALLOCATION;
+
+    /* Entries of the block are spaced to the strictest alignment malloc gives */
+    size_t stride = (sizeof(hashmap_entry_s) + ht->slot_size + HASHMAP_MAX_ALIGN - 1) &
+                    ~(size_t)(HASHMAP_MAX_ALIGN - 1);
+    int slab = hashmap_engine(ht) == HASHMAP_CHAINED &&
+               !ht->rcu && !(ht->flags & HASHMAP_CHAIN_GUARD);
+    size_t threads = parallel_threads(ht, n);
+    size_t parts = slab && !hashmap_strkeys(ht) ? threads : 1;
+    if (parts > ht->capacity / 64) parts = ht->capacity < 64 ? 1 : ht->capacity / 64;
+    size_t* counts = NULL;
+    size_t* order = NULL;
+    if (parts > 1) {
+        counts = malloc(threads * parts * sizeof(size_t));
+        order = malloc(n * sizeof(size_t));
+        if (!counts || !order) {
+            free(counts);
+            free(order);
+            counts = NULL;
+            order = NULL;
+            parts = 1;
+        }
+    }
+
+    hashmap_bulk_task_t tasks[HASHMAP_MAX_THREADS];
+    size_t share = n / threads;
+    for (size_t t = 0; t < threads; t++) {
+        tasks[t].ht = ht;
+        tasks[t].keys = keys;
+        tasks[t].vals = vals;
+        tasks[t].hashes = hashes;
+        tasks[t].order = order;
+        tasks[t].counts = counts ? counts + t * parts : NULL;
+        tasks[t].parts = parts;
+        tasks[t].part_len = parts == 1 ? ht->capacity : (ht->capacity / 64 + parts - 1) / parts * 64;
+        tasks[t].stride = stride;
+        tasks[t].begin = t * share;
+        tasks[t].end = t + 1 == threads ? n : (t + 1) * share;
+        tasks[t].bytes = 0;
+        tasks[t].inserted = 0;
+        tasks[t].policy = policy;
+    }
+    parallel_run(bulk_hash, tasks, sizeof(tasks[0]), threads);
+
+    size_t bytes = 0;
+    for (size_t t = 0; t < threads; t++)
+        bytes += tasks[t].bytes;
+    stat_t stat = bytes ? arena_reserve(ht, bytes) : COMPLETE;
+
+    if (slab && stat == COMPLETE) {
+        if (n > SIZE_MAX / stride) {
+            stat = ERR_CAPACITY_OVERFLOW;
+        } else if (!(ht->slab = alloc(n * stride))) {
+            stat = ERR_MEMORY_ALLOCATION;
+        } else {
+            ht->slab_end = ht->slab + n * stride;
+            stats_alloc(ht, n * stride);
+        }
+    }
+
+    if (stat == COMPLETE && parts > 1) {
+        /* Each thread scatters its keys after those of the previous threads
+         * in every partition, so a partition keeps the input order */
+        size_t pos = 0;
+        for (size_t p = 0; p < parts; p++) {
+            for (size_t t = 0; t < threads; t++) {
+                size_t count = tasks[t].counts[p];
+                tasks[t].counts[p] = pos;
+                pos += count;
+            }
+        }
+        parallel_run(bulk_scatter, tasks, sizeof(tasks[0]), threads);
+        for (size_t p = 0; p < parts; p++) {
+            tasks[p].begin = p ? tasks[threads - 1].counts[p - 1] : 0;
+            tasks[p].end = tasks[threads - 1].counts[p];
+        }
+        parallel_run(bulk_insert, tasks, sizeof(tasks[0]), parts);
+        for (size_t p = 0; p < parts; p++)
+            ht->size += tasks[p].inserted;
+    }
+
+    char* next = ht->slab;
+    for (size_t i = 0; stat == COMPLETE && parts == 1 && i < n; i++) {
+        void* key = (void*)(keys + i * ht->key_len);
+        const char* val = vals + i * ht->elem_size;
+        if (!slab) {
+            /* Other engines and modes insert through their own paths into the presized table */
+            if (policy == HASHMAP_FIRST_WINS &&
+                (ht->rcu ? rcu_query(ht, key, hashes[i], NULL) == COMPLETE :
+                           find_hashed(ht, key, hashes[i]) != NULL))
+                continue;
+            stat = assign_hashed(ht, key, hashes[i], (void*)val);
+            continue;
+        }
+        int used;
+        stat = bulk_link(ht, (hashmap_entry_t)next, key, val, hashes[i], policy, &used);
+        if (used) {
+            next += stride;
+            ht->size++;
+        }
+    }
+    free(counts);
+    free(order);
+    free(hashes);
+    return stat;
+}
+
+/**
+ * Link an entry of the block into its chain unless the key is already there
+ * 
+ * @param ht Hashmap
+ * @param entry Unused entry of the block
+ * @param key Key to insert
+ * @param val Value to insert
+ * @param hash Hash of the key
+ * @param policy HASHMAP_LAST_WINS or HASHMAP_FIRST_WINS
+ * @param used Pointer to set to 1 if the entry is linked, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t bulk_link(hashmap_t ht,
+                        hashmap_entry_t entry,
+                        void* key,
+                        const char* val,
+                        uint64_t hash,
+                        int policy,
+                        int* used)
+{
+    size_t b = hash & (ht->capacity - 1);
+    hashmap_entry_t found = ht->entries[b];
+    while (found && (found->hash != hash || !key_match(ht, entry_key(found), key)))
+        found = found->next;
+    *used = !found;
+    if (found) {
+        if (policy == HASHMAP_LAST_WINS)
+            memcpy(entry_elem(ht, found), val, ht->elem_size);
+        return COMPLETE;
+    }
+    stat_t stat = key_store(ht, entry_key(entry), key);
+    memcpy(entry_elem(ht, entry), val, ht->elem_size);
+    entry->hash = hash;
+    entry->next = ht->entries[b];
+    ht->entries[b] = entry;
+    bucket_mark(ht->entries, ht->capacity, b);
+    return stat;
+}
+
+/**
+ * Hash a range of the keys of a bulk load and count them by partition
+ * 
+ * @param arg Bulk load task
+ */
+static void bulk_hash(void* arg)
+{
+    hashmap_bulk_task_t* task = (hashmap_bulk_task_t*)arg;
+    hashmap_t ht = task->ht;
+    if (task->counts) memset(task->counts, 0, task->parts * sizeof(size_t));
+    for (size_t i = task->begin; i < task->end; i++) {
+        void* key = (void*)(task->keys + i * ht->key_len);
+        task->hashes[i] = hashmap_hash(ht, key);
+        if (hashmap_strkeys(ht)) task->bytes += ((const hashmap_str_t*)key)->len;
+        if (task->counts)
+            task->counts[(task->hashes[i] & (ht->capacity - 1)) / task->part_len]++;
+    }
+}
+
+/**
+ * Write the indices of a range of the keys of a bulk load into their partitions
+ * 
+ * @param arg Bulk load task, its counts holding where its keys go in each partition
+ */
+static void bulk_scatter(void* arg)
+{
+    hashmap_bulk_task_t* task = (hashmap_bulk_task_t*)arg;
+    size_t mask = task->ht->capacity - 1;
+    for (size_t i = task->begin; i < task->end; i++)
+        task->order[task->counts[(task->hashes[i] & mask) / task->part_len]++] = i;
+}
+
+/**
+ * Link the keys of a partition of a bulk load, each into the entry of the
+ * block at its index in the input
+ * 
+ * @param arg Bulk load task, its range being the partition in the order array
+ */
+static void bulk_insert(void* arg)
+{
+    hashmap_bulk_task_t* task = (hashmap_bulk_task_t*)arg;
+    hashmap_t ht = task->ht;
+    for (size_t k = task->begin; k < task->end; k++) {
+        size_t i = task->order[k];
+        int used;
+        bulk_link(ht,
+                  (hashmap_entry_t)(ht->slab + i * task->stride),
+                  (void*)(task->keys + i * ht->key_len),
+                  task->vals + i * ht->elem_size,
+                  task->hashes[i],
+                  task->policy,
+                  &used);
+        task->inserted += used;
+    }
+}
+
+/**
+ * Reserve memory for the hashmap
+ * 
+ * @param ht Hashmap
+ * @param capacity Capacity of the buffer to reserve
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_reserve(hashmap_t ht, size_t capacity)
+{
+    if (ht->mapped || capacity <= ht->capacity ||
+        capacity >= HASHMAP_MAX_CAPACITY >> 1)
+        return ERR_INVALID_OPERATION;
+    size_t new = roundup_pow2(capacity);
+    rcu_lock(ht);
+    stat_t stat = new > ht->capacity ? hashmap_resize(ht, new) : COMPLETE;
+    rcu_unlock(ht);
+    return stat;
+}
+
+/**
+ * Shrink the hashmap to the smallest capacity that holds its mappings
+ * below the load threshold, string keys are compacted as well
+ * 
+ * @param ht Hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_shrink_to_fit(hashmap_t ht)
+{
+    if (ht->mapped) return ERR_INVALID_OPERATION;
+    stat_t stat = COMPLETE;
+    rcu_lock(ht);
+    size_t capacity;
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        size_t live = ht->size - (ht->null_elem != NULL);
+        capacity = SWISS_GROUP_WIDTH;
+        while (live >= swiss_max_load(capacity)) capacity <<= 1;
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        size_t live = ht->size - (ht->null_elem != NULL);
+        capacity = HASHMAP_MIN_CAPACITY;
+        while (live >= robin_max_load(capacity)) capacity <<= 1;
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        size_t live = ht->size - (ht->null_elem != NULL);
+        capacity = HASHMAP_MIN_CAPACITY;
+        while (live >= ordered_max_load(capacity)) capacity <<= 1;
+        /* Rebuilding at the same capacity still drops the holes */
+        if (capacity >= ht->capacity && ordered_used(ht) > live)
+            stat = ordered_alloc(ht, ht->capacity);
+    } else {
+        capacity = HASHMAP_MIN_CAPACITY;
+        while (ht->size >= capacity * HASHMAP_LOAD_THRESHOLD) capacity <<= 1;
+    }
+    if (stat == COMPLETE && capacity < ht->capacity) stat = hashmap_resize(ht, capacity);
+    if (stat == COMPLETE && ht->arena_dead) stat = arena_reserve(ht, 0);
+    rcu_unlock(ht);
+    return stat;
+}
+
+/**
+ * Set the number of threads that resizes of a chained hashmap are split over,
+ * including those of hashmap_reserve and hashmap_shrink_to_fit
+ * 
+ * A thread is only started for every 16384 entries moved, and the hash and
+ * comparison functions must be safe to call from several threads
+ * 
+ * @param ht Hashmap
+ * @param threads Number of threads, 1 to resize on the calling thread (default)
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_set_threads(hashmap_t ht, size_t threads)
+{
+    if (threads == 0 || threads > HASHMAP_MAX_THREADS)
+        return ERR_INVALID_OPERATION;
+    ht->threads = threads;
+    return COMPLETE;
+}
+
+/**
+ * Set the load under which a removal halves the capacity of the hashmap
+ * 
+ * The mark is capped at a quarter of the load threshold, so a halved
+ * hashmap is still half a growth away from doubling again
+ * 
+ * @param ht Hashmap
+ * @param low_water Load factor to shrink under, 0 to never shrink (default)
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_set_low_water(hashmap_t ht, double low_water)
+{
+    if (!(low_water >= 0 && low_water <= HASHMAP_MAX_LOW_WATER))
+        return ERR_INVALID_OPERATION;
+    ht->low_water = low_water;
+    return COMPLETE;
+}
+
+/**
+ * Move the mappings into a table of another capacity, the writer lock
+ * of a lock-free read hashmap must be held
+ * 
+ * @param ht Hashmap
+ * @param capacity New capacity, a power of 2 large enough for the mappings
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t hashmap_resize(hashmap_t ht, size_t capacity)
+{
+    if (ht->rcu) return rcu_resize(ht, capacity);
+    if (hashmap_engine(ht) == HASHMAP_SWISS)
+        return swiss_alloc(ht, capacity);
+    if (hashmap_engine(ht) == HASHMAP_ROBIN)
+        return robin_alloc(ht, capacity);
+    if (hashmap_engine(ht) == HASHMAP_ORDERED)
+        return ordered_alloc(ht, capacity);
+    hashmap_rehash_finish(ht);
+    if (hashmap_alloc(ht, capacity))
+        return ERR_MEMORY_ALLOCATION;
+    ht->capacity = capacity;
+    return COMPLETE;
+}
+
+/**
+ * Halve the capacity of the hashmap once a removal takes its load under
+ * the low water mark
+ * 
+ * @param ht Hashmap
+ */
+static void hashmap_shrink_check(hashmap_t ht)
+{
+    size_t min = hashmap_engine(ht) == HASHMAP_SWISS ?
+                 SWISS_GROUP_WIDTH : HASHMAP_MIN_CAPACITY;
+    if (ht->low_water == 0 || ht->capacity <= min) return;
+    if ((double)ht->size >= ht->capacity * ht->low_water) return;
+    /* Keeping the larger table is harmless if the smaller one cannot be allocated */
+    hashmap_resize(ht, ht->capacity >> 1);
+}
+
+/**
+ * Allocate memory for an entry
+ * 
+ * @param ht Hashmap
+ * @param entry Pointer to the entry to allocate
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t entry_alloc(hashmap_t ht, hashmap_entry_t* entry)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+
+    *entry = (hashmap_entry_t)alloc(sizeof(hashmap_entry_s) + ht->slot_size);
+    if (!*entry) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, sizeof(hashmap_entry_s) + ht->slot_size);
+
+    (*entry)->next = NULL;
+    return COMPLETE;
+}
+
+/**
+ * Free an entry, entries carved from the block of a bulk load
+ * stay allocated until the whole block is freed
+ * 
+ * @param ht Hashmap
+ * @param entry Entry to free
+ */
+static void entry_free(hashmap_t ht, hashmap_entry_t entry)
+{
+    uintptr_t p = (uintptr_t)entry;
+    if (p >= (uintptr_t)ht->slab && p < (uintptr_t)ht->slab_end) return;
+    if (ht->free_fn) {
+        ht->free_fn(entry);
+    } else {
+        free(entry);
+    }
+}
+
+/**
+ * Find or insert the value slot of NULL
+ * 
+ * The value of the NULL key is kept outside the table, so every
+ * engine shares the same handling
+ * 
+ * @param ht Hashmap
+ * @param ret_elem Pointer to the value slot to return
+ * @param created Pointer to set to 1 if the slot is inserted, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t null_entry_emplace(hashmap_t ht, void** ret_elem, int* created)
+{
+    if (ht->rcu || ht->mapped) return ERR_INVALID_OPERATION;
+    *created = ht->null_elem == NULL;
+    if (*created) {
+        void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+        /* A set has no value but NULL is still told present by a non-NULL slot */
+        size_t size = ht->elem_size ? ht->elem_size : 1;
+        ht->null_elem = alloc(size);
+        if (!ht->null_elem) return ERR_MEMORY_ALLOCATION;
+        stats_alloc(ht, size);
+        ht->size++;
+    }
+    *ret_elem = ht->null_elem;
+    return COMPLETE;
+}
+
+/**
+ * Insert or update a mapping for NULL into the hashmap
+ * 
+ * @param ht Hashmap
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t null_entry_assign(hashmap_t ht, void* val)
+{
+    void* elem;
+    int created;
+    stat_t stat = null_entry_emplace(ht, &elem, &created);
+    if (stat) return stat;
+    memcpy(elem, val, ht->elem_size);
+    return COMPLETE;
+}
+
+/**
+ * Remove a mapping for NULL from the hashmap
+ * 
+ * @param ht Hashmap
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t null_entry_remove(hashmap_t ht, void* ret_val)
+{
+    if (!ht->null_elem || ht->mapped) return ERR_INVALID_OPERATION;
+    if (ht->run_size) {
+        if (ret_val) return ERR_INVALID_OPERATION;
+        run_free(ht, (hashmap_run_t*)ht->null_elem);
+    }
+
+    if (ret_val)
+        memcpy(ret_val, ht->null_elem, ht->elem_size);
+    if (ht->free_fn) {
+        ht->free_fn(ht->null_elem);
+    } else {
+        free(ht->null_elem);
+    }
+    ht->null_elem = NULL;
+    ht->size--;
+    return COMPLETE;
+}
+
+/**
+ * Query a mapping for NULL from the hashmap
+ * 
+ * @param ht Hashmap
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t null_entry_query(hashmap_t ht, void* ret_val)
+{
+    if (!ht->null_elem) return ERR_INVALID_OPERATION;
+    memcpy(ret_val, ht->null_elem, ht->elem_size);
+    return COMPLETE;
+}
+
+/**
+ * Get the hash of a key
+ * 
+ * @param ht Hashmap
+ * @param key Key to hash
+ * @return Hash of the key
+ */
+static uint64_t hashmap_hash(hashmap_t ht, void* key)
+{
+    const char* data = (const char*)key;
+    size_t len = ht->key_len;
+    if (hashmap_strkeys(ht)) {
+        data = ((hashmap_str_t*)key)->str;
+        len = ((hashmap_str_t*)key)->len;
+    }
+
+    if (ht->seeded_hash_fn) return ht->seeded_hash_fn(data, len, ht->seed);
+    if (ht->hash_fn) return ht->hash_fn(data);
+    switch (ht->flags & HASHMAP_HASH_MASK) {
+    case HASHMAP_HASH_XXH3:
+        return xxh3hash64(data, len, ht->seed);
+    case HASHMAP_HASH_WYHASH:
+        return wyhash64(data, len, ht->seed);
+    case HASHMAP_HASH_INT:
+        if (len == sizeof(uint32_t))
+            return intmix64(fetch32(data), ht->seed);
+        return intmix64(fetch64(data), ht->seed);
+    default:
+        if (ht->seed) return cityhash64_seed(data, len, ht->seed);
+        return cityhash64(data, len);
+    }
+}
+
+/**
+ * Check if a stored key matches a key
+ * 
+ * @param ht Hashmap
+ * @param stored Key stored in the hashmap
+ * @param key Key to match
+ * @return 1 if the keys match, 0 otherwise
+ */
+static int key_match(hashmap_t ht, const void* stored, const void* key)
+{
+    if (hashmap_strkeys(ht)) {
+        hashmap_strref_t ref;
+        memcpy(&ref, stored, sizeof(ref));
+        const hashmap_str_t* str = (const hashmap_str_t*)key;
+        if (ref.len != str->len) return 0;
+        if (ht->cmp_fn) {
+            hashmap_str_t view = {ht->arena + ref.offset, ref.len};
+            return ht->cmp_fn(&view, key) == 0;
+        }
+        return ref.len == 0 || memcmp(ht->arena + ref.offset, str->str, ref.len) == 0;
+    }
+
+    int match = ht->cmp_fn ?
+        ht->cmp_fn(stored, key) :
+        memcmp(stored, key, ht->key_len);
+    return match == 0;
+}
+
+/**
+ * Store a key into an entry or slot, string keys are copied into the arena
+ * 
+ * @param ht Hashmap
+ * @param stored Key storage of the entry or slot
+ * @param key Key to store
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t key_store(hashmap_t ht, char* stored, const void* key)
+{
+    if (!hashmap_strkeys(ht)) {
+        memcpy(stored, key, ht->key_len);
+        return COMPLETE;
+    }
+
+    const hashmap_str_t* str = (const hashmap_str_t*)key;
+    if (!ht->arena || str->len > ht->arena_capacity - ht->arena_used) {
+        stat_t stat = arena_reserve(ht, str->len);
+        if (stat) return stat;
+    }
+    hashmap_strref_t ref = {ht->arena_used, str->len};
+    if (str->len) memcpy(ht->arena + ref.offset, str->str, str->len);
+    ht->arena_used += str->len;
+    memcpy(stored, &ref, sizeof(ref));
+    return COMPLETE;
+}
+
+/**
+ * Account for a stored key that is about to be dropped
+ * 
+ * @param ht Hashmap
+ * @param stored Key storage of the entry or slot
+ */
+static void key_release(hashmap_t ht, const char* stored)
+{
+    if (!hashmap_strkeys(ht)) return;
+    hashmap_strref_t ref;
+    memcpy(&ref, stored, sizeof(ref));
+    ht->arena_dead += ref.len;
+}
+
+/**
+ * Get a stored key in the form it was passed in
+ * 
+ * @param ht Hashmap
+ * @param stored Key storage of the entry or slot
+ * @param view View to fill for string keys
+ * @return The stored key, or the view pointing into the arena for string keys
+ */
+static void* key_load(hashmap_t ht, char* stored, hashmap_str_t* view)
+{
+    if (!hashmap_strkeys(ht)) return stored;
+    hashmap_strref_t ref;
+    memcpy(&ref, stored, sizeof(ref));
+    view->str = ht->arena + ref.offset;
+    view->len = ref.len;
+    return view;
+}
+
+/**
+ * Move the bytes of a stored string key into a new arena
+ * 
+ * @param ht Hashmap
+ * @param arena New arena
+ * @param used Bytes used in the new arena
+ * @param stored Key storage of the entry or slot
+ * @return Bytes used in the new arena after the move
+ */
+static size_t arena_move(hashmap_t ht, char* arena, size_t used, char* stored)
+{
+    hashmap_strref_t ref;
+    memcpy(&ref, stored, sizeof(ref));
+    if (ref.len) memcpy(arena + used, ht->arena + ref.offset, ref.len);
+    ref.offset = used;
+    memcpy(stored, &ref, sizeof(ref));
+    return used + ref.len;
+}
+
+/**
+ * Reallocate the key arena with room for len more bytes,
+ * only the keys still referenced are carried over
+ * 
+ * @param ht Hashmap
+ * @param len Number of bytes to make room for
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t arena_reserve(hashmap_t ht, size_t len)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    size_t live = ht->arena_used - ht->arena_dead;
+    if (len > SIZE_MAX / 2 - live) return ERR_CAPACITY_OVERFLOW;
+    size_t capacity = HASHMAP_ARENA_MIN;
+    while (capacity < (live + len) * 2) capacity <<= 1;
+    char* arena = alloc(capacity);
+    if (!arena) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, capacity);
+
+    size_t used = 0;
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        for (size_t i = 0; i < ht->capacity; i++)
+            if (swiss_is_full(ht->ctrl[i]))
+                used = arena_move(ht, arena, used, swiss_slot(ht, i));
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        for (size_t i = robin_next(ht, 0); i < robin_end(ht); i = robin_next(ht, i + 1))
+            used = arena_move(ht, arena, used, robin_slot(ht, i));
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        for (size_t e = ordered_next(ht, 0); e < ordered_used(ht); e = ordered_next(ht, e + 1))
+            used = arena_move(ht, arena, used, ordered_slot(ht, e));
+    } else {
+        for (size_t i = 0; i < ht->capacity; i++)
+            for (hashmap_entry_t entry = ht->entries[i]; entry; entry = entry->next)
+                used = arena_move(ht, arena, used, entry_key(entry));
+        for (size_t i = 0; i < ht->old_capacity; i++)
+            for (hashmap_entry_t entry = ht->old_entries[i]; entry; entry = entry->next)
+                used = arena_move(ht, arena, used, entry_key(entry));
+    }
+
+    if (ht->arena) dealloc(ht->arena);
+    ht->arena = arena;
+    ht->arena_used = used;
+    ht->arena_dead = 0;
+    ht->arena_capacity = capacity;
+    return COMPLETE;
+}
+
+/**
+ * Find or insert the entry of a key in the chained engine
+ * 
+ * @param ht Hashmap
+ * @param key Key to find or insert
+ * @param hash Hash of the key
+ * @param ret_elem Pointer to the value slot of the entry to return
+ * @param created Pointer to set to 1 if the entry is inserted, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t chain_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created)
+{
+    hashmap_rehash_step(ht, HASHMAP_REHASH_STEP);
+    if (hashmap_load(ht) >= HASHMAP_LOAD_THRESHOLD) {
+        if (ht->capacity << 1 >= HASHMAP_MAX_CAPACITY)
+            return ERR_CAPACITY_OVERFLOW;
+        if (ht->flags & HASHMAP_INCREMENTAL) {
+            if (hashmap_rehash_begin(ht, ht->capacity << 1))
+                return ERR_MEMORY_ALLOCATION;
+        } else {
+            if (hashmap_alloc(ht, ht->capacity << 1))
+                return ERR_MEMORY_ALLOCATION;
+            ht->capacity <<= 1;
+        }
+    }
+
+    hashmap_entry_t* link = chain_find(ht, key, hash);
+    if (link) {
+        *ret_elem = entry_elem(ht, *link);
+        *created = 0;
+        return COMPLETE;
+    }
+
+    size_t i = hash & (ht->capacity - 1);
+    hashmap_entry_t new_entry = NULL;
+    if (entry_alloc(ht, &new_entry))
+        return ERR_MEMORY_ALLOCATION;
+    stat_t stat = key_store(ht, entry_key(new_entry), key);
+    if (stat) {
+        if (ht->free_fn) {
+            ht->free_fn(new_entry);
+        } else {
+            free(new_entry);
+        }
+        return stat;
+    }
+    new_entry->hash = hash;
+    new_entry->next = ht->entries[i];
+
+    ht->entries[i] = new_entry;
+    bucket_mark(ht->entries, ht->capacity, i);
+    ht->size++;
+    *ret_elem = entry_elem(ht, new_entry);
+    *created = 1;
+
+    /* A chain this long means the keys collide under the current seed,
+     * reseed at most once per capacity in case the hash ignores it; a failed
+     * reseed leaves the table as it was, with the entry in it */
+    if ((ht->flags & HASHMAP_CHAIN_GUARD) && ht->reseed_capacity != ht->capacity) {
+        size_t len = 0;
+        for (hashmap_entry_t entry = new_entry; entry; entry = entry->next)
+            len++;
+        if (len > HASHMAP_MAX_CHAIN) hashmap_reseed(ht);
+    }
+    return COMPLETE;
+}
+
+/**
+ * Remove a mapping from the chained engine
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t chain_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    hashmap_rehash_step(ht, HASHMAP_REHASH_STEP);
+    hashmap_entry_t* link = chain_find(ht, key, hash);
+    if (!link) return ERR_INVALID_OPERATION;
+    chain_unlink(ht, link, ret_val);
+    return COMPLETE;
+}
+
+/**
+ * Unlink and free an entry of the chained engine
+ * 
+ * @param ht Hashmap
+ * @param link Link holding the entry
+ * @param ret_val Pointer to the value to return
+ */
+static void chain_unlink(hashmap_t ht, hashmap_entry_t* link, void* ret_val)
+{
+    hashmap_entry_t entry = *link;
+    *link = entry->next;
+    bucket_sync(ht, entry->hash);
+    key_release(ht, entry_key(entry));
+    if (ret_val)
+        memcpy(ret_val, entry_elem(ht, entry), ht->elem_size);
+    entry_free(ht, entry);
+    ht->size--;
+}
+
+/**
+ * Find the value slot of a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Pointer to the value slot, NULL if the key is not found
+ */
+static void* find_hashed(hashmap_t ht, void* key, uint64_t hash)
+{
+    /* A value found by a lock-free reader may be freed under it,
+     * and a mapped snapshot is read-only */
+    if (ht->rcu || ht->mapped) return NULL;
+    stats_op(ht, HASHMAP_OP_QUERY);
+    if (!ht->filter) return find_elem(ht, key, hash);
+    if (!filter_check(ht, hash)) {
+        stats_filter(ht, filter_rejects);
+        return NULL;
+    }
+    void* elem = find_elem(ht, key, hash);
+    if (!elem) stats_filter(ht, filter_false_positives);
+    return elem;
+}
+
+/**
+ * Find the value slot of a hashed key in the storage engine
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Pointer to the value slot, NULL if the key is not found
+ */
+static void* find_elem(hashmap_t ht, void* key, uint64_t hash)
+{
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        size_t i = swiss_find(ht, key, hash);
+        return i == ht->capacity ? NULL : swiss_elem(ht, i);
+    }
+    if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        size_t i = robin_find(ht, key, hash);
+        return i == robin_end(ht) ? NULL : robin_elem(ht, i);
+    }
+    if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        size_t i = ordered_find(ht, key, hash);
+        return i == ht->capacity ? NULL : ordered_elem(ht, ordered_index(ht)[i] - 1);
+    }
+    /* Lookups leave an incremental resize to insertions and removals,
+     * so they never move the bucket under a cursor */
+    hashmap_entry_t* link = chain_find(ht, key, hash);
+    return link ? entry_elem(ht, *link) : NULL;
+}
+
+/**
+ * Find or insert the value slot of a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to find or insert
+ * @param hash Hash of the key
+ * @param ret_elem Pointer to the value slot to return
+ * @param created Pointer to set to 1 if the key is inserted, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t emplace_hashed(hashmap_t ht,
+                             void* key,
+                             uint64_t hash,
+                             void** ret_elem,
+                             int* created)
+{
+    if (ht->rcu || ht->mapped) return ERR_INVALID_OPERATION;
+    stats_op(ht, HASHMAP_OP_INSERT);
+    stat_t stat;
+    if (hashmap_engine(ht) == HASHMAP_SWISS)
+        stat = swiss_emplace(ht, key, hash, ret_elem, created);
+    else if (hashmap_engine(ht) == HASHMAP_ROBIN)
+        stat = robin_emplace(ht, key, hash, ret_elem, created);
+    else if (hashmap_engine(ht) == HASHMAP_ORDERED)
+        stat = ordered_emplace(ht, key, hash, ret_elem, created);
+    else
+        stat = chain_emplace(ht, key, hash, ret_elem, created);
+    if (stat == COMPLETE && *created && ht->filter) filter_add(ht, hash);
+    return stat;
+}
+
+/**
+ * Insert or update a mapping of a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to insert
+ * @param hash Hash of the key
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t assign_hashed(hashmap_t ht, void* key, uint64_t hash, void* val)
+{
+    /* The value of a multimap key is its run, no caller can size it */
+    if (ht->run_size) return ERR_INVALID_OPERATION;
+    if (ht->rcu) return rcu_assign(ht, key, hash, val);
+    void* elem;
+    int created;
+    stat_t stat = emplace_hashed(ht, key, hash, &elem, &created);
+    if (stat) return stat;
+    memcpy(elem, val, ht->elem_size);
+    return COMPLETE;
+}
+
+/**
+ * Remove a mapping of a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t remove_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    if (ht->rcu) return rcu_remove(ht, key, hash, ret_val);
+    if (ht->mapped) return ERR_INVALID_OPERATION;
+    /* The values of a multimap key go with it */
+    hashmap_run_t run;
+    if (ht->run_size) {
+        if (ret_val) return ERR_INVALID_OPERATION;
+        ret_val = &run;
+    }
+    stats_op(ht, HASHMAP_OP_REMOVE);
+    if (ht->filter && !filter_check(ht, hash)) {
+        stats_filter(ht, filter_rejects);
+        return ERR_INVALID_OPERATION;
+    }
+    stat_t stat;
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        stat = swiss_remove(ht, key, hash, ret_val);
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        stat = robin_remove(ht, key, hash, ret_val);
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        stat = ordered_remove(ht, key, hash, ret_val);
+    } else {
+        stat = chain_remove(ht, key, hash, ret_val);
+    }
+    if (stat != COMPLETE) return stat;
+    if (ht->run_size) run_free(ht, &run);
+    if (ht->filter) filter_remove(ht);
+    hashmap_shrink_check(ht);
+    return COMPLETE;
+}
+
+/**
+ * Query a mapping of a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to query
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return, can be NULL
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t query_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    if (ht->run_size) return ERR_INVALID_OPERATION;
+    if (ht->rcu) return rcu_query(ht, key, hash, ret_val);
+    if (ht->mapped) return mapped_query(ht, key, hash, ret_val);
+    void* elem = find_hashed(ht, key, hash);
+    if (!elem) return ERR_INVALID_OPERATION;
+    if (ret_val) memcpy(ret_val, elem, ht->elem_size);
+    return COMPLETE;
+}
+
+/**
+ * Prefetch the memory a lookup of a hash touches first
+ * 
+ * @param ht Hashmap
+ * @param hash Hash of the key
+ */
+static void prefetch_bucket(hashmap_t ht, uint64_t hash)
+{
+    if (ht->rcu) return;
+    if (ht->mapped && ht->mapped->pilots) {
+        uint64_t mix = intmix64(hash, ht->mapped->salt);
+        hashmap_prefetch(&ht->mapped->pilots[frozen_bucket(mix, ht->mapped->pilot_count)]);
+        return;
+    }
+    if (ht->mapped) {
+        hashmap_prefetch(&ht->mapped->buckets[hash & (ht->capacity - 1)]);
+        return;
+    }
+    if (ht->filter) hashmap_prefetch(filter_block(ht, hash));
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        size_t group = (size_t)(hash >> 7) & (ht->capacity / SWISS_GROUP_WIDTH - 1);
+        hashmap_prefetch(ht->ctrl + group * SWISS_GROUP_WIDTH);
+        hashmap_prefetch(swiss_slot(ht, group * SWISS_GROUP_WIDTH));
+        return;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        size_t i = robin_home(ht, hash);
+        hashmap_prefetch(ht->ctrl + i);
+        hashmap_prefetch(robin_slot(ht, i));
+        return;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        hashmap_prefetch(&ordered_index(ht)[hash & (ht->capacity - 1)]);
+        return;
+    }
+    if (ht->old_entries)
+        hashmap_prefetch(&ht->old_entries[hash & (ht->old_capacity - 1)]);
+    hashmap_prefetch(&ht->entries[hash & (ht->capacity - 1)]);
+}
+
+/**
+ * Prefetch the first entry of the chain a hash maps to, once its bucket
+ * has been prefetched
+ * 
+ * @param ht Hashmap
+ * @param hash Hash of the key
+ */
+static void prefetch_entry(hashmap_t ht, uint64_t hash)
+{
+    if (ht->rcu) return;
+    if (ht->mapped && ht->mapped->pilots) {
+        if (ht->mapped->count)
+            hashmap_prefetch(mapped_slot(ht, frozen_index(ht->mapped, hash)));
+        return;
+    }
+    if (ht->mapped) {
+        uint64_t j = ht->mapped->buckets[hash & (ht->capacity - 1)];
+        if (j < ht->mapped->count) hashmap_prefetch(&ht->mapped->hashes[j]);
+        return;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        uint32_t pos = ordered_index(ht)[hash & (ht->capacity - 1)];
+        if (pos != ORDERED_EMPTY && pos != ORDERED_DUMMY)
+            hashmap_prefetch(ordered_slot(ht, pos - 1));
+        return;
+    }
+    if (hashmap_engine(ht) != HASHMAP_CHAINED) return;
+    hashmap_entry_t entry = ht->entries[hash & (ht->capacity - 1)];
+    if (entry) hashmap_prefetch(entry);
+}
+
+/**
+ * Insert or update a mapping into the hashmap
+ * 
+ * @param ht Hashmap
+ * @param key Key to insert
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_assign(hashmap_t ht, void* key, void* val)
+{
+    if (ht->run_size) return ERR_INVALID_OPERATION;
+    if (!key) return null_entry_assign(ht, val);
+    return assign_hashed(ht, key, hashmap_hash(ht, key), val);
+}
+
+/**
+ * Remove a mapping from the hashmap
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove
+ * @param ret_val Pointer to the value to return, NULL for a multimap,
+ *                whose values are freed with the key
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_remove(hashmap_t ht, void* key, void* ret_val)
+{
+    if (!key) return null_entry_remove(ht, ret_val);
+    return remove_hashed(ht, key, hashmap_hash(ht, key), ret_val);
+}
+
+/**
+ * Query a mapping from the hashmap
+ * 
+ * @param ht Hashmap
+ * @param key Key to query
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_query(hashmap_t ht, void* key, void* ret_val)
+{
+    if (ht->run_size) return ERR_INVALID_OPERATION;
+    if (!key) return null_entry_query(ht, ret_val);
+    return query_hashed(ht, key, hashmap_hash(ht, key), ret_val);
+}
+
+/**
+ * Find the value stored for a key, to read or modify it in place
+ * 
+ * The pointer stays valid until the mapping is removed for the chained
+ * engine, and until the next insertion or removal for open addressing.
+ * A HASHMAP_LOCKFREE_READ hashmap hands out no pointers, since a value
+ * may be freed under its reader, nor does a read-only one loaded by
+ * hashmap_load_mmap or frozen: use hashmap_query there
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @return Pointer to the stored value, NULL if the key is not found or
+ *         the hashmap does not support the call
+ */
+void* hashmap_find(hashmap_t ht, void* key)
+{
+    if (ht->run_size || ht->rcu || ht->mapped) return NULL;
+    if (!key) return ht->null_elem;
+    return find_hashed(ht, key, hashmap_hash(ht, key));
+}
+
+/**
+ * Find the value stored for a key, inserting a zero-filled value if the
+ * key is not in the hashmap, with a single hash and probe
+ * 
+ * The pointer has the same lifetime as the one of hashmap_find, and the
+ * call is as unsupported as hashmap_find on a HASHMAP_LOCKFREE_READ
+ * hashmap, where hashmap_assign inserts instead, and on a read-only one
+ * 
+ * @param ht Hashmap
+ * @param key Key to find or insert
+ * @param created Pointer to set to 1 if the key is inserted, 0 otherwise,
+ *                can be NULL
+ * @return Pointer to the stored value, NULL on allocation failure or if
+ *         the hashmap does not support the call
+ */
+void* hashmap_emplace(hashmap_t ht, void* key, int* created)
+{
+    if (ht->run_size) return NULL;
+    void* elem;
+    int inserted;
+    stat_t stat = key ?
+        emplace_hashed(ht, key, hashmap_hash(ht, key), &elem, &inserted) :
+        null_entry_emplace(ht, &elem, &inserted);
+    if (stat) return NULL;
+
+    if (inserted) memset(elem, 0, ht->elem_size);
+    if (created) *created = inserted;
+    return elem;
+}
+
+/**
+ * Insert a value, or fold it into the value already mapped to its key,
+ * with a single lookup
+ * 
+ * @param ht Hashmap
+ * @param key Key to aggregate under
+ * @param val Value to insert or fold in
+ * @param combine_fn Function folding the value (second argument) into the
+ *                   mapped one (first argument)
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_aggregate(hashmap_t ht,
+                         void* key,
+                         void* val,
+                         void (*combine_fn)(void*, const void*))
+{
+    if (ht->run_size) return ERR_INVALID_OPERATION;
+    if (!key) {
+        void* elem;
+        int created;
+        stat_t stat = null_entry_emplace(ht, &elem, &created);
+        if (stat) return stat;
+        if (created) {
+            memcpy(elem, val, ht->elem_size);
+        } else {
+            combine_fn(elem, val);
+        }
+        return COMPLETE;
+    }
+    return aggregate_hashed(ht, key, hashmap_hash(ht, key), val, combine_fn);
+}
+
+/**
+ * Insert a value, or fold it into the value already mapped to a hashed key
+ * 
+ * @param ht Hashmap
+ * @param key Key to aggregate under
+ * @param hash Hash of the key
+ * @param val Value to insert or fold in
+ * @param combine_fn Function folding the value into the mapped one
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t aggregate_hashed(hashmap_t ht,
+                               void* key,
+                               uint64_t hash,
+                               const void* val,
+                               void (*combine_fn)(void*, const void*))
+{
+    void* elem;
+    int created;
+    stat_t stat = emplace_hashed(ht, key, hash, &elem, &created);
+    if (stat) return stat;
+    if (created) {
+        memcpy(elem, val, ht->elem_size);
+    } else {
+        combine_fn(elem, val);
+    }
+    return COMPLETE;
+}
+
+/**
+ * Create empty partial hashmaps to aggregate into, one per thread, configured
+ * like the hashmap they are merged back into with hashmap_merge
+ * 
+ * @param ht Hashmap the partials are merged into
+ * @param partials Array receiving n partial hashmaps
+ * @param n Number of partials
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_partials(hashmap_t ht, hashmap_t* partials, size_t n)
+{
+    if (ht->rcu || ht->mapped || ht->run_size) return ERR_INVALID_OPERATION;
+    for (size_t i = 0; i < n; i++) {
+        partials[i] = _hashmap_init_like(ht, HASHMAP_MIN_CAPACITY);
+        if (!partials[i]) {
+            while (i--) hashmap_deinit(partials[i]);
+            return ERR_MEMORY_ALLOCATION;
+        }
+    }
+    return COMPLETE;
+}
+
+/**
+ * Merge partial hashmaps into a hashmap and free them, folding the values
+ * of keys found in several of them
+ * 
+ * Partials from hashmap_partials of a chained hashmap are merged on the
+ * threads set with hashmap_set_threads, each thread taking the same range
+ * of buckets in every partial; their entries are moved rather than copied.
+ * Values of a key are folded in the order of the partials; multimaps can not
+ * be merged
+ * 
+ * @param ht Hashmap
+ * @param partials Array of n partial hashmaps, with the layout, hash function
+ *                 and seed of the hashmap
+ * @param n Number of partials
+ * @param combine_fn Function folding a value (second argument) into the
+ *                   mapped one (first argument)
+ * @return COMPLETE on success, corresponding error code on failure; the
+ *         partials are only freed on success, holding what was not merged
+ */
+stat_t hashmap_merge(hashmap_t ht,
+                     hashmap_t* partials,
+                     size_t n,
+                     void (*combine_fn)(void*, const void*))
+{
+    if (ht->rcu || ht->mapped || ht->run_size) return ERR_INVALID_OPERATION;
+    for (size_t p = 0; p < n; p++) {
+        hashmap_t part = partials[p];
+        if (part == ht || part->rcu || part->mapped || part->run_size ||
+            !_hashmap_compatible(ht, part) || part->elem_size != ht->elem_size ||
+            part->hash_fn != ht->hash_fn || part->seeded_hash_fn != ht->seeded_hash_fn ||
+            part->seed != ht->seed ||
+            (part->flags & HASHMAP_HASH_MASK) != (ht->flags & HASHMAP_HASH_MASK))
+            return ERR_INVALID_OPERATION;
+    }
+
+    for (size_t p = 0; p < n; p++) {
+        hashmap_t part = partials[p];
+        if (part->null_elem) {
+            stat_t stat = hashmap_aggregate(ht, NULL, part->null_elem, combine_fn);
+            if (stat) return stat;
+            null_entry_remove(part, NULL);
+        }
+    }
+
+    /* Room for every mapping, so the moves never resize */
+    size_t total = ht->size;
+    for (size_t p = 0; p < n; p++)
+        total += partials[p]->size;
+    stat_t stat = COMPLETE;
+    if (hashmap_engine(ht) == HASHMAP_CHAINED) {
+        size_t capacity = ht->capacity;
+        while (capacity < HASHMAP_MAX_CAPACITY >> 1 && total >= capacity * HASHMAP_LOAD_THRESHOLD)
+            capacity <<= 1;
+        if (capacity > ht->capacity) stat = hashmap_resize(ht, capacity);
+    }
+    if (stat) return stat;
+
+    if (!merge_parallel(ht, partials, n, combine_fn)) {
+        for (size_t p = 0; p < n; p++) {
+            hashmap_iter_t it;
+            void* key;
+            void* val;
+            hashmap_iter_init(&it, partials[p]);
+            while (hashmap_iter_next(&it, &key, &val)) {
+                uint64_t hash;
+                iter_slot(&it, &hash);
+                stat = aggregate_hashed(ht, key, hash, val, combine_fn);
+                if (stat) return stat;
+                hashmap_iter_remove(&it, NULL);
+            }
+        }
+    }
+    for (size_t p = 0; p < n; p++)
+        hashmap_deinit(partials[p]);
+    return COMPLETE;
+}
+
+/**
+ * Merge chained partials on several threads when the hashmaps allow it
+ * 
+ * @param ht Hashmap, with room for every mapping of the partials
+ * @param partials Array of n partial hashmaps
+ * @param n Number of partials
+ * @param combine_fn Function folding a value into the mapped one
+ * @return 1 if the partials were merged and emptied, 0 if they are left
+ *         to the serial merge
+ */
+static int merge_parallel(hashmap_t ht,
+                          hashmap_t* partials,
+                          size_t n,
+                          void (*combine_fn)(void*, const void*))
+{
+    /* The moved entries must be freed by the same allocator, and their keys
+     * must not live in another arena */
+    unsigned plain = HASHMAP_ENGINE_MASK | HASHMAP_INCREMENTAL | HASHMAP_CHAIN_GUARD |
+                     HASHMAP_STRING_KEYS | HASHMAP_LOCKFREE_READ | HASHMAP_FILTER;
+    if (ht->flags & plain) return 0;
+    size_t small = ht->capacity;
+    size_t total = 0;
+    for (size_t p = 0; p < n; p++) {
+        hashmap_t part = partials[p];
+        if ((part->flags & plain) || part->slab || part->old_entries ||
+            part->alloc_fn != ht->alloc_fn || part->free_fn != ht->free_fn)
+            return 0;
+        if (part->capacity < small) small = part->capacity;
+        total += part->size;
+    }
+    size_t threads = parallel_threads(ht, total);
+    if (threads > small / 64) threads = small / 64;
+    if (threads < 2) return 0;
+
+    hashmap_merge_task_t tasks[HASHMAP_MAX_THREADS];
+    size_t share = (small / 64 + threads - 1) / threads * 64;
+    for (size_t t = 0; t < threads; t++) {
+        tasks[t].ht = ht;
+        tasks[t].partials = partials;
+        tasks[t].n = n;
+        tasks[t].small = small;
+        tasks[t].begin = t * share < small ? t * share : small;
+        tasks[t].end = t + 1 == threads || (t + 1) * share > small ? small : (t + 1) * share;
+        tasks[t].inserted = 0;
+        tasks[t].combine_fn = combine_fn;
+    }
+    parallel_run(merge_slice, tasks, sizeof(tasks[0]), threads);
+    for (size_t t = 0; t < threads; t++)
+        ht->size += tasks[t].inserted;
+    for (size_t p = 0; p < n; p++)
+        partials[p]->size = 0;
+    return 1;
+}
+
+/**
+ * Move the entries of a share of the buckets of every partial into the
+ * hashmap, folding those whose key is already there
+ * 
+ * @param arg Merge task
+ */
+static void merge_slice(void* arg)
+{
+    hashmap_merge_task_t* task = (hashmap_merge_task_t*)arg;
+    hashmap_t ht = task->ht;
+    for (size_t p = 0; p < task->n; p++) {
+        hashmap_t part = task->partials[p];
+        for (size_t base = 0; base < part->capacity; base += task->small) {
+            for (size_t i = base + task->begin; i < base + task->end; i++) {
+                hashmap_entry_t entry = part->entries[i];
+                part->entries[i] = NULL;
+                while (entry) {
+                    hashmap_entry_t next = entry->next;
+                    size_t j = entry->hash & (ht->capacity - 1);
+                    hashmap_entry_t found = ht->entries[j];
+                    while (found && (found->hash != entry->hash ||
+                                     !key_match(ht, entry_key(found), entry_key(entry))))
+                        found = found->next;
+                    if (found) {
+                        task->combine_fn(entry_elem(ht, found), entry_elem(ht, entry));
+                        entry_free(part, entry);
+                    } else {
+                        entry->next = ht->entries[j];
+                        ht->entries[j] = entry;
+                        bucket_mark(ht->entries, ht->capacity, j);
+                        task->inserted++;
+                    }
+                    entry = next;
+                }
+            }
+        }
+    }
+}
+/**
+ * Insert or update a batch of mappings into the hashmap
+ * 
+ * The keys of a block are hashed and their buckets prefetched before
+ * any of them is resolved, so the cache misses of the block overlap
+ * 
+ * @param ht Hashmap
+ * @param keys Array of n keys
+ * @param vals Array of n values
+ * @param n Number of mappings
+ * @param stats Array receiving the status of each mapping, can be NULL
+ * @return Number of mappings inserted or updated
+ */
+size_t hashmap_assign_batch(hashmap_t ht,
+                            void* keys,
+                            void* vals,
+                            size_t n,
+                            stat_t* stats)
+{
+    uint64_t hashes[HASHMAP_BATCH];
+    size_t count = 0;
+
+    for (size_t base = 0; base < n; base += HASHMAP_BATCH) {
+        size_t m = n - base < HASHMAP_BATCH ? n - base : HASHMAP_BATCH;
+        char* key = (char*)keys + base * ht->key_len;
+        char* val = (char*)vals + base * ht->elem_size;
+
+        for (size_t j = 0; j < m; j++) {
+            hashes[j] = hashmap_hash(ht, key + j * ht->key_len);
+            prefetch_bucket(ht, hashes[j]);
+        }
+        for (size_t j = 0; j < m; j++)
+            prefetch_entry(ht, hashes[j]);
+        for (size_t j = 0; j < m; j++) {
+            stat_t stat = assign_hashed(ht,
+                                        key + j * ht->key_len,
+                                        hashes[j],
+                                        val + j * ht->elem_size);
+            if (stats) stats[base + j] = stat;
+            if (stat == COMPLETE) count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Query a batch of mappings from the hashmap
+ * 
+ * The keys of a block are hashed and their buckets prefetched before
+ * any of them is resolved, so the cache misses of the block overlap
+ * 
+ * @param ht Hashmap
+ * @param keys Array of n keys
+ * @param ret_vals Array receiving n values, left untouched for missing keys
+ * @param n Number of keys
+ * @param stats Array receiving the status of each key, can be NULL
+ * @return Number of keys found
+ */
+size_t hashmap_query_batch(hashmap_t ht,
+                           void* keys,
+                           void* ret_vals,
+                           size_t n,
+                           stat_t* stats)
+{
+    uint64_t hashes[HASHMAP_BATCH];
+    size_t count = 0;
+
+    for (size_t base = 0; base < n; base += HASHMAP_BATCH) {
+        size_t m = n - base < HASHMAP_BATCH ? n - base : HASHMAP_BATCH;
+        char* key = (char*)keys + base * ht->key_len;
+        char* ret_val = (char*)ret_vals + base * ht->elem_size;
+
+        for (size_t j = 0; j < m; j++) {
+            hashes[j] = hashmap_hash(ht, key + j * ht->key_len);
+            prefetch_bucket(ht, hashes[j]);
+        }
+        for (size_t j = 0; j < m; j++)
+            prefetch_entry(ht, hashes[j]);
+        for (size_t j = 0; j < m; j++) {
+            stat_t stat = query_hashed(ht,
+                                       key + j * ht->key_len,
+                                       hashes[j],
+                                       ret_val + j * ht->elem_size);
+            if (stats) stats[base + j] = stat;
+            if (stat == COMPLETE) count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * Hash a key the way the hashmap does, for callers that route or
+ * cache by hash before calling the *_hashed functions
+ * 
+ * @param ht Hashmap
+ * @param key Key to hash, not NULL
+ * @return Hash of the key
+ */
+uint64_t _hashmap_hash(hashmap_t ht, void* key)
+{
+    return hashmap_hash(ht, key);
+}
+
+/**
+ * Find the value stored for a key whose hash is already known
+ * 
+ * @param ht Hashmap
+ * @param key Key to find, not NULL
+ * @param hash Hash of the key from _hashmap_hash
+ * @return Pointer to the stored value, NULL if the key is not found
+ */
+void* _hashmap_find_hashed(hashmap_t ht, void* key, uint64_t hash)
+{
+    return find_hashed(ht, key, hash);
+}
+
+/**
+ * Find or insert the value slot of a key whose hash is already known,
+ * an inserted value is left uninitialized
+ * 
+ * @param ht Hashmap
+ * @param key Key to find or insert, not NULL
+ * @param hash Hash of the key from _hashmap_hash
+ * @param created Pointer to set to 1 if the key is inserted, 0 otherwise
+ * @return Pointer to the stored value, NULL on failure
+ */
+void* _hashmap_emplace_hashed(hashmap_t ht, void* key, uint64_t hash, int* created)
+{
+    void* elem;
+    return emplace_hashed(ht, key, hash, &elem, created) ? NULL : elem;
+}
+
+/**
+ * Get the stored key of a value slot
+ * 
+ * @param ht Hashmap without HASHMAP_STRING_KEYS
+ * @param elem Value slot returned by a find or emplace, not of NULL
+ * @return Pointer to the key stored with the value
+ */
+void* _hashmap_elem_key(hashmap_t ht, void* elem)
+{
+    return (char*)elem - ht->elem_offset;
+}
+
+/**
+ * Insert or update a mapping whose key hash is already known
+ * 
+ * @param ht Hashmap
+ * @param key Key to insert, not NULL
+ * @param hash Hash of the key from _hashmap_hash
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t _hashmap_assign_hashed(hashmap_t ht, void* key, uint64_t hash, void* val)
+{
+    return assign_hashed(ht, key, hash, val);
+}
+
+/**
+ * Remove a mapping whose key hash is already known
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove, not NULL
+ * @param hash Hash of the key from _hashmap_hash
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t _hashmap_remove_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    return remove_hashed(ht, key, hash, ret_val);
+}
+
+/**
+ * Query a mapping whose key hash is already known
+ * 
+ * @param ht Hashmap
+ * @param key Key to query, not NULL
+ * @param hash Hash of the key from _hashmap_hash
+ * @param ret_val Pointer to the value to return, can be NULL
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t _hashmap_query_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    return query_hashed(ht, key, hash, ret_val);
+}
+
+/**
+ * Initialize an empty hashmap configured like another one, with the same
+ * layout, callbacks, hash function and seed
+ * 
+ * @param ht Hashmap to take the configuration from
+ * @param capacity Initial capacity of the hashmap
+ * @return Initialized hashmap on success, NULL on failure
+ */
+hashmap_t _hashmap_init_like(hashmap_t ht, size_t capacity)
+{
+    hashmap_t like = _hashmap_init(capacity,
+                                   ht->key_len,
+                                   ht->elem_size,
+                                   ht->flags,
+                                   ht->hash_fn,
+                                   ht->cmp_fn,
+                                   ht->alloc_fn,
+                                   ht->free_fn);
+    if (!like) return NULL;
+    like->seeded_hash_fn = ht->seeded_hash_fn;
+    like->seed = ht->seed;
+    like->low_water = ht->low_water;
+    like->threads = ht->threads;
+    return like;
+}
+
+/**
+ * Check if the keys of two hashmaps can be looked up in each other
+ * 
+ * @param a Hashmap
+ * @param b Hashmap
+ * @return 1 if both store keys of the same length and kind, 0 otherwise
+ */
+int _hashmap_compatible(hashmap_t a, hashmap_t b)
+{
+    return a->key_len == b->key_len && hashmap_strkeys(a) == hashmap_strkeys(b);
+}
+
+/**
+ * Copy a hashmap
+ * 
+ * The copy has the capacity, seed and layout of the source, stored hashes
+ * are reused and slots are copied in bulk, so no key is hashed or compared
+ * 
+ * @param dst Pointer to the destination hashmap
+ * @param src Source hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_copy(hashmap_t* dst, hashmap_t src)
+{
+    rcu_lock(src);
+    stat_t stat = copy_mappings(dst, src);
+    rcu_unlock(src);
+    if (stat) return stat;
+    /* Set once the copy owns no block of the source */
+    (*dst)->run_size = src->run_size;
+    if (src->run_size) stat = run_copy(*dst);
+    if (!stat && (*dst)->filter) stat = filter_copy(*dst, src);
+    if (stat) hashmap_deinit(*dst);
+    return stat;
+}
+
+/**
+ * Copy the mappings of a hashmap into a new one with the same settings
+ * 
+ * @param dst Pointer to the destination hashmap
+ * @param src Source hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t copy_mappings(hashmap_t* dst, hashmap_t src)
+{
+    hashmap_t ht = _hashmap_init(src->capacity,
+                                 src->key_len,
+                                 src->elem_size,
+                                 src->flags,
+                                 src->hash_fn,
+                                 src->cmp_fn,
+                                 src->alloc_fn,
+                                 src->free_fn);
+    if (!ht) return ERR_MEMORY_ALLOCATION;
+    ht->seeded_hash_fn = src->seeded_hash_fn;
+    ht->seed = src->seed;
+    ht->low_water = src->low_water;
+    ht->threads = src->threads;
+    ht->reseed_capacity = src->reseed_capacity;
+    *dst = ht;
+
+    if (src->null_elem && null_entry_assign(ht, src->null_elem)) {
+        hashmap_deinit(ht);
+        return ERR_MEMORY_ALLOCATION;
+    }
+    /* Stored string keys are offsets into the arena, so it is copied as is */
+    if (src->arena) {
+        void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+        ht->arena = alloc(src->arena_capacity);
+        if (!ht->arena) {
+            hashmap_deinit(ht);
+            return ERR_MEMORY_ALLOCATION;
+        }
+        stats_alloc(ht, src->arena_capacity);
+        memcpy(ht->arena, src->arena, src->arena_used);
+        ht->arena_used = src->arena_used;
+        ht->arena_dead = src->arena_dead;
+        ht->arena_capacity = src->arena_capacity;
+    }
+
+    /* Same capacity and hashes, so every slot and chain keeps its place */
+    if (src->mapped && src->mapped->pilots) {
+        for (size_t j = 0; j < src->mapped->count; j++) {
+            hashmap_entry_t clone;
+            if (entry_alloc(ht, &clone)) {
+                hashmap_deinit(ht);
+                return ERR_MEMORY_ALLOCATION;
+            }
+            size_t i = src->mapped->hashes[j] & (ht->capacity - 1);
+            memcpy(entry_key(clone), mapped_slot(src, j), src->slot_size);
+            clone->hash = src->mapped->hashes[j];
+            clone->next = ht->entries[i];
+            ht->entries[i] = clone;
+            bucket_mark(ht->entries, ht->capacity, i);
+            ht->size++;
+        }
+        return COMPLETE;
+    }
+    if (src->mapped) {
+        const uint64_t* buckets = src->mapped->buckets;
+        for (size_t i = 0; i < src->capacity; i++) {
+            hashmap_entry_t* tail = &ht->entries[i];
+            uint64_t end = buckets[i + 1] < src->mapped->count ? buckets[i + 1] : src->mapped->count;
+            for (uint64_t j = buckets[i]; j < end; j++) {
+                hashmap_entry_t clone;
+                if (entry_alloc(ht, &clone)) {
+                    hashmap_deinit(ht);
+                    return ERR_MEMORY_ALLOCATION;
+                }
+                memcpy(entry_key(clone), mapped_slot(src, j), src->slot_size);
+                clone->hash = src->mapped->hashes[j];
+                *tail = clone;
+                tail = &clone->next;
+                ht->size++;
+            }
+            if (ht->entries[i]) bucket_mark(ht->entries, ht->capacity, i);
+        }
+        return COMPLETE;
+    }
+    if (hashmap_engine(src) == HASHMAP_SWISS) {
+        memcpy(ht->ctrl, src->ctrl, src->capacity + src->capacity * src->slot_size);
+        ht->growth_left = src->growth_left;
+        ht->size = src->size;
+        return COMPLETE;
+    }
+    if (hashmap_engine(src) == HASHMAP_ROBIN) {
+        memcpy(ht->ctrl, src->ctrl, robin_end(src));
+        memcpy(ht->slots, src->slots, robin_end(src) * src->hashed_stride);
+        ht->growth_left = src->growth_left;
+        ht->size = src->size;
+        return COMPLETE;
+    }
+    if (hashmap_engine(src) == HASHMAP_ORDERED) {
+        memcpy(ht->ctrl, src->ctrl, ordered_head(src->capacity));
+        memcpy(ht->slots, src->slots, ordered_used(src) * src->hashed_stride);
+        ht->growth_left = src->growth_left;
+        ht->size = src->size;
+        return COMPLETE;
+    }
+    size_t entry_size = sizeof(hashmap_entry_s) + src->slot_size;
+    for (size_t i = bucket_next(src->entries, src->capacity, 0);
+         i < src->capacity;
+         i = bucket_next(src->entries, src->capacity, i + 1)) {
+        hashmap_entry_t* tail = &ht->entries[i];
+        for (hashmap_entry_t entry = src->entries[i]; entry; entry = entry->next) {
+            hashmap_entry_t clone;
+            if (entry_alloc(ht, &clone)) {
+                hashmap_deinit(ht);
+                return ERR_MEMORY_ALLOCATION;
+            }
+            memcpy(clone, entry, entry_size);
+            clone->next = NULL;
+            *tail = clone;
+            tail = &clone->next;
+            ht->size++;
+        }
+        bucket_mark(ht->entries, ht->capacity, i);
+    }
+    /* The buckets a resize in progress has yet to move are spread into the
+     * copy by their hashes, the source is left mid-resize */
+    for (size_t i = src->rehash_idx; i < src->old_capacity; i++) {
+        for (hashmap_entry_t entry = src->old_entries[i]; entry; entry = entry->next) {
+            hashmap_entry_t clone;
+            if (entry_alloc(ht, &clone)) {
+                hashmap_deinit(ht);
+                return ERR_MEMORY_ALLOCATION;
+            }
+            memcpy(clone, entry, entry_size);
+            size_t j = entry->hash & (ht->capacity - 1);
+            clone->next = ht->entries[j];
+            ht->entries[j] = clone;
+            bucket_mark(ht->entries, ht->capacity, j);
+            ht->size++;
+        }
+    }
+    return COMPLETE;
+}
+
+/**
+ * Map a function over the key-value pairs of the hashmap
+ * 
+ * @param ht Hashmap
+ * @param fn Function to map
+ */
+void hashmap_map(hashmap_t ht, void (*fn)(void*, void*))
+{
+    hashmap_iter_t it;
+    void* key;
+    void* val;
+    rcu_lock(ht);
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, &val))
+        fn(key, val);
+    rcu_unlock(ht);
+}
+
+/**
+ * Map a function over the keys of the hashmap
+ * 
+ * @param ht Hashmap
+ * @param fn Function to map
+ */
+void hashmap_key_map(hashmap_t ht, void (*fn)(void*))
+{
+    hashmap_iter_t it;
+    void* key;
+    rcu_lock(ht);
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, NULL))
+        fn(key);
+    rcu_unlock(ht);
+}
+
+/**
+ * Map a function over the values of the hashmap
+ * 
+ * @param ht Hashmap
+ * @param fn Function to map
+ */
+void hashmap_val_map(hashmap_t ht, void (*fn)(void*))
+{
+    hashmap_iter_t it;
+    void* val;
+    rcu_lock(ht);
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &val))
+        fn(val);
+    rcu_unlock(ht);
+}
+
+/**
+ * Initialize a cursor over the mappings of the hashmap
+ * 
+ * Empty buckets and slots are skipped a word of the occupancy bitmap or a
+ * group of control bytes at a time, so a walk costs time in the size of the
+ * hashmap rather than its capacity; the ordered engine is walked in insertion
+ * order. An incremental resize in progress is left as it is, the old table
+ * is walked before the new one. Inserting into the hashmap invalidates the
+ * cursor, and so does hashmap_remove while an incremental resize is in
+ * progress as it moves buckets; lookups and removing the current mapping
+ * through hashmap_iter_remove do not. On a HASHMAP_LOCKFREE_READ hashmap the
+ * cursor reads the buckets with plain loads outside any epoch section, so it
+ * must not run alongside writers; hashmap_map, hashmap_key_map and
+ * hashmap_val_map hold the writer lock and can
+ * 
+ * @param it Cursor to initialize
+ * @param ht Hashmap
+ */
+void hashmap_iter_init(hashmap_iter_t* it, hashmap_t ht)
+{
+    it->ht = ht;
+    it->link = NULL;
+    it->index = 0;
+    it->state = ITER_START;
+}
+
+/**
+ * Advance a cursor to the next mapping, NULL comes first if it is mapped
+ * 
+ * @param it Cursor
+ * @param key Pointer to the key to return, can be NULL
+ * @param val Pointer to the value to return, can be NULL
+ * @return 1 if the cursor is at a mapping, 0 once every mapping was visited
+ */
+int hashmap_iter_next(hashmap_iter_t* it, void** key, void** val)
+{
+    hashmap_t ht = it->ht;
+    size_t i = 0;
+    if (it->state == ITER_END) return 0;
+    if (it->state == ITER_START && ht->null_elem) {
+        it->state = ITER_NULL;
+        if (key) *key = NULL;
+        if (val) *val = ht->null_elem;
+        return 1;
+    }
+
+    if (it->state == ITER_TABLE || it->state == ITER_REMOVED) {
+        i = it->index + 1;
+        /* Finish the chain first, a removal already moved the next entry into the link */
+        if (hashmap_engine(ht) == HASHMAP_CHAINED && !ht->mapped) {
+            hashmap_entry_t* link = it->link;
+            if (it->state == ITER_TABLE) link = &(*link)->next;
+            if (*link) {
+                it->link = link;
+                it->state = ITER_TABLE;
+                return iter_emit(it, key, val);
+            }
+        }
+    }
+
+    /* A snapshot has no empty slots to skip */
+    size_t end = ht->capacity;
+    if (ht->mapped) {
+        end = ht->mapped->count;
+    } else if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        i = swiss_next(ht, i);
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        /* A removal shifted the next mapping back into the slot */
+        if (it->state == ITER_REMOVED) i--;
+        end = robin_end(ht);
+        i = robin_next(ht, i);
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        end = ordered_used(ht);
+        i = ordered_next(ht, i);
+    } else {
+        /* Mid-resize the old table is walked first, its buckets are numbered
+         * before those of the new table and the moved ones are skipped */
+        end = ht->old_capacity + ht->capacity;
+        if (i < ht->old_capacity) {
+            if (i < ht->rehash_idx) i = ht->rehash_idx;
+            i = bucket_next(ht->old_entries, ht->old_capacity, i);
+            if (i < ht->old_capacity) it->link = &ht->old_entries[i];
+        }
+        if (i >= ht->old_capacity) {
+            size_t j = bucket_next(ht->entries, ht->capacity, i - ht->old_capacity);
+            i = ht->old_capacity + j;
+            if (j < ht->capacity) it->link = &ht->entries[j];
+        }
+    }
+    if (i >= end) {
+        it->state = ITER_END;
+        return 0;
+    }
+    it->index = i;
+    it->state = ITER_TABLE;
+    return iter_emit(it, key, val);
+}
+
+/**
+ * Return the mapping a cursor is at
+ * 
+ * @param it Cursor at an entry or slot
+ * @param key Pointer to the key to return, can be NULL
+ * @param val Pointer to the value to return, can be NULL
+ * @return 1
+ */
+static int iter_emit(hashmap_iter_t* it, void** key, void** val)
+{
+    char* stored = iter_slot(it, NULL);
+    if (key) *key = key_load(it->ht, stored, &it->view);
+    if (val) *val = stored + it->ht->elem_offset;
+    return 1;
+}
+
+/**
+ * Get the stored key and value of the mapping a cursor is at
+ * 
+ * @param it Cursor at an entry or slot
+ * @param hash Pointer to the hash of the key to return, can be NULL
+ * @return Key storage, followed by the value at elem_offset
+ */
+static char* iter_slot(hashmap_iter_t* it, uint64_t* hash)
+{
+    hashmap_t ht = it->ht;
+    if (ht->mapped) {
+        if (hash) *hash = ht->mapped->hashes[it->index];
+        return (char*)mapped_slot(ht, it->index);
+    }
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        char* slot = swiss_slot(ht, it->index);
+        if (hash) {
+            hashmap_str_t view;
+            *hash = hashmap_hash(ht, key_load(ht, slot, &view));
+        }
+        return slot;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        if (hash) *hash = robin_hash(ht, it->index);
+        return robin_slot(ht, it->index);
+    }
+    if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        if (hash) *hash = ordered_hash(ht, it->index);
+        return ordered_slot(ht, it->index);
+    }
+    hashmap_entry_t entry = *(hashmap_entry_t*)it->link;
+    if (hash) *hash = entry->hash;
+    return entry_key(entry);
+}
+
+/**
+ * Remove the mapping a cursor is at, the cursor moves on with the next call
+ * to hashmap_iter_next; the hashmap never shrinks under a cursor
+ * 
+ * @param it Cursor
+ * @param ret_val Pointer to the value to return, can be NULL, must be for a multimap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_iter_remove(hashmap_iter_t* it, void* ret_val)
+{
+    hashmap_t ht = it->ht;
+    if (ht->mapped) return ERR_INVALID_OPERATION;
+    if (it->state == ITER_NULL) return null_entry_remove(ht, ret_val);
+    if (it->state != ITER_TABLE) return ERR_INVALID_OPERATION;
+    if (ht->run_size) {
+        if (ret_val) return ERR_INVALID_OPERATION;
+        run_free(ht, (hashmap_run_t*)(iter_slot(it, NULL) + ht->elem_offset));
+    }
+
+    it->state = ITER_REMOVED;
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        swiss_erase(ht, it->index, ret_val);
+    } else if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        robin_erase(ht, it->index, ret_val);
+    } else if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        ordered_erase(ht, ordered_locate(ht, it->index), ret_val);
+    } else if (ht->rcu) {
+        rcu_lock(ht);
+        rcu_unlink(ht, it->link, ret_val);
+        rcu_unlock(ht);
+    } else {
+        chain_unlink(ht, it->link, ret_val);
+    }
+    if (ht->filter) filter_remove(ht);
+    return COMPLETE;
+}
+
+/**
+ * Free the entries of the hashmap
+ * 
+ * @param ht Hashmap
+ */
+void hashmap_clear(hashmap_t ht)
+{
+    if (ht->mapped) return;
+    if (ht->rcu) {
+        rcu_clear(ht);
+        return;
+    }
+    if (ht->run_size) run_release(ht);
+    if (ht->null_elem) null_entry_remove(ht, NULL);
+    ht->arena_used = 0;
+    ht->arena_dead = 0;
+    if (ht->filter) {
+        memset(ht->filter, 0, ht->filter_blocks * FILTER_BLOCK_WORDS * sizeof(uint64_t));
+        ht->filter_count = 0;
+        ht->filter_dead = 0;
+    }
+    if (hashmap_engine(ht) == HASHMAP_SWISS) {
+        memset(ht->ctrl, SWISS_EMPTY, ht->capacity);
+        ht->growth_left = swiss_max_load(ht->capacity);
+        ht->size = 0;
+        return;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ROBIN) {
+        memset(ht->ctrl, 0, robin_end(ht));
+        ht->growth_left = robin_max_load(ht->capacity);
+        ht->size = 0;
+        return;
+    }
+    if (hashmap_engine(ht) == HASHMAP_ORDERED) {
+        memset(ht->ctrl, 0, ordered_head(ht->capacity));
+        ht->growth_left = ordered_max_load(ht->capacity);
+        ht->size = 0;
+        return;
+    }
+    /* A resize in progress is dropped rather than finished */
+    if (ht->old_entries) {
+        for (size_t i = ht->rehash_idx; i < ht->old_capacity; i++) {
+            hashmap_entry_t entry = ht->old_entries[i];
+            while (entry) {
+                hashmap_entry_t next = entry->next;
+                entry_free(ht, entry);
+                entry = next;
+            }
+        }
+        if (ht->free_fn) {
+            ht->free_fn(ht->old_entries);
+        } else {
+            free(ht->old_entries);
+        }
+        ht->old_entries = NULL;
+        ht->old_capacity = 0;
+    }
+    for (size_t i = 0; i < ht->capacity; i++) {
+        hashmap_entry_t entry = ht->entries[i];
+        while (entry) {
+            hashmap_entry_t next = entry->next;
+            entry_free(ht, entry);
+            entry = next;
+        }
+        ht->entries[i] = NULL;
+    }
+    if (ht->slab) {
+        if (ht->free_fn) {
+            ht->free_fn(ht->slab);
+        } else {
+            free(ht->slab);
+        }
+        ht->slab = NULL;
+        ht->slab_end = NULL;
+    }
+    memset(bucket_bitmap(ht->entries, ht->capacity), 0,
+           bucket_words(ht->capacity) * sizeof(uint64_t));
+    ht->size = 0;
+}
+
+/**
+ * Free the hashmap and its entries
+ * 
+ * @param ht Hashmap
+ */
+void hashmap_deinit(hashmap_t ht)
+{
+    hashmap_release(ht);
+    free(ht);
+}
+
+/**
+ * Free the entries, tables and arena of the hashmap, leaving its settings
+ * 
+ * @param ht Hashmap
+ */
+static void hashmap_release(hashmap_t ht)
+{
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    if (ht->mapped) {
+        if (ht->mapped->image) {
+            dealloc(ht->mapped->image);
+        } else {
+            cat_mmap_close(&ht->mapped->file);
+        }
+        free(ht->mapped);
+        return;
+    }
+    hashmap_clear(ht);
+    if (ht->rcu) {
+        rcu_deinit(ht);
+        return;
+    }
+    void* table = hashmap_engine(ht) == HASHMAP_CHAINED ?
+                  (void*)ht->entries : (void*)ht->ctrl;
+    dealloc(table);
+    if (ht->arena) dealloc(ht->arena);
+    if (ht->filter_mem) dealloc(ht->filter_mem);
+}
+
+/***********************************************************************************
+ * Multimaps
+ * 
+ * A multimap maps a key to any number of values. The slot of a key holds its run:
+ * the values in append order in one block, so a lookup of every value of a key is
+ * a single probe followed by a linear scan. A key is removed with its last value,
+ * and the generic removals free the run of a key along with it.
+ **********************************************************************************/
+
+/**
+ * Initialize a multimap, written with the hashmap_multi_* functions
+ * 
+ * @param capacity Initial capacity of the multimap
+ * @param key_len Length of the key
+ * @param val_size Size of each value
+ * @param flags Same as _hashmap_init, except HASHMAP_LOCKFREE_READ
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized multimap on success, NULL on failure
+ */
+hashmap_t _hashmap_multi_init(size_t capacity,
+                              size_t key_len,
+                              size_t val_size,
+                              unsigned flags,
+                              uint64_t (*hash_fn)(const char*),
+                              int (*cmp_fn)(const void*, const void*),
+                              void* (*alloc_fn)(size_t),
+                              void (*free_fn)(void*))
+{
+    /* Runs change in place, under lock-free readers too */
+    if (val_size == 0 || (flags & HASHMAP_LOCKFREE_READ))
+        return NULL;
+    hashmap_t ht = _hashmap_init(capacity,
+                                 key_len,
+                                 sizeof(hashmap_run_t),
+                                 flags,
+                                 hash_fn,
+                                 cmp_fn,
+                                 alloc_fn,
+                                 free_fn);
+    if (!ht) return NULL;
+    ht->run_size = val_size;
+    return ht;
+}
+
+/**
+ * Append a value to the values of a key in a multimap
+ * 
+ * @param ht Multimap
+ * @param key Key to append to
+ * @param val Value to append, repeated values are kept
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_multi_append(hashmap_t ht, void* key, void* val)
+{
+    if (!ht->run_size) return ERR_INVALID_OPERATION;
+    hashmap_run_t* run;
+    int created;
+    stat_t stat = key ?
+        emplace_hashed(ht, key, hashmap_hash(ht, key), (void**)&run, &created) :
+        null_entry_emplace(ht, (void**)&run, &created);
+    if (stat) return stat;
+    if (created) memset(run, 0, sizeof(*run));
+    if (run->count == run->capacity) {
+        stat = run_grow(ht, run);
+        if (stat) {
+            if (created) hashmap_remove(ht, key, NULL);
+            return stat;
+        }
+    }
+    memcpy(run->values + run->count * ht->run_size, val, ht->run_size);
+    run->count++;
+    return COMPLETE;
+}
+
+/**
+ * Get the values of a key in a multimap
+ * 
+ * The values are contiguous in append order, and the pointer is valid
+ * until the multimap is modified
+ * 
+ * @param ht Multimap
+ * @param key Key to look up
+ * @param count Pointer to the number of values to return, can be NULL
+ * @return Pointer to the first value, NULL if the key is not in the multimap
+ */
+void* hashmap_multi_values(hashmap_t ht, void* key, size_t* count)
+{
+    hashmap_run_t* run = run_find(ht, key);
+    if (count) *count = run ? run->count : 0;
+    return run ? run->values : NULL;
+}
+
+/**
+ * Get the number of values of a key in a multimap
+ * 
+ * @param ht Multimap
+ * @param key Key to look up
+ * @return Number of values, 0 if the key is not in the multimap
+ */
+size_t hashmap_multi_count(hashmap_t ht, void* key)
+{
+    size_t count;
+    hashmap_multi_values(ht, key, &count);
+    return count;
+}
+
+/**
+ * Remove the first value of a key in a multimap equal to a value, the key
+ * goes with its last value
+ * 
+ * @param ht Multimap
+ * @param key Key to remove from
+ * @param val Value to remove, compared bytewise
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if the key does not
+ *         map to the value
+ */
+stat_t hashmap_multi_remove(hashmap_t ht, void* key, void* val)
+{
+    hashmap_run_t* run = run_find(ht, key);
+    if (!run) return ERR_INVALID_OPERATION;
+    size_t size = ht->run_size;
+    for (size_t i = 0; i < run->count; i++) {
+        char* found = run->values + i * size;
+        if (memcmp(found, val, size)) continue;
+        if (run->count == 1) return hashmap_remove(ht, key, NULL);
+        memmove(found, found + size, (run->count - i - 1) * size);
+        run->count--;
+        return COMPLETE;
+    }
+    return ERR_INVALID_OPERATION;
+}
+
+/**
+ * Remove a key and every value of it from a multimap
+ * 
+ * @param ht Multimap
+ * @param key Key to remove
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if the key is not
+ *         in the multimap
+ */
+stat_t hashmap_multi_remove_all(hashmap_t ht, void* key)
+{
+    if (!ht->run_size) return ERR_INVALID_OPERATION;
+    return hashmap_remove(ht, key, NULL);
+}
+
+/**
+ * Find the run of a key in a multimap
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @return Run of the key, NULL if the key is not found or ht is no multimap
+ */
+static hashmap_run_t* run_find(hashmap_t ht, void* key)
+{
+    if (!ht->run_size) return NULL;
+    if (!key) return ht->null_elem;
+    return find_hashed(ht, key, hashmap_hash(ht, key));
+}
+
+/**
+ * Double the room of a run for values
+ * 
+ * @param ht Multimap
+ * @param run Full run
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t run_grow(hashmap_t ht, hashmap_run_t* run)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    size_t capacity = run->capacity ? run->capacity << 1 : 1;
+    if (capacity > SIZE_MAX / 2 / ht->run_size) return ERR_CAPACITY_OVERFLOW;
+    char* values = alloc(capacity * ht->run_size);
+    if (!values) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, capacity * ht->run_size);
+    if (run->values) {
+        memcpy(values, run->values, run->count * ht->run_size);
+        dealloc(run->values);
+    }
+    run->values = values;
+    run->capacity = capacity;
+    return COMPLETE;
+}
+
+/**
+ * Free the values of a run
+ * 
+ * @param ht Multimap
+ * @param run Run of a key
+ */
+static void run_free(hashmap_t ht, hashmap_run_t* run)
+{
+    if (!run->values) return;
+    if (ht->free_fn) {
+        ht->free_fn(run->values);
+    } else {
+        free(run->values);
+    }
+}
+
+/**
+ * Free the runs of every key in the table of a multimap, before it is cleared
+ * 
+ * @param ht Multimap
+ */
+static void run_release(hashmap_t ht)
+{
+    hashmap_iter_t it;
+    void* key;
+    void* val;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, &val))
+        if (key) run_free(ht, val);
+}
+
+/**
+ * Give a copy of a multimap runs of its own, the copied ones still belong
+ * to the source
+ * 
+ * @param ht Copy of a multimap
+ * @return COMPLETE on success, corresponding error code on failure, in which
+ *         case the runs left uncopied are emptied
+ */
+static stat_t run_copy(hashmap_t ht)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    stat_t stat = COMPLETE;
+    hashmap_iter_t it;
+    void* val;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &val)) {
+        hashmap_run_t* run = val;
+        char* values = stat ? NULL : alloc(run->capacity * ht->run_size);
+        if (values) {
+            stats_alloc(ht, run->capacity * ht->run_size);
+            memcpy(values, run->values, run->count * ht->run_size);
+        } else {
+            stat = ERR_MEMORY_ALLOCATION;
+            run->count = 0;
+            run->capacity = 0;
+        }
+        run->values = values;
+    }
+    return stat;
+}
+
+/***********************************************************************************
+ * Membership filter
+ * 
+ * A split block Bloom filter fed from the stored hashes: the high half of a hash
+ * picks a block of one cache line, and the low half sets one bit in each of its
+ * eight words. A lookup of an absent key is mostly answered by that one block,
+ * before the table is touched. Bits can not be cleared, so removals are counted
+ * and the filter is rebuilt from the remaining hashes once they pile up.
+ **********************************************************************************/
+
+/* Odd multipliers spreading the low half of a hash over the words of a block */
+static const uint32_t filter_salt[FILTER_BLOCK_WORDS] = {
+    0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+    0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u,
+};
+
+/**
+ * Estimate the chance that the filter passes the lookup of an absent key
+ * 
+ * @param ht Hashmap
+ * @return False positive rate from the bits set in every block,
+ *         0 without a filter
+ */
+double hashmap_filter_fpr(hashmap_t ht)
+{
+    if (!ht->filter) return 0;
+    double sum = 0;
+    for (size_t b = 0; b < ht->filter_blocks; b++) {
+        const uint64_t* block = ht->filter + b * FILTER_BLOCK_WORDS;
+        double rate = 1;
+        for (size_t w = 0; w < FILTER_BLOCK_WORDS; w++)
+            rate *= (double)popcount64(block[w]) / 64;
+        sum += rate;
+    }
+    return sum / (double)ht->filter_blocks;
+}
+
+/**
+ * Size the filter for a number of keys and fill it with the hashes of the map
+ * 
+ * @param ht Hashmap
+ * @param live Number of keys the filter should hold half full
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t filter_alloc(hashmap_t ht, size_t live)
+{
+    size_t blocks = 1;
+    while (blocks < HASHMAP_MAX_CAPACITY >> 8 && blocks * FILTER_BLOCK_KEYS < live * 2)
+        blocks <<= 1;
+    if (blocks != ht->filter_blocks) {
+        void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+        void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+        /* One block more to start the blocks at a cache line */
+        size_t block_size = FILTER_BLOCK_WORDS * sizeof(uint64_t);
+        if (blocks >= SIZE_MAX / block_size) return ERR_CAPACITY_OVERFLOW;
+        void* mem = alloc((blocks + 1) * block_size);
+        if (!mem) return ERR_MEMORY_ALLOCATION;
+        stats_alloc(ht, (blocks + 1) * block_size);
+        if (ht->filter_mem) dealloc(ht->filter_mem);
+        ht->filter_mem = mem;
+        ht->filter = (uint64_t*)(((uintptr_t)mem + block_size - 1) & ~(uintptr_t)(block_size - 1));
+        ht->filter_blocks = blocks;
+    }
+    filter_fill(ht);
+    return COMPLETE;
+}
+
+/**
+ * Clear the filter and add the hash of every key in the map
+ * 
+ * @param ht Hashmap with a filter
+ */
+static void filter_fill(hashmap_t ht)
+{
+    memset(ht->filter, 0, ht->filter_blocks * FILTER_BLOCK_WORDS * sizeof(uint64_t));
+    ht->filter_count = 0;
+    ht->filter_dead = 0;
+    hashmap_iter_t it;
+    void* key;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, NULL)) {
+        if (!key) continue;
+        uint64_t hash;
+        iter_slot(&it, &hash);
+        filter_set(ht, hash);
+    }
+}
+
+/**
+ * Set the bits of a hash in the filter
+ * 
+ * @param ht Hashmap with a filter
+ * @param hash Hash of the key
+ */
+static void filter_set(hashmap_t ht, uint64_t hash)
+{
+    uint64_t* block = filter_block(ht, hash);
+    for (size_t w = 0; w < FILTER_BLOCK_WORDS; w++)
+        block[w] |= filter_bit(hash, w);
+    ht->filter_count++;
+}
+
+/**
+ * Check if the filter may hold a hash
+ * 
+ * @param ht Hashmap with a filter
+ * @param hash Hash of the key
+ * @return 0 if no key of the hash is in the map, 1 if one may be
+ */
+static int filter_check(hashmap_t ht, uint64_t hash)
+{
+    const uint64_t* block = filter_block(ht, hash);
+    uint64_t miss = 0;
+    for (size_t w = 0; w < FILTER_BLOCK_WORDS; w++)
+        miss |= ~block[w] & filter_bit(hash, w);
+    return miss == 0;
+}
+
+/**
+ * Add the hash of an inserted key, doubling the filter once its blocks are full
+ * 
+ * @param ht Hashmap with a filter
+ * @param hash Hash of the key
+ */
+static void filter_add(hashmap_t ht, uint64_t hash)
+{
+    filter_set(ht, hash);
+    /* A failed rebuild keeps the old filter, only more often wrong */
+    if (ht->filter_count >= ht->filter_blocks * FILTER_BLOCK_KEYS)
+        filter_alloc(ht, ht->size);
+}
+
+/**
+ * Count a removed key, rebuilding the filter once a quarter of its keys are gone
+ * 
+ * @param ht Hashmap with a filter
+ */
+static void filter_remove(hashmap_t ht)
+{
+    ht->filter_dead++;
+    if (ht->filter_dead >= FILTER_MIN_DEAD && ht->filter_dead * 4 > ht->filter_count)
+        filter_alloc(ht, ht->size);
+}
+
+/**
+ * Copy the filter of a hashmap into a copy of it
+ * 
+ * @param ht Copy of src with a filter
+ * @param src Source hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t filter_copy(hashmap_t ht, hashmap_t src)
+{
+    if (!src->filter || src->filter_blocks != ht->filter_blocks)
+        return filter_alloc(ht, ht->size);
+    memcpy(ht->filter, src->filter, src->filter_blocks * FILTER_BLOCK_WORDS * sizeof(uint64_t));
+    ht->filter_count = src->filter_count;
+    ht->filter_dead = src->filter_dead;
+    return COMPLETE;
+}
+
+/***********************************************************************************
+ * Snapshots
+ * 
+ * A snapshot holds the mappings sorted by bucket: a header, the index of the first
+ * mapping of every bucket, the stored hashes, the stored key and value slots, the
+ * string key arena and the value of NULL. Nothing in it is a pointer, so a loaded
+ * hashmap answers queries straight from the read-only mapping of the file. A frozen
+ * snapshot replaces the bucket index with the pilots of hashmap_freeze.
+ **********************************************************************************/
+
+/**
+ * Save the hashmap into a file that hashmap_load_mmap maps back
+ * 
+ * Only hashmaps hashing with a HASHMAP_HASH_* function and comparing keys
+ * bytewise can be saved, and no multimap, the file is tied to the byte order and word size
+ * of the machine; a frozen hashmap is written as it is laid out in memory
+ * 
+ * @param ht Hashmap
+ * @param path Path of the file to write
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashmap_save(hashmap_t ht, const char* path)
+{
+    if (ht->hash_fn || ht->seeded_hash_fn || ht->cmp_fn || ht->run_size)
+        return ERR_INVALID_OPERATION;
+    rcu_lock(ht);
+    stat_t stat = save_mappings(ht, path);
+    rcu_unlock(ht);
+    return stat;
+}
+
+/**
+ * Sort the mappings by bucket and write them out
+ * 
+ * @param ht Hashmap
+ * @param path Path of the file to write
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t save_mappings(hashmap_t ht, const char* path)
+{
+    /* A frozen image already is the file */
+    if (ht->mapped && ht->mapped->pilots) {
+        FILE* fp = fopen(path, "wb");
+        if (!fp) return ERR_FILE_IO;
+        int ok = fwrite(ht->mapped->file.addr, 1, ht->mapped->file.len, fp) == ht->mapped->file.len;
+        return fclose(fp) == 0 && ok ? COMPLETE : ERR_FILE_IO;
+    }
+
+    hashmap_iter_t it;
+    void* key;
+    uint64_t hash;
+    size_t count = ht->size - (ht->null_elem != NULL);
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    while (capacity < count) capacity <<= 1;
+
+    uint64_t* buckets = calloc(capacity + 1, sizeof(uint64_t));
+    uint64_t* hashes = malloc((count ? count : 1) * sizeof(uint64_t));
+    const char** slots = malloc((count ? count : 1) * sizeof(char*));
+    if (!buckets || !hashes || !slots) {
+        free(buckets);
+        free(hashes);
+        free(slots);
+        return ERR_MEMORY_ALLOCATION;
+    }
+
+    /* Counting sort: size the buckets, then place each mapping at the
+     * next free index of its bucket */
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, NULL)) {
+        if (!key) continue;
+        iter_slot(&it, &hash);
+        buckets[(hash & (capacity - 1)) + 1]++;
+    }
+    for (size_t i = 0; i < capacity; i++)
+        buckets[i + 1] += buckets[i];
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, NULL)) {
+        if (!key) continue;
+        const char* slot = iter_slot(&it, &hash);
+        uint64_t j = buckets[hash & (capacity - 1)]++;
+        hashes[j] = hash;
+        slots[j] = slot;
+    }
+    for (size_t i = capacity; i > 0; i--)
+        buckets[i] = buckets[i - 1];
+    buckets[0] = 0;
+
+    hashmap_file_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, HASHMAP_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = HASHMAP_FILE_VERSION;
+    hdr.byte_order = HASHMAP_FILE_BYTE_ORDER;
+    hdr.word_size = sizeof(size_t);
+    hdr.flags = ht->flags & (HASHMAP_HASH_MASK | HASHMAP_STRING_KEYS);
+    hdr.key_len = ht->key_len;
+    hdr.elem_size = ht->elem_size;
+    hdr.elem_offset = ht->elem_offset;
+    hdr.slot_size = ht->slot_size;
+    hdr.seed = ht->seed;
+    hdr.capacity = capacity;
+    hdr.count = count;
+    hdr.buckets_offset = file_align(sizeof(hdr));
+    hdr.hashes_offset = file_align(hdr.buckets_offset + (capacity + 1) * sizeof(uint64_t));
+    hdr.slots_offset = file_align(hdr.hashes_offset + count * sizeof(uint64_t));
+    hdr.arena_offset = file_align(hdr.slots_offset + (uint64_t)count * ht->slot_size);
+    hdr.arena_len = ht->arena ? ht->arena_used : 0;
+    hdr.file_size = hdr.arena_offset + hdr.arena_len;
+    if (ht->null_elem) {
+        hdr.null_offset = file_align(hdr.file_size);
+        hdr.file_size = hdr.null_offset + ht->elem_size;
+    }
+
+    stat_t stat = ERR_FILE_IO;
+    FILE* fp = fopen(path, "wb");
+    if (fp) {
+        uint64_t pos = sizeof(hdr);
+        int ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+        ok = ok && file_pad(fp, &pos, hdr.buckets_offset) &&
+             fwrite(buckets, sizeof(uint64_t), capacity + 1, fp) == capacity + 1;
+        pos += (capacity + 1) * sizeof(uint64_t);
+        ok = ok && file_pad(fp, &pos, hdr.hashes_offset) &&
+             fwrite(hashes, sizeof(uint64_t), count, fp) == count;
+        pos += count * sizeof(uint64_t);
+        ok = ok && file_pad(fp, &pos, hdr.slots_offset);
+        for (size_t j = 0; ok && j < count; j++)
+            ok = fwrite(slots[j], ht->slot_size, 1, fp) == 1;
+        pos += (uint64_t)count * ht->slot_size;
+        ok = ok && file_pad(fp, &pos, hdr.arena_offset) &&
+             (!hdr.arena_len || fwrite(ht->arena, 1, hdr.arena_len, fp) == hdr.arena_len);
+        pos += hdr.arena_len;
+        if (ht->null_elem) {
+            ok = ok && file_pad(fp, &pos, hdr.null_offset) &&
+                 fwrite(ht->null_elem, ht->elem_size, 1, fp) == 1;
+        }
+        if (fclose(fp) == 0 && ok) stat = COMPLETE;
+    }
+    free(buckets);
+    free(hashes);
+    free(slots);
+    return stat;
+}
+
+/**
+ * Write zeros up to an offset
+ * 
+ * @param fp File
+ * @param pos Current offset in the file, updated
+ * @param offset Offset to pad to
+ * @return 1 on success, 0 on failure
+ */
+static int file_pad(FILE* fp, uint64_t* pos, uint64_t offset)
+{
+    static const char zeros[HASHMAP_MAX_ALIGN] = {0};
+    size_t len = (size_t)(offset - *pos);
+    *pos = offset;
+    return fwrite(zeros, 1, len, fp) == len;
+}
+
+/**
+ * Check that a section of count items of the given size fits in a file
+ * 
+ * @param offset Offset of the section
+ * @param count Number of items
+ * @param size Size of an item
+ * @param len Length of the file
+ * @return 1 if the section fits, 0 otherwise
+ */
+static int file_range(uint64_t offset, uint64_t count, uint64_t size, uint64_t len)
+{
+    if (offset > len || offset % HASHMAP_MAX_ALIGN) return 0;
+    return size == 0 || count <= (len - offset) / size;
+}
+
+/**
+ * Check a snapshot header against the machine and the length of the file
+ * 
+ * @param hdr Header
+ * @param len Length of the file
+ * @return 1 if the header is valid, 0 otherwise
+ */
+static int file_valid(const hashmap_file_t* hdr, size_t len)
+{
+    if (memcmp(hdr->magic, HASHMAP_FILE_MAGIC, sizeof(hdr->magic)) ||
+        hdr->version != HASHMAP_FILE_VERSION ||
+        hdr->byte_order != HASHMAP_FILE_BYTE_ORDER ||
+        hdr->word_size != sizeof(size_t) ||
+        hdr->file_size != len)
+        return 0;
+    if (hdr->flags & ~(unsigned)(HASHMAP_HASH_MASK | HASHMAP_STRING_KEYS) ||
+        (hdr->flags & HASHMAP_HASH_MASK) == HASHMAP_HASH_AUTO)
+        return 0;
+    if (hdr->capacity == 0 || hdr->capacity & (hdr->capacity - 1) ||
+        hdr->capacity > SIZE_MAX / sizeof(hashmap_entry_t) ||
+        hdr->key_len > SIZE_MAX || hdr->elem_size > SIZE_MAX)
+        return 0;
+    if (hdr->pilots_offset) {
+        if (hdr->pilot_count == 0 || hdr->pilot_count >= UINT32_MAX || hdr->count >= UINT32_MAX ||
+            !file_range(hdr->pilots_offset, hdr->pilot_count, sizeof(uint64_t), len))
+            return 0;
+    } else if (!file_range(hdr->buckets_offset, hdr->capacity + 1, sizeof(uint64_t), len)) {
+        return 0;
+    }
+    return file_range(hdr->hashes_offset, hdr->count, sizeof(uint64_t), len) &&
+           file_range(hdr->slots_offset, hdr->count, hdr->slot_size, len) &&
+           file_range(hdr->arena_offset, hdr->arena_len, 1, len) &&
+           (!hdr->null_offset || file_range(hdr->null_offset, 1, hdr->elem_size, len));
+}
+
+/**
+ * Map a file written by hashmap_save as a read-only hashmap
+ * 
+ * Only hashmap_query, hashmap_contains_key, their batches, iteration
+ * without removal and hashmap_copy work on the mapping, without
+ * rehashing: insertions and removals return ERR_INVALID_OPERATION and
+ * hashmap_find and hashmap_emplace return NULL; hashmap_copy makes a
+ * writable hashmap out of it. The file must not change while it is
+ * mapped, and beyond the header and bucket index its contents are
+ * trusted
+ * 
+ * @param path Path of the file
+ * @return Hashmap on success, NULL on failure
+ */
+hashmap_t hashmap_load_mmap(const char* path)
+{
+    cat_mmap_t file;
+    hashmap_file_t hdr;
+    if (cat_mmap_open(&file, path)) return NULL;
+    if (file.len < sizeof(hdr)) {
+        cat_mmap_close(&file);
+        return NULL;
+    }
+    memcpy(&hdr, file.addr, sizeof(hdr));
+    int valid = file_valid(&hdr, file.len);
+    if (valid && hdr.pilots_offset) {
+        /* Every pilot must keep its mappings inside the slots */
+        const uint64_t* pilots = (const uint64_t*)(file.addr + hdr.pilots_offset);
+        for (uint64_t i = 0; valid && i < hdr.pilot_count; i++)
+            valid = (pilots[i] & 0xFFFFFFFF) < (hdr.count ? hdr.count : 1);
+    } else if (valid) {
+        const uint64_t* buckets = (const uint64_t*)(file.addr + hdr.buckets_offset);
+        valid = buckets[0] == 0 && buckets[hdr.capacity] == hdr.count;
+    }
+    if (!valid) {
+        cat_mmap_close(&file);
+        return NULL;
+    }
+
+    /* An empty hashmap of the same layout, its buckets replaced by the file */
+    hashmap_t ht = _hashmap_init(HASHMAP_MIN_CAPACITY,
+                                 (size_t)hdr.key_len,
+                                 (size_t)hdr.elem_size,
+                                 hdr.flags,
+                                 NULL,
+                                 NULL,
+                                 NULL,
+                                 NULL);
+    hashmap_mapped_t mapped = malloc(sizeof(hashmap_mapped_s));
+    if (!ht || !mapped || ht->elem_offset != hdr.elem_offset || ht->slot_size != hdr.slot_size) {
+        if (ht) hashmap_deinit(ht);
+        free(mapped);
+        cat_mmap_close(&file);
+        return NULL;
+    }
+    free(ht->entries);
+    ht->entries = NULL;
+
+    mapped->file = file;
+    mapped->image = NULL;
+    mapped_attach(ht, mapped, &hdr);
+    return ht;
+}
+
+/**
+ * Answer the queries of a hashmap from a snapshot image
+ * 
+ * @param ht Hashmap without entries, tables or arena
+ * @param mapped Snapshot with its file set
+ * @param hdr Header of the snapshot
+ */
+static void mapped_attach(hashmap_t ht, hashmap_mapped_t mapped, const hashmap_file_t* hdr)
+{
+    const char* addr = mapped->file.addr;
+    mapped->buckets = hdr->pilots_offset ? NULL : (const uint64_t*)(addr + hdr->buckets_offset);
+    mapped->pilots = hdr->pilots_offset ? (const uint64_t*)(addr + hdr->pilots_offset) : NULL;
+    mapped->pilot_count = (size_t)hdr->pilot_count;
+    mapped->salt = hdr->salt;
+    mapped->hashes = (const uint64_t*)(addr + hdr->hashes_offset);
+    mapped->slots = addr + hdr->slots_offset;
+    mapped->count = (size_t)hdr->count;
+    ht->mapped = mapped;
+    ht->capacity = (size_t)hdr->capacity;
+    ht->size = mapped->count;
+    ht->seed = hdr->seed;
+    if (hdr->arena_len) {
+        ht->arena = (char*)addr + hdr->arena_offset;
+        ht->arena_used = (size_t)hdr->arena_len;
+        ht->arena_capacity = (size_t)hdr->arena_len;
+    }
+    if (hdr->null_offset) {
+        ht->null_elem = (char*)addr + hdr->null_offset;
+        ht->size++;
+    }
+}
+
+/**
+ * Query a mapping from a snapshot
+ * 
+ * @param ht Hashmap loaded by hashmap_load_mmap
+ * @param key Key to query
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return, can be NULL
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t mapped_query(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    hashmap_mapped_t mapped = ht->mapped;
+    if (mapped->pilots) {
+        /* The key can only be at one slot, its stored hash would be one more miss */
+        if (!mapped->count) return ERR_INVALID_OPERATION;
+        const char* slot = mapped_slot(ht, frozen_index(mapped, hash));
+        if (!key_match(ht, slot, key)) return ERR_INVALID_OPERATION;
+        if (ret_val) memcpy(ret_val, slot + ht->elem_offset, ht->elem_size);
+        return COMPLETE;
+    }
+    size_t i = hash & (ht->capacity - 1);
+    /* Clamped so that a damaged index never reads past the slots */
+    uint64_t end = mapped->buckets[i + 1] < mapped->count ? mapped->buckets[i + 1] : mapped->count;
+    for (uint64_t j = mapped->buckets[i]; j < end; j++) {
+        if (mapped->hashes[j] != hash || !key_match(ht, mapped_slot(ht, j), key))
+            continue;
+        if (ret_val)
+            memcpy(ret_val, mapped_slot(ht, j) + ht->elem_offset, ht->elem_size);
+        return COMPLETE;
+    }
+    return ERR_INVALID_OPERATION;
+}
+
+/***********************************************************************************
+ * Frozen hashmaps
+ * 
+ * hashmap_freeze packs the mappings into a snapshot image whose slots are placed by
+ * a minimal perfect hash built with hash-and-displace: the keys are split into
+ * buckets of about FROZEN_BUCKET_KEYS, and every bucket gets a pilot, the largest
+ * buckets first. The high half of a pilot remixes the home slots of the keys until
+ * they are distinct, the low half shifts them all onto free slots, so the single
+ * keys left at the end take the remaining slots directly. A lookup mixes the stored
+ * hash with the salt of the image, reads the pilot of its bucket and compares the
+ * one slot it lands on.
+ * See: https://cmph.sourceforge.net/papers/esa09.pdf
+ **********************************************************************************/
+
+/**
+ * Turn the hashmap into a read-only one answering every query with a single probe
+ * 
+ * The keys and values are packed densely behind an index of 8 bytes for every
+ * FROZEN_BUCKET_KEYS keys. A frozen hashmap behaves as one loaded by
+ * hashmap_load_mmap: insertions and removals return ERR_INVALID_OPERATION,
+ * hashmap_copy makes a writable hashmap out of it, and hashmap_save writes
+ * the image as is for hashmap_load_mmap to map back
+ * 
+ * @param ht Hashmap, not a lock-free read one or a multimap
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if two keys have the same
+ *         hash, corresponding error code on failure, in which case the hashmap
+ *         is left as it was
+ */
+stat_t hashmap_freeze(hashmap_t ht)
+{
+    if (ht->rcu || ht->run_size) return ERR_INVALID_OPERATION;
+    if (ht->mapped && ht->mapped->pilots) return COMPLETE;
+
+    char* image;
+    size_t len;
+    stat_t stat = frozen_image(ht, &image, &len);
+    if (stat) return stat;
+    hashmap_mapped_t mapped = malloc(sizeof(hashmap_mapped_s));
+    if (!mapped) {
+        if (ht->free_fn) {
+            ht->free_fn(image);
+        } else {
+            free(image);
+        }
+        return ERR_MEMORY_ALLOCATION;
+    }
+
+    hashmap_release(ht);
+    ht->entries = NULL;
+    ht->old_entries = NULL;
+    ht->old_capacity = 0;
+    ht->rehash_idx = 0;
+    ht->ctrl = NULL;
+    ht->slots = NULL;
+    ht->null_elem = NULL;
+    ht->arena = NULL;
+    ht->slab = NULL;
+    ht->slab_end = NULL;
+    ht->arena_used = 0;
+    ht->arena_dead = 0;
+    ht->arena_capacity = 0;
+    ht->filter = NULL;
+    ht->filter_mem = NULL;
+    ht->filter_blocks = 0;
+    ht->filter_count = 0;
+    ht->filter_dead = 0;
+    ht->flags &= HASHMAP_HASH_MASK | HASHMAP_STRING_KEYS;
+
+    hashmap_file_t hdr;
+    memcpy(&hdr, image, sizeof(hdr));
+    mapped->file.addr = image;
+    mapped->file.len = len;
+    mapped->image = image;
+    mapped_attach(ht, mapped, &hdr);
+    return COMPLETE;
+}
+
+/**
+ * Find the one slot a hash can be at in a frozen snapshot
+ * 
+ * @param mapped Frozen snapshot with at least one mapping
+ * @param hash Hash of the key
+ * @return Index of the slot
+ */
+static size_t frozen_index(hashmap_mapped_t mapped, uint64_t hash)
+{
+    uint64_t mix = intmix64(hash, mapped->salt);
+    uint64_t pilot = mapped->pilots[frozen_bucket(mix, mapped->pilot_count)];
+    size_t i = frozen_home(intmix64(mix, pilot >> 32), mapped->count) + (size_t)(pilot & 0xFFFFFFFF);
+    return i >= mapped->count ? i - mapped->count : i;
+}
+
+/**
+ * Build the frozen snapshot image of the mappings
+ * 
+ * @param ht Hashmap
+ * @param image Pointer to the image to return, allocated with the alloc_fn of the hashmap
+ * @param len Pointer to the length of the image to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t frozen_image(hashmap_t ht, char** image, size_t* len)
+{
+    size_t count = ht->size - (ht->null_elem != NULL);
+    if (count >= UINT32_MAX) return ERR_CAPACITY_OVERFLOW;
+    size_t buckets = count / FROZEN_BUCKET_KEYS + 1;
+    uint64_t* hashes = malloc((count ? count : 1) * sizeof(uint64_t));
+    const char** slots = malloc((count ? count : 1) * sizeof(char*));
+    uint32_t* index = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint64_t* pilots = malloc(buckets * sizeof(uint64_t));
+    stat_t stat = ERR_MEMORY_ALLOCATION;
+    if (!hashes || !slots || !index || !pilots) goto done;
+
+    hashmap_iter_t it;
+    void* key;
+    size_t n = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, NULL)) {
+        if (!key) continue;
+        slots[n] = iter_slot(&it, &hashes[n]);
+        n++;
+    }
+
+    /* A salt that fails to place some bucket is unlucky, one that fails
+     * every time is faced with keys of the same hash */
+    uint64_t salt = 0;
+    stat = ERR_INVALID_OPERATION;
+    for (int t = 0; t < FROZEN_MAX_TRIES && stat == ERR_INVALID_OPERATION; t++) {
+        salt = intmix64((uint64_t)t, ht->seed);
+        stat = frozen_place(hashes, count, buckets, salt, pilots, index);
+    }
+    if (stat) goto done;
+
+    size_t capacity = HASHMAP_MIN_CAPACITY;
+    while (count >= capacity * HASHMAP_LOAD_THRESHOLD) capacity <<= 1;
+    hashmap_file_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, HASHMAP_FILE_MAGIC, sizeof(hdr.magic));
+    hdr.version = HASHMAP_FILE_VERSION;
+    hdr.byte_order = HASHMAP_FILE_BYTE_ORDER;
+    hdr.word_size = sizeof(size_t);
+    hdr.flags = ht->flags & (HASHMAP_HASH_MASK | HASHMAP_STRING_KEYS);
+    hdr.key_len = ht->key_len;
+    hdr.elem_size = ht->elem_size;
+    hdr.elem_offset = ht->elem_offset;
+    hdr.slot_size = ht->slot_size;
+    hdr.seed = ht->seed;
+    hdr.capacity = capacity;
+    hdr.count = count;
+    hdr.pilots_offset = file_align(sizeof(hdr));
+    hdr.pilot_count = buckets;
+    hdr.salt = salt;
+    hdr.hashes_offset = file_align(hdr.pilots_offset + buckets * sizeof(uint64_t));
+    hdr.slots_offset = file_align(hdr.hashes_offset + count * sizeof(uint64_t));
+    hdr.arena_offset = file_align(hdr.slots_offset + (uint64_t)count * ht->slot_size);
+    hdr.arena_len = ht->arena ? ht->arena_used : 0;
+    hdr.file_size = hdr.arena_offset + hdr.arena_len;
+    if (ht->null_elem) {
+        hdr.null_offset = file_align(hdr.file_size);
+        hdr.file_size = hdr.null_offset + ht->elem_size;
+    }
+    stat = ERR_CAPACITY_OVERFLOW;
+    if (hdr.file_size > SIZE_MAX) goto done;
+
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    char* out = alloc((size_t)hdr.file_size);
+    stat = ERR_MEMORY_ALLOCATION;
+    if (!out) goto done;
+    stats_alloc(ht, (size_t)hdr.file_size);
+    memset(out, 0, (size_t)hdr.file_size);
+    memcpy(out, &hdr, sizeof(hdr));
+    memcpy(out + hdr.pilots_offset, pilots, buckets * sizeof(uint64_t));
+    uint64_t* out_hashes = (uint64_t*)(out + hdr.hashes_offset);
+    for (size_t k = 0; k < count; k++) {
+        out_hashes[index[k]] = hashes[k];
+        memcpy(out + hdr.slots_offset + (size_t)index[k] * ht->slot_size, slots[k], ht->slot_size);
+    }
+    if (hdr.arena_len) memcpy(out + hdr.arena_offset, ht->arena, (size_t)hdr.arena_len);
+    if (ht->null_elem) memcpy(out + hdr.null_offset, ht->null_elem, ht->elem_size);
+    *image = out;
+    *len = (size_t)hdr.file_size;
+    stat = COMPLETE;
+
+done:
+    free(hashes);
+    free(slots);
+    free(index);
+    free(pilots);
+    return stat;
+}
+
+/**
+ * Find a pilot for every bucket so that the keys land on distinct slots
+ * 
+ * @param hashes Hashes of the keys
+ * @param count Number of keys
+ * @param buckets Number of buckets
+ * @param salt Salt mixed into the hashes
+ * @param pilots Pilots to return, one for each bucket
+ * @param index Slot of each key to return
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if some bucket cannot be
+ *         placed with this salt, corresponding error code on failure
+ */
+static stat_t frozen_place(const uint64_t* hashes,
+                           size_t count,
+                           size_t buckets,
+                           uint64_t salt,
+                           uint64_t* pilots,
+                           uint32_t* index)
+{
+    size_t words = bucket_words(count) + 1;
+    uint32_t* start = calloc(buckets + 1, sizeof(uint32_t));
+    uint32_t* keys = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint64_t* mixes = malloc((count ? count : 1) * sizeof(uint64_t));
+    uint32_t* order = malloc(buckets * sizeof(uint32_t));
+    uint32_t* sizes = NULL;
+    uint32_t* homes = NULL;
+    uint64_t* taken = calloc(2 * words, sizeof(uint64_t));
+    uint64_t* seen = taken + words;
+    stat_t stat = ERR_MEMORY_ALLOCATION;
+    if (!start || !keys || !mixes || !order || !taken) goto done;
+
+    /* Counting sort of the keys by bucket, the slot index holds the bucket until placed */
+    for (size_t k = 0; k < count; k++) {
+        mixes[k] = intmix64(hashes[k], salt);
+        index[k] = (uint32_t)frozen_bucket(mixes[k], buckets);
+        start[index[k] + 1]++;
+    }
+    size_t largest = 0;
+    for (size_t b = 0; b < buckets; b++) {
+        if (start[b + 1] > largest) largest = start[b + 1];
+        start[b + 1] += start[b];
+    }
+    for (size_t k = 0; k < count; k++)
+        keys[start[index[k]]++] = (uint32_t)k;
+    for (size_t b = buckets; b > 0; b--)
+        start[b] = start[b - 1];
+    start[0] = 0;
+
+    /* Counting sort of the buckets by size, largest first */
+    sizes = calloc(largest + 2, sizeof(uint32_t));
+    homes = malloc((largest ? largest : 1) * sizeof(uint32_t));
+    if (!sizes || !homes) goto done;
+    for (size_t b = 0; b < buckets; b++)
+        sizes[largest - (start[b + 1] - start[b]) + 1]++;
+    for (size_t s = 0; s <= largest; s++)
+        sizes[s + 1] += sizes[s];
+    for (size_t b = 0; b < buckets; b++)
+        order[sizes[largest - (start[b + 1] - start[b])]++] = (uint32_t)b;
+
+    memset(pilots, 0, buckets * sizeof(uint64_t));
+    size_t free_slot = 0;
+    stat = ERR_INVALID_OPERATION;
+    for (size_t o = 0; o < buckets; o++) {
+        size_t b = order[o];
+        const uint32_t* bucket = keys + start[b];
+        size_t len = start[b + 1] - start[b];
+        if (len == 0) break;
+        /* Single keys come last and take the free slots in turn */
+        if (len == 1) {
+            size_t home = frozen_home(intmix64(mixes[bucket[0]], 0), count);
+            while (taken[free_slot / 64] & (uint64_t)1 << (free_slot % 64)) free_slot++;
+            taken[free_slot / 64] |= (uint64_t)1 << (free_slot % 64);
+            index[bucket[0]] = (uint32_t)free_slot;
+            pilots[b] = free_slot >= home ? free_slot - home : free_slot + count - home;
+            continue;
+        }
+
+        size_t shape, shift = count;
+        for (shape = 0; shape < FROZEN_MAX_SHAPES && shift == count; shape++) {
+            /* Homes that coincide move together under every shift */
+            size_t j;
+            for (j = 0; j < len; j++) {
+                homes[j] = (uint32_t)frozen_home(intmix64(mixes[bucket[j]], shape), count);
+                if (seen[homes[j] / 64] & (uint64_t)1 << (homes[j] % 64)) break;
+                seen[homes[j] / 64] |= (uint64_t)1 << (homes[j] % 64);
+            }
+            for (size_t m = 0; m < j && m < len; m++)
+                seen[homes[m] / 64] &= ~((uint64_t)1 << (homes[m] % 64));
+            if (j < len) continue;
+
+            for (shift = 0; shift < count; shift++) {
+                for (j = 0; j < len; j++) {
+                    size_t i = homes[j] + shift;
+                    if (i >= count) i -= count;
+                    if (taken[i / 64] & (uint64_t)1 << (i % 64)) break;
+                    taken[i / 64] |= (uint64_t)1 << (i % 64);
+                    index[bucket[j]] = (uint32_t)i;
+                }
+                if (j == len) break;
+                while (j-- > 0)
+                    taken[index[bucket[j]] / 64] &= ~((uint64_t)1 << (index[bucket[j]] % 64));
+            }
+        }
+        if (shift == count) goto done;
+        pilots[b] = (uint64_t)(shape - 1) << 32 | shift;
+    }
+    stat = COMPLETE;
+
+done:
+    free(start);
+    free(keys);
+    free(mixes);
+    free(order);
+    free(sizes);
+    free(homes);
+    free(taken);
+    return stat;
+}
+
+/***********************************************************************************
+ * Lock-free read mode
+ * 
+ * Entries are immutable once published: an update links a fresh copy in place of
+ * the old entry and a resize clones every entry into a new bucket array that is
+ * published with a single pointer store. Readers walk the chains with acquire
+ * loads inside an epoch critical section and never block. Writers serialize on
+ * a lock, and what they unlink is freed in batches once cat_epoch_synchronize
+ * guarantees that no reader can still see it. A cursor is not such a reader,
+ * it must not run alongside writers.
+ **********************************************************************************/
+
+/**
+ * Set up the writer state and the first bucket array of a lock-free read hashmap
+ * 
+ * @param ht Hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_init(hashmap_t ht)
+{
+    hashmap_rcu_t rcu = (hashmap_rcu_t)malloc(sizeof(hashmap_rcu_s));
+    if (!rcu) return ERR_MEMORY_ALLOCATION;
+    rcu->retired = NULL;
+    rcu->nretired = 0;
+    rcu->retired_capacity = 0;
+    if (cat_mutex_init(&rcu->lock)) {
+        free(rcu);
+        return ERR_MEMORY_ALLOCATION;
+    }
+    if (rcu_table_alloc(ht, ht->capacity, &rcu->table)) {
+        cat_mutex_destroy(&rcu->lock);
+        free(rcu);
+        return ERR_MEMORY_ALLOCATION;
+    }
+    ht->rcu = rcu;
+    ht->entries = rcu->table->entries;
+    return COMPLETE;
+}
+
+/**
+ * Take the writer lock of a lock-free read hashmap, no-op in other modes
+ * 
+ * @param ht Hashmap
+ */
+static void rcu_lock(hashmap_t ht)
+{
+    if (ht->rcu) cat_mutex_lock(&ht->rcu->lock);
+}
+
+/**
+ * Release the writer lock of a lock-free read hashmap, no-op in other modes
+ * 
+ * @param ht Hashmap
+ */
+static void rcu_unlock(hashmap_t ht)
+{
+    if (ht->rcu) cat_mutex_unlock(&ht->rcu->lock);
+}
+
+/**
+ * Allocate an empty bucket array
+ * 
+ * @param ht Hashmap
+ * @param capacity Number of buckets
+ * @param table Pointer to the bucket array to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_table_alloc(hashmap_t ht, size_t capacity, hashmap_table_t* table)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+
+    size_t size = capacity * sizeof(hashmap_entry_t) + bucket_words(capacity) * sizeof(uint64_t);
+    *table = alloc(sizeof(hashmap_table_s) + size);
+    if (!*table) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, sizeof(hashmap_table_s) + size);
+    (*table)->capacity = capacity;
+    memset((*table)->entries, 0, size);
+    return COMPLETE;
+}
+
+/**
+ * Defer freeing memory that readers may still be using, and free what
+ * was deferred so far once enough of it piled up
+ * 
+ * @param ht Hashmap
+ * @param ptr Memory unlinked from the hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_retire(hashmap_t ht, void* ptr)
+{
+    hashmap_rcu_t rcu = ht->rcu;
+    if (rcu->nretired == rcu->retired_capacity) {
+        size_t capacity = rcu->retired_capacity ? rcu->retired_capacity * 2 : HASHMAP_RCU_BATCH;
+        void** retired = malloc(capacity * sizeof(void*));
+        if (!retired) {
+            /* Nowhere to keep it, wait for the readers right away */
+            rcu_reclaim(ht);
+            cat_epoch_synchronize();
+            if (ht->free_fn) {
+                ht->free_fn(ptr);
+            } else {
+                free(ptr);
+            }
+            return COMPLETE;
+        }
+        if (rcu->nretired) memcpy(retired, rcu->retired, rcu->nretired * sizeof(void*));
+        free(rcu->retired);
+        rcu->retired = retired;
+        rcu->retired_capacity = capacity;
+    }
+    rcu->retired[rcu->nretired++] = ptr;
+    return COMPLETE;
+}
+
+/**
+ * Wait for the readers that may see retired memory, then free it
+ * 
+ * @param ht Hashmap
+ */
+static void rcu_reclaim(hashmap_t ht)
+{
+    hashmap_rcu_t rcu = ht->rcu;
+    if (!rcu->nretired) return;
+    cat_epoch_synchronize();
+    for (size_t i = 0; i < rcu->nretired; i++) {
+        if (ht->free_fn) {
+            ht->free_fn(rcu->retired[i]);
+        } else {
+            free(rcu->retired[i]);
+        }
+    }
+    rcu->nretired = 0;
+}
+
+/**
+ * Clone every entry into a new bucket array and publish it at once,
+ * the old array and entries are retired
+ * 
+ * @param ht Hashmap
+ * @param capacity New capacity of the hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_resize(hashmap_t ht, size_t capacity)
+{
+    hashmap_rcu_t rcu = ht->rcu;
+    hashmap_table_t old = rcu->table;
+    hashmap_table_t table;
+    uint64_t start = stats_clock();
+    if (rcu_table_alloc(ht, capacity, &table))
+        return ERR_MEMORY_ALLOCATION;
+
+    size_t entry_size = sizeof(hashmap_entry_s) + ht->slot_size;
+    for (size_t i = 0; i < old->capacity; i++) {
+        for (hashmap_entry_t entry = old->entries[i]; entry; entry = entry->next) {
+            hashmap_entry_t clone;
+            if (entry_alloc(ht, &clone)) {
+                old = table;
+                table = NULL;
+                break;
+            }
+            memcpy(clone, entry, entry_size);
+            size_t j = entry->hash & (capacity - 1);
+            clone->next = table->entries[j];
+            table->entries[j] = clone;
+            bucket_mark(table->entries, capacity, j);
+        }
+        if (!table) break;
+    }
+
+    /* Out of memory while cloning, drop the unpublished copy */
+    if (!table) {
+        for (size_t i = 0; i < old->capacity; i++) {
+            hashmap_entry_t entry = old->entries[i];
+            while (entry) {
+                hashmap_entry_t next = entry->next;
+                if (ht->free_fn) {
+                    ht->free_fn(entry);
+                } else {
+                    free(entry);
+                }
+                entry = next;
+            }
+        }
+        if (ht->free_fn) {
+            ht->free_fn(old);
+        } else {
+            free(old);
+        }
+        return ERR_MEMORY_ALLOCATION;
+    }
+
+    cat_atomic_store_ptr(&rcu->table, table);
+    ht->entries = table->entries;
+    cat_atomic_store_size(&ht->capacity, capacity);
+    for (size_t i = 0; i < old->capacity; i++) {
+        for (hashmap_entry_t entry = old->entries[i]; entry; entry = entry->next)
+            rcu_retire(ht, entry);
+    }
+    rcu_retire(ht, old);
+    rcu_reclaim(ht);
+    stats_resize(ht, start);
+    return COMPLETE;
+}
+
+/**
+ * Insert or update a mapping of a lock-free read hashmap
+ * 
+ * @param ht Hashmap
+ * @param key Key to insert
+ * @param hash Hash of the key
+ * @param val Value to insert
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_assign(hashmap_t ht, void* key, uint64_t hash, void* val)
+{
+    stat_t stat = COMPLETE;
+    rcu_lock(ht);
+    if (ht->size >= ht->capacity * HASHMAP_LOAD_THRESHOLD) {
+        if (ht->capacity << 1 >= HASHMAP_MAX_CAPACITY) {
+            stat = ERR_CAPACITY_OVERFLOW;
+        } else {
+            stat = rcu_resize(ht, ht->capacity << 1);
+        }
+    }
+
+    hashmap_entry_t entry = NULL;
+    if (stat == COMPLETE) stat = entry_alloc(ht, &entry);
+    if (stat == COMPLETE) {
+        memcpy(entry_key(entry), key, ht->key_len);
+        memcpy(entry_elem(ht, entry), val, ht->elem_size);
+        entry->hash = hash;
+
+        hashmap_entry_t* link = chain_find(ht, key, hash);
+        if (link) {
+            hashmap_entry_t old = *link;
+            entry->next = old->next;
+            cat_atomic_store_ptr(link, entry);
+            rcu_retire(ht, old);
+        } else {
+            size_t i = hash & (ht->capacity - 1);
+            link = &ht->entries[i];
+            entry->next = *link;
+            cat_atomic_store_ptr(link, entry);
+            bucket_mark(ht->entries, ht->capacity, i);
+            cat_atomic_store_size(&ht->size, ht->size + 1);
+        }
+        if (ht->rcu->nretired >= HASHMAP_RCU_BATCH) rcu_reclaim(ht);
+    }
+    rcu_unlock(ht);
+    return stat;
+}
+
+/**
+ * Remove a mapping from a lock-free read hashmap
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    rcu_lock(ht);
+    hashmap_entry_t* link = chain_find(ht, key, hash);
+    if (!link) {
+        rcu_unlock(ht);
+        return ERR_INVALID_OPERATION;
+    }
+
+    rcu_unlink(ht, link, ret_val);
+    hashmap_shrink_check(ht);
+    rcu_unlock(ht);
+    return COMPLETE;
+}
+
+/**
+ * Unlink an entry of a lock-free read hashmap and retire it,
+ * the writer lock must be held
+ * 
+ * @param ht Hashmap
+ * @param link Link holding the entry
+ * @param ret_val Pointer to the value to return
+ */
+static void rcu_unlink(hashmap_t ht, hashmap_entry_t* link, void* ret_val)
+{
+    hashmap_entry_t entry = *link;
+    if (ret_val)
+        memcpy(ret_val, entry_elem(ht, entry), ht->elem_size);
+    cat_atomic_store_ptr(link, entry->next);
+    bucket_sync(ht, entry->hash);
+    cat_atomic_store_size(&ht->size, ht->size - 1);
+    rcu_retire(ht, entry);
+    if (ht->rcu->nretired >= HASHMAP_RCU_BATCH) rcu_reclaim(ht);
+}
+
+/**
+ * Query a mapping from a lock-free read hashmap without blocking,
+ * safe against concurrent writers
+ * 
+ * @param ht Hashmap
+ * @param key Key to query
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return, can be NULL
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t rcu_query(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    stat_t stat = ERR_INVALID_OPERATION;
+    size_t slot = cat_epoch_enter();
+    hashmap_table_t table = cat_atomic_load_ptr(&ht->rcu->table);
+    hashmap_entry_t entry = cat_atomic_load_ptr(&table->entries[hash & (table->capacity - 1)]);
+    while (entry) {
+        if (entry->hash == hash && key_match(ht, entry_key(entry), key)) {
+            if (ret_val)
+                memcpy(ret_val, entry_elem(ht, entry), ht->elem_size);
+            stat = COMPLETE;
+            break;
+        }
+        entry = cat_atomic_load_ptr(&entry->next);
+    }
+    cat_epoch_exit(slot);
+    return stat;
+}
+
+/**
+ * Publish an empty bucket array and free every entry once no reader sees them
+ * 
+ * @param ht Hashmap
+ */
+static void rcu_clear(hashmap_t ht)
+{
+    hashmap_table_t table;
+    rcu_lock(ht);
+    hashmap_table_t old = ht->rcu->table;
+    if (rcu_table_alloc(ht, old->capacity, &table) == COMPLETE) {
+        cat_atomic_store_ptr(&ht->rcu->table, table);
+        ht->entries = table->entries;
+        cat_atomic_store_size(&ht->size, 0);
+        for (size_t i = 0; i < old->capacity; i++) {
+            for (hashmap_entry_t entry = old->entries[i]; entry; entry = entry->next)
+                rcu_retire(ht, entry);
+        }
+        rcu_retire(ht, old);
+    } else {
+        /* Unlink chain by chain in place instead */
+        for (size_t i = 0; i < old->capacity; i++) {
+            hashmap_entry_t entry = old->entries[i];
+            cat_atomic_store_ptr(&old->entries[i], NULL);
+            for (; entry; entry = entry->next)
+                rcu_retire(ht, entry);
+        }
+        memset(bucket_bitmap(old->entries, old->capacity), 0,
+               bucket_words(old->capacity) * sizeof(uint64_t));
+        cat_atomic_store_size(&ht->size, 0);
+    }
+    rcu_reclaim(ht);
+    rcu_unlock(ht);
+}
+
+/**
+ * Free the writer state and the bucket array of a cleared lock-free read hashmap
+ * 
+ * @param ht Hashmap
+ */
+static void rcu_deinit(hashmap_t ht)
+{
+    if (ht->free_fn) {
+        ht->free_fn(ht->rcu->table);
+    } else {
+        free(ht->rcu->table);
+    }
+    free(ht->rcu->retired);
+    cat_mutex_destroy(&ht->rcu->lock);
+    free(ht->rcu);
+}
+
+/***********************************************************************************
+ * Open addressing engine
+ * 
+ * Slots are split into groups of 16, each described by 16 control bytes. A full
+ * slot holds the low 7 bits of its hash in the control byte, so a whole group is
+ * filtered with one SIMD compare before any key is touched. Empty and deleted
+ * slots have the high bit set. Probing walks groups in triangular steps and stops
+ * at the first group with an empty slot.
+ * See: https://abseil.io/about/design/swisstables
+ **********************************************************************************/
+
+#if defined(HASHMAP_SSE2)
+
+#define SWISS_MASK_SHIFT 0
+#define SWISS_MASK_ALL 0xFFFFULL
+
+static inline uint64_t group_match(const uint8_t* ctrl, uint8_t h2)
+{
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    __m128i match = _mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2));
+    return (uint16_t)_mm_movemask_epi8(match);
+}
+
+static inline uint64_t group_match_empty(const uint8_t* ctrl)
+{
+    return group_match(ctrl, SWISS_EMPTY);
+}
+
+static inline uint64_t group_match_free(const uint8_t* ctrl)
+{
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return (uint16_t)_mm_movemask_epi8(group);
+}
+
+#elif defined(HASHMAP_NEON)
+
+/* NEON has no movemask, each slot is reported by the top bit of a nibble */
+#define SWISS_MASK_SHIFT 2
+#define SWISS_MASK_ALL 0x8888888888888888ULL
+
+static inline uint64_t neon_mask(uint8x16_t match)
+{
+    uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(match), 4);
+    return vget_lane_u64(vreinterpret_u64_u8(narrow), 0) & 0x8888888888888888ULL;
+}
+
+static inline uint64_t group_match(const uint8_t* ctrl, uint8_t h2)
+{
+    return neon_mask(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(h2)));
+}
+
+static inline uint64_t group_match_empty(const uint8_t* ctrl)
+{
+    return group_match(ctrl, SWISS_EMPTY);
+}
+
+static inline uint64_t group_match_free(const uint8_t* ctrl)
+{
+    int8x16_t group = vreinterpretq_s8_u8(vld1q_u8(ctrl));
+    return neon_mask(vreinterpretq_u8_s8(vshrq_n_s8(group, 7)));
+}
+
+#else
+
+#define SWISS_MASK_SHIFT 0
+#define SWISS_MASK_ALL 0xFFFFULL
+
+static inline uint64_t group_match(const uint8_t* ctrl, uint8_t h2)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++)
+        mask |= (uint64_t)(ctrl[i] == h2) << i;
+    return mask;
+}
+
+static inline uint64_t group_match_empty(const uint8_t* ctrl)
+{
+    return group_match(ctrl, SWISS_EMPTY);
+}
+
+static inline uint64_t group_match_free(const uint8_t* ctrl)
+{
+    uint64_t mask = 0;
+    for (int i = 0; i < SWISS_GROUP_WIDTH; i++)
+        mask |= (uint64_t)(ctrl[i] >> 7) << i;
+    return mask;
+}
+
+#endif
+
+/**
+ * Allocate the control bytes and slots, moving the existing mappings
+ * 
+ * @param ht Hashmap
+ * @param capacity Number of slots, a power of 2 no less than a group
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t swiss_alloc(hashmap_t ht, size_t capacity)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    if (capacity > (SIZE_MAX - capacity) / ht->slot_size)
+        return ERR_CAPACITY_OVERFLOW;
+    uint64_t start = stats_clock();
+    uint8_t* ctrl = alloc(capacity + capacity * ht->slot_size);
+    if (!ctrl) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, capacity + capacity * ht->slot_size);
+    memset(ctrl, SWISS_EMPTY, capacity);
+
+    uint8_t* old_ctrl = ht->ctrl;
+    char* old_slots = ht->slots;
+    size_t old_capacity = ht->capacity;
+
+    ht->ctrl = ctrl;
+    ht->slots = (char*)ctrl + capacity;
+    ht->capacity = capacity;
+    ht->growth_left = swiss_max_load(capacity) - (ht->size - (ht->null_elem != NULL));
+
+    if (old_ctrl) {
+        for (size_t i = 0; i < old_capacity; i++) {
+            if (!swiss_is_full(old_ctrl[i])) continue;
+            char* slot = old_slots + i * ht->slot_size;
+            hashmap_str_t view;
+            uint64_t hash = hashmap_hash(ht, key_load(ht, slot, &view));
+            size_t j = swiss_find_free(ht, hash);
+            ht->ctrl[j] = swiss_h2(hash);
+            memcpy(swiss_slot(ht, j), slot, ht->slot_size);
+        }
+        dealloc(old_ctrl);
+        stats_resize(ht, start);
+    }
+    return COMPLETE;
+}
+
+/**
+ * Make room for an insertion, either by dropping the tombstones
+ * or by doubling the capacity
+ * 
+ * @param ht Hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t swiss_grow(hashmap_t ht)
+{
+    size_t capacity = ht->capacity;
+    size_t live = ht->size - (ht->null_elem != NULL);
+    if (live >= swiss_max_load(capacity) / 2) {
+        if (capacity << 1 >= HASHMAP_MAX_CAPACITY)
+            return ERR_CAPACITY_OVERFLOW;
+        capacity <<= 1;
+    }
+    return swiss_alloc(ht, capacity);
+}
+
+/**
+ * Find the slot of a key
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Index of the slot, capacity if the key is not found
+ */
+static size_t swiss_find(hashmap_t ht, void* key, uint64_t hash)
+{
+    size_t mask = ht->capacity / SWISS_GROUP_WIDTH - 1;
+    size_t group = (size_t)(hash >> 7) & mask;
+    uint8_t h2 = swiss_h2(hash);
+
+    for (size_t step = 1; ; step++) {
+        const uint8_t* ctrl = ht->ctrl + group * SWISS_GROUP_WIDTH;
+        uint64_t match = group_match(ctrl, h2);
+        stats_probe(ht);
+        while (match) {
+            size_t i = group * SWISS_GROUP_WIDTH + (ctz64(match) >> SWISS_MASK_SHIFT);
+            stats_compare(ht);
+            if (key_match(ht, swiss_slot(ht, i), key)) return i;
+            match &= match - 1;
+        }
+        if (group_match_empty(ctrl)) return ht->capacity;
+        group = (group + step) & mask;
+    }
+}
+
+/**
+ * Find the first empty or deleted slot on the probe sequence of a hash
+ * 
+ * @param ht Hashmap
+ * @param hash Hash to probe
+ * @return Index of the slot
+ */
+static size_t swiss_find_free(hashmap_t ht, uint64_t hash)
+{
+    size_t mask = ht->capacity / SWISS_GROUP_WIDTH - 1;
+    size_t group = (size_t)(hash >> 7) & mask;
+
+    for (size_t step = 1; ; step++) {
+        uint64_t match = group_match_free(ht->ctrl + group * SWISS_GROUP_WIDTH);
+        if (match)
+            return group * SWISS_GROUP_WIDTH + (ctz64(match) >> SWISS_MASK_SHIFT);
+        group = (group + step) & mask;
+    }
+}
+
+/**
+ * Find the next full slot, a group of control bytes at a time
+ * 
+ * @param ht Hashmap
+ * @param i Slot to start from
+ * @return Index of the first full slot from i, capacity if none
+ */
+static size_t swiss_next(hashmap_t ht, size_t i)
+{
+    while (i < ht->capacity) {
+        size_t group = i & ~(size_t)(SWISS_GROUP_WIDTH - 1);
+        uint64_t full = group_match_free(ht->ctrl + group) ^ SWISS_MASK_ALL;
+        full &= SWISS_MASK_ALL << ((i - group) << SWISS_MASK_SHIFT);
+        if (full) return group + (ctz64(full) >> SWISS_MASK_SHIFT);
+        i = group + SWISS_GROUP_WIDTH;
+    }
+    return ht->capacity;
+}
+
+/**
+ * Find or insert the slot of a key in the open addressing engine
+ * 
+ * @param ht Hashmap
+ * @param key Key to find or insert
+ * @param hash Hash of the key
+ * @param ret_elem Pointer to the value slot to return
+ * @param created Pointer to set to 1 if the slot is inserted, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t swiss_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created)
+{
+    size_t i = swiss_find(ht, key, hash);
+
+    *created = i == ht->capacity;
+    if (*created) {
+        i = swiss_find_free(ht, hash);
+        if (ht->growth_left == 0 && ht->ctrl[i] == SWISS_EMPTY) {
+            stat_t stat = swiss_grow(ht);
+            if (stat) return stat;
+            i = swiss_find_free(ht, hash);
+        }
+        stat_t stat = key_store(ht, swiss_slot(ht, i), key);
+        if (stat) return stat;
+        if (ht->ctrl[i] == SWISS_EMPTY) ht->growth_left--;
+        ht->ctrl[i] = swiss_h2(hash);
+        ht->size++;
+    }
+    *ret_elem = swiss_elem(ht, i);
+    return COMPLETE;
+}
+
+/**
+ * Remove a mapping from the open addressing engine
+ * 
+ * @param ht Hashmap
+ * @param key Key to remove
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t swiss_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
+{
+    size_t i = swiss_find(ht, key, hash);
+    if (i == ht->capacity) return ERR_INVALID_OPERATION;
+    swiss_erase(ht, i, ret_val);
+    return COMPLETE;
+}
+
+/**
+ * Free a full slot of the open addressing engine
+ * 
+ * @param ht Hashmap
+ * @param i Index of the slot
+ * @param ret_val Pointer to the value to return
+ */
+static void swiss_erase(hashmap_t ht, size_t i, void* ret_val)
+{
+    key_release(ht, swiss_slot(ht, i));
+    if (ret_val)
+        memcpy(ret_val, swiss_elem(ht, i), ht->elem_size);
+    /* A probe never passes a group with an empty slot, so the slot can be
+     * freed outright there; otherwise it must stay a tombstone */
+    if (group_match_empty(ht->ctrl + (i & ~(size_t)(SWISS_GROUP_WIDTH - 1)))) {
+        ht->ctrl[i] = SWISS_EMPTY;
+        ht->growth_left++;
+    } else {
+        ht->ctrl[i] = SWISS_DELETED;
+    }
+    ht->size--;
+}
+
+/***********************************************************************************
+ * Robin Hood engine
+ * 
+ * Open addressing with linear probing where a mapping may take the slot of a
+ * resident closer to its home, which keeps probe lengths short and even at high
+ * load. A control byte holds the probe distance of its slot plus one, 0 if the
+ * slot is empty, and the full hash is stored after the value. A lookup stops as
+ * soon as it passes a resident nearer its home than the key would be, and a
+ * removal shifts the rest of the run back, so no tombstones are left. Runs spill
+ * into an overflow area past the last home slot instead of wrapping around.
+ * The home slot is taken from the high bits of the hash times a 64-bit odd
+ * constant, so hashes that differ only in their high bits still spread. A run
+ * too long for the control bytes grows the table until it splits, only more
+ * than ROBIN_MAX_DIST keys with the very same hash fail with
+ * ERR_CAPACITY_OVERFLOW.
+ * See: https://codecapsule.com/2013/11/17/robin-hood-hashing-backward-shift-deletion/
+ **********************************************************************************/
+
+/**
+ * Allocate the control bytes and slots, moving the existing mappings
+ * 
+ * @param ht Hashmap
+ * @param capacity Number of home slots, a power of 2
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t robin_alloc(hashmap_t ht, size_t capacity)
+{
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    /* One more control byte stays 0 so that probes stop at the end */
+    size_t end = capacity + (capacity < ROBIN_MAX_DIST ? capacity : ROBIN_MAX_DIST);
+    size_t ctrl_len = (end + HASHMAP_MAX_ALIGN) & ~(size_t)(HASHMAP_MAX_ALIGN - 1);
+    if (end > (SIZE_MAX - ctrl_len) / ht->hashed_stride)
+        return ERR_CAPACITY_OVERFLOW;
+    uint64_t start = stats_clock();
+    uint8_t* ctrl = alloc(ctrl_len + end * ht->hashed_stride);
+    if (!ctrl) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, ctrl_len + end * ht->hashed_stride);
+    memset(ctrl, 0, end + 1);
+
+    uint8_t* old_ctrl = ht->ctrl;
+    char* old_slots = ht->slots;
+    size_t old_capacity = ht->capacity;
+    size_t old_end = old_ctrl ? robin_end(ht) : 0;
+    size_t live = ht->size - (ht->null_elem != NULL);
+
+    ht->ctrl = ctrl;
+    ht->slots = (char*)ctrl + ctrl_len;
+    ht->capacity = capacity;
+    ht->growth_left = robin_max_load(capacity) - live;
+
+    for (size_t i = 0; i < old_end; i++) {
+        if (!old_ctrl[i]) continue;
+        char* slot = old_slots + i * ht->hashed_stride;
+        uint64_t hash = *(uint64_t*)(slot + ht->hashed_stride - sizeof(uint64_t));
+        size_t j = robin_place(ht, hash);
+        /* A run too long for the control bytes, keep the old table */
+        if (j == robin_end(ht)) {
+            dealloc(ctrl);
+            ht->ctrl = old_ctrl;
+            ht->slots = old_slots;
+            ht->capacity = old_capacity;
+            ht->growth_left = robin_max_load(old_capacity) - live;
+            return ERR_CAPACITY_OVERFLOW;
+        }
+        memcpy(robin_slot(ht, j), slot, ht->slot_size);
+    }
+    if (old_ctrl) {
+        dealloc(old_ctrl);
+        stats_resize(ht, start);
+    }
+    return COMPLETE;
+}
+
+/**
+ * Double the capacity of the Robin Hood engine
+ * 
+ * @param ht Hashmap
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t robin_grow(hashmap_t ht)
+{
+    if (ht->capacity << 1 >= HASHMAP_MAX_CAPACITY)
+        return ERR_CAPACITY_OVERFLOW;
+    return robin_alloc(ht, ht->capacity << 1);
+}
+
+/**
+ * Find the slot of a key, stopping once the key would have displaced a resident
+ * 
+ * @param ht Hashmap
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Index of the slot, robin_end if the key is not found
+ */
+static size_t robin_find(hashmap_t ht, void* key, uint64_t hash)
+{
+    size_t i = robin_home(ht, hash);
+    for (size_t dist = 1; ht->ctrl[i] >= dist; i++, dist++) {
+        stats_probe(ht);
+        /* A resident further from its home has another home than the key */
+        if (ht->ctrl[i] != dist || robin_hash(ht, i) != hash) continue;
+        stats_compare(ht);
+        if (key_match(ht, robin_slot(ht, i), key)) return i;
+    }
+    return robin_end(ht);
+}
+
+/**
+ * Claim a slot for a new mapping, shifting the residents it displaces one
+ * slot further; the key and value are left for the caller to store
+ * 
+ * @param ht Hashmap
+ * @param hash Hash of the key
+ * @return Index of the slot, robin_end if a probe distance would no longer
+ *         fit in a control byte or the run would leave the overflow area,
+ *         in which case nothing is moved
+ */
+static size_t robin_place(hashmap_t ht, uint64_t hash)
+{
+    size_t end = robin_end(ht);
+    size_t i = robin_home(ht, hash);
+    size_t dist = 1;
+    while (ht->ctrl[i] >= dist) {
+        i++;
+        dist++;
+    }
+    if (dist > ROBIN_MAX_DIST) return end;
+
+    size_t empty = i;
+    while (ht->ctrl[empty]) {
+        if (ht->ctrl[empty] == ROBIN_MAX_DIST) return end;
+        empty++;
+    }
+    if (empty == end) return end;
+
+    memmove(robin_slot(ht, i + 1), robin_slot(ht, i), (empty - i) * ht->hashed_stride);
+    for (size_t j = empty; j > i; j--)
+        ht->ctrl[j] = ht->ctrl[j - 1] + 1;
+    ht->ctrl[i] = (uint8_t)dist;
+    robin_hash(ht, i) = hash;
+    return i;
+}
+
+/**
+ * Count the residents whose hash is the same as a new key's
+ * 
+ * @param ht Hashmap
+ * @param hash Hash of the key
+ * @return Number of residents with the hash, they share its home and run
+ */
+static size_t robin_collisions(hashmap_t ht, uint64_t hash)
+{
+    size_t count = 0;
+    for (size_t i = robin_home(ht, hash); ht->ctrl[i]; i++)
+        count += robin_hash(ht, i) == hash;
+    return count;
+}
+
+/**
+ * Empty a slot by shifting the rest of its run back one slot
+ * 
+ * @param ht Hashmap
+ * @param i Index of the slot
+ */
+static void robin_unlink(hashmap_t ht, size_t i)
 {
-    hashmap_entry_t entry = ht->entries[0];
-    while (entry) {
-        if (!entry->key) {
-            memcpy(ret_val, entry->elem, ht->elem_size);
-            return COMPLETE;
-        }
-        entry = entry->next;
-    }
-    return ERR_INVALID_OPERATION;
+    size_t last = i;
+    while (ht->ctrl[last + 1] > 1) last++;
+    memmove(robin_slot(ht, i), robin_slot(ht, i + 1), (last - i) * ht->hashed_stride);
+    for (size_t j = i; j < last; j++)
+        ht->ctrl[j] = ht->ctrl[j + 1] - 1;
+    ht->ctrl[last] = 0;
 }
 
 /**
- * Get the hash of a key
+ * Find the next full slot
  * 
  * @param ht Hashmap
- * @param key Key to hash
- * @return Hash of the key
+ * @param i Slot to start from
+ * @return Index of the first full slot from i, robin_end if none
  */
-static uint64_t hashmap_hash(hashmap_t ht, void* key)
+static size_t robin_next(hashmap_t ht, size_t i)
 {
-    if (ht->hash_fn) return ht->hash_fn((char*)key);
-    return cityhash64((char*)key, ht->key_len);
+    size_t end = robin_end(ht);
+    while (i < end && !ht->ctrl[i]) i++;
+    return i;
 }
 
 /**
- * Insert or update a mapping into the hashmap
+ * Find or insert the slot of a key in the Robin Hood engine
  * 
  * @param ht Hashmap
- * @param key Key to insert
- * @param val Value to insert
+ * @param key Key to find or insert
+ * @param hash Hash of the key
+ * @param ret_elem Pointer to the value slot to return
+ * @param created Pointer to set to 1 if the slot is inserted, 0 otherwise
  * @return COMPLETE on success, corresponding error code on failure
  */
-stat_t hashmap_assign(hashmap_t ht, void* key, void* val)
+static stat_t robin_emplace(hashmap_t ht,
+                            void* key,
+                            uint64_t hash,
+                            void** ret_elem,
+                            int* created)
 {
-    if (hashmap_load(ht) >= HASHMAP_LOAD_THRESHOLD) {
-        if (ht->capacity << 1 >= HASHMAP_MAX_CAPACITY)
-            return ERR_CAPACITY_OVERFLOW;
-        if (hashmap_alloc(ht, ht->capacity << 1))
-            return ERR_MEMORY_ALLOCATION;
-        ht->capacity <<= 1;
-    }
-    if (!key) return null_entry_assign(ht, val);
+    size_t i = robin_find(ht, key, hash);
 
-    uint64_t hash = hashmap_hash(ht, key);
-    size_t i = hash & (ht->capacity - 1);
-
-    hashmap_entry_t entry = ht->entries[i];
-    while (entry) {
-        if (entry->key) {
-            int match = ht->cmp_fn ?
-                ht->cmp_fn(entry->key, key) :
-                memcmp(entry->key, key, ht->key_len);
-            if (match == 0) {
-                memcpy(entry->elem, val, ht->elem_size);
-                return COMPLETE;
-            }
+    *created = i == robin_end(ht);
+    if (*created) {
+        stat_t stat;
+        if (ht->growth_left == 0 && (stat = robin_grow(ht)))
+            return stat;
+        /* Doubling splits a long run, but not one of colliding hashes */
+        while ((i = robin_place(ht, hash)) == robin_end(ht)) {
+            if (robin_collisions(ht, hash) >= ROBIN_MAX_DIST)
+                return ERR_CAPACITY_OVERFLOW;
+            if ((stat = robin_grow(ht))) return stat;
+        }
+        /* The slot is already full, so an arena reallocation by key_store
+         * moves an empty string key for it */
+        if (hashmap_strkeys(ht))
+            memset(robin_slot(ht, i), 0, sizeof(hashmap_strref_t));
+        stat = key_store(ht, robin_slot(ht, i), key);
+        if (stat) {
+            robin_unlink(ht, i);
+            return stat;
         }
-        entry = entry->next;
+        ht->growth_left--;
+        ht->size++;
     }
-
-    hashmap_entry_t new_entry = NULL;
-    if (entry_alloc(ht, &new_entry))
-        return ERR_MEMORY_ALLOCATION;
-    memcpy(new_entry->key, key, ht->key_len);
-    new_entry->hash = hash;
-    new_entry->next = ht->entries[i];
-    memcpy(new_entry->elem, val, ht->elem_size);
-
-    ht->entries[i] = new_entry;
-    ht->size++;
+    *ret_elem = robin_elem(ht, i);
     return COMPLETE;
 }
 
 /**
- * Remove a mapping from the hashmap
+ * Remove a mapping from the Robin Hood engine
  * 
  * @param ht Hashmap
  * @param key Key to remove
+ * @param hash Hash of the key
  * @param ret_val Pointer to the value to return
  * @return COMPLETE on success, corresponding error code on failure
  */
-stat_t hashmap_remove(hashmap_t ht, void* key, void* ret_val)
+static stat_t robin_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
 {
-    if (!key) return null_entry_remove(ht, ret_val);
-
-    uint64_t hash = hashmap_hash(ht, key);
-    size_t i = hash & (ht->capacity - 1);
-
-    hashmap_entry_t entry = ht->entries[i];
-    hashmap_entry_t prev = NULL;
-    while (entry) {
-        if (entry->key) {
-            int match = ht->cmp_fn ?
-                ht->cmp_fn(entry->key, key) :
-                memcmp(entry->key, key, ht->key_len);
-            if (match == 0) {
-                if (prev) prev->next = entry->next;
-                else ht->entries[i] = entry->next;
-                if (ret_val)
-                    memcpy(ret_val, entry->elem, ht->elem_size);
-                if (ht->free_fn) {
-                    ht->free_fn(entry->key);
-                    ht->free_fn(entry->elem);
-                    ht->free_fn(entry);
-                } else {
-                    free(entry->key);
-                    free(entry->elem);
-                    free(entry);
-                }
-                ht->size--;
-                return COMPLETE;
-            }
-        }
-        prev = entry;
-        entry = entry->next;
-    }
-    return ERR_INVALID_OPERATION;
+    size_t i = robin_find(ht, key, hash);
+    if (i == robin_end(ht)) return ERR_INVALID_OPERATION;
+    robin_erase(ht, i, ret_val);
+    return COMPLETE;
 }
 
 /**
- * Query a mapping from the hashmap
+ * Free a full slot of the Robin Hood engine
  * 
  * @param ht Hashmap
- * @param key Key to query
+ * @param i Index of the slot
  * @param ret_val Pointer to the value to return
- * @return COMPLETE on success, corresponding error code on failure
  */
-stat_t hashmap_query(hashmap_t ht, void* key, void* ret_val)
+static void robin_erase(hashmap_t ht, size_t i, void* ret_val)
 {
-    if (!key) return null_entry_query(ht, ret_val);
-
-    uint64_t hash = hashmap_hash(ht, key);
-    size_t i = hash & (ht->capacity - 1);
-
-    hashmap_entry_t entry = ht->entries[i];
-    while (entry) {
-        if (entry->key) {
-            int match = ht->cmp_fn ?
-                ht->cmp_fn(entry->key, key) :
-                memcmp(entry->key, key, ht->key_len);
-            if (match == 0) {
-                memcpy(ret_val, entry->elem, ht->elem_size);
-                return COMPLETE;
-            }
-        }
-        entry = entry->next;
-    }
-    return ERR_INVALID_OPERATION;
+    key_release(ht, robin_slot(ht, i));
+    if (ret_val)
+        memcpy(ret_val, robin_elem(ht, i), ht->elem_size);
+    robin_unlink(ht, i);
+    ht->growth_left++;
+    ht->size--;
 }
 
+/***********************************************************************************
+ * Ordered engine
+ * 
+ * Mappings are appended to a dense array of slots in insertion order, each with
+ * its full hash after the value, and an open addressing index of 32-bit
+ * positions maps hashes to them, as in the compact dict of CPython. Iteration
+ * is a linear scan of the slots, in insertion order. A removal marks its index
+ * entry as a tombstone and leaves a hole in the slots, the holes and tombstones
+ * are dropped when the slots run out and the index is rebuilt.
+ * See: https://mail.python.org/pipermail/python-dev/2012-December/123028.html
+ **********************************************************************************/
+
 /**
- * Copy a hashmap
+ * Allocate the index and slots, compacting the existing mappings in order
  * 
- * @param dst Pointer to the destination hashmap
- * @param src Source hashmap
+ * @param ht Hashmap
+ * @param capacity Number of index entries, a power of 2
  * @return COMPLETE on success, corresponding error code on failure
  */
-stat_t hashmap_copy(hashmap_t* dst, hashmap_t src)
+static stat_t ordered_alloc(hashmap_t ht, size_t capacity)
 {
-    *dst = _hashmap_init(src->capacity,
-                         src->key_len,
-                         src->elem_size,
-                         src->hash_fn,
-                         src->cmp_fn,
-                         src->alloc_fn,
-                         src->free_fn);
-    if (!*dst) return ERR_MEMORY_ALLOCATION;
-
-    for (size_t i = 0; i < src->capacity; i++) {
-        hashmap_entry_t entry = src->entries[i];
-        while (entry) {
-            if (hashmap_assign(*dst, entry->key, entry->elem)) {
-                hashmap_deinit(*dst);
-                return ERR_MEMORY_ALLOCATION;
-            }
-            entry = entry->next;
+    void* (*alloc)(size_t) = ht->alloc_fn ? ht->alloc_fn : malloc;
+    void (*dealloc)(void*) = ht->free_fn ? ht->free_fn : free;
+
+    size_t max_load = ordered_max_load(capacity);
+    size_t live = ht->ctrl ? ht->size - (ht->null_elem != NULL) : 0;
+    /* Positions are stored plus one, and the largest value marks a tombstone */
+    if (max_load >= ORDERED_DUMMY || live > max_load ||
+        capacity > SIZE_MAX / 2 / sizeof(uint32_t))
+        return ERR_CAPACITY_OVERFLOW;
+    size_t head = ordered_head(capacity);
+    if (max_load > (SIZE_MAX - head) / ht->hashed_stride)
+        return ERR_CAPACITY_OVERFLOW;
+    uint64_t start = stats_clock();
+    uint8_t* ctrl = alloc(head + max_load * ht->hashed_stride);
+    if (!ctrl) return ERR_MEMORY_ALLOCATION;
+    stats_alloc(ht, head + max_load * ht->hashed_stride);
+    memset(ctrl, 0, head);
+
+    uint8_t* old_ctrl = ht->ctrl;
+    char* old_slots = ht->slots;
+    size_t old_used = old_ctrl ? ordered_used(ht) : 0;
+    const uint64_t* old_live = old_ctrl ? ordered_live(ht) : NULL;
+
+    ht->ctrl = ctrl;
+    ht->slots = (char*)ctrl + head;
+    ht->capacity = capacity;
+    uint32_t* index = ordered_index(ht);
+    uint64_t* bits = ordered_live(ht);
+    size_t n = 0;
+    for (size_t w = 0; w < bucket_words(old_used); w++) {
+        for (uint64_t word = old_live[w]; word; word &= word - 1) {
+            char* slot = old_slots + (w * 64 + ctz64(word)) * ht->hashed_stride;
+            memcpy(ordered_slot(ht, n), slot, ht->hashed_stride);
+            size_t i = (size_t)ordered_hash(ht, n) & (capacity - 1);
+            while (index[i] != ORDERED_EMPTY) i = (i + 1) & (capacity - 1);
+            index[i] = (uint32_t)(n + 1);
+            bits[n / 64] |= (uint64_t)1 << (n % 64);
+            n++;
         }
     }
+    ht->growth_left = max_load - n;
+    if (old_ctrl) {
+        dealloc(old_ctrl);
+        stats_resize(ht, start);
+    }
     return COMPLETE;
 }
 
 /**
- * Map a function over the key-value pairs of the hashmap
+ * Find the index entry of a key
  * 
  * @param ht Hashmap
- * @param fn Function to map
+ * @param key Key to find
+ * @param hash Hash of the key
+ * @return Index entry of the key, capacity if the key is not found
  */
-void hashmap_map(hashmap_t ht, void (*fn)(void*, void*))
+static size_t ordered_find(hashmap_t ht, void* key, uint64_t hash)
 {
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            fn(entry->key, entry->elem);
-            entry = entry->next;
-        }
+    const uint32_t* index = ordered_index(ht);
+    size_t mask = ht->capacity - 1;
+    /* Tombstones and positions take at most max_load entries, so a probe
+     * always reaches an empty one */
+    for (size_t i = (size_t)hash & mask; index[i] != ORDERED_EMPTY; i = (i + 1) & mask) {
+        stats_probe(ht);
+        if (index[i] == ORDERED_DUMMY) continue;
+        size_t e = index[i] - 1;
+        if (ordered_hash(ht, e) != hash) continue;
+        stats_compare(ht);
+        if (key_match(ht, ordered_slot(ht, e), key)) return i;
     }
+    return ht->capacity;
 }
 
 /**
- * Map a function over the keys of the hashmap
+ * Find the index entry pointing at a slot
  * 
  * @param ht Hashmap
- * @param fn Function to map
+ * @param e Position of a full slot
+ * @return Index entry of the slot
  */
-void hashmap_key_map(hashmap_t ht, void (*fn)(void*))
+static size_t ordered_locate(hashmap_t ht, size_t e)
 {
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            fn(entry->key);
-            entry = entry->next;
-        }
-    }
+    const uint32_t* index = ordered_index(ht);
+    size_t mask = ht->capacity - 1;
+    size_t i = (size_t)ordered_hash(ht, e) & mask;
+    while (index[i] != e + 1) i = (i + 1) & mask;
+    return i;
 }
 
 /**
- * Map a function over the values of the hashmap
+ * Find the next full slot in insertion order
  * 
  * @param ht Hashmap
- * @param fn Function to map
+ * @param e Position to start from
+ * @return Position of the first full slot from e, ordered_used if none
  */
-void hashmap_val_map(hashmap_t ht, void (*fn)(void*))
+static size_t ordered_next(hashmap_t ht, size_t e)
 {
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            fn(entry->elem);
-            entry = entry->next;
-        }
+    const uint64_t* bits = ordered_live(ht);
+    size_t used = ordered_used(ht);
+    size_t words = bucket_words(used);
+    size_t w = e / 64;
+    if (w >= words) return used;
+    uint64_t word = bits[w] & (~(uint64_t)0 << (e % 64));
+    while (!word) {
+        if (++w == words) return used;
+        word = bits[w];
     }
+    return w * 64 + ctz64(word);
 }
 
 /**
- * Free the entries of the hashmap
+ * Find or append the slot of a key in the ordered engine
  * 
  * @param ht Hashmap
+ * @param key Key to find or insert
+ * @param hash Hash of the key
+ * @param ret_elem Pointer to the value slot to return
+ * @param created Pointer to set to 1 if the slot is inserted, 0 otherwise
+ * @return COMPLETE on success, corresponding error code on failure
  */
-void hashmap_clear(hashmap_t ht)
+static stat_t ordered_emplace(hashmap_t ht,
+                              void* key,
+                              uint64_t hash,
+                              void** ret_elem,
+                              int* created)
 {
-    for (size_t i = 0; i < ht->capacity; i++) {
-        hashmap_entry_t entry = ht->entries[i];
-        while (entry) {
-            hashmap_entry_t next = entry->next;
-            if (ht->free_fn) {
-                ht->free_fn(entry->key);
-                ht->free_fn(entry->elem);
-                ht->free_fn(entry);
-            } else {
-                free(entry->key);
-                free(entry->elem);
-                free(entry);
+    size_t i = ordered_find(ht, key, hash);
+
+    *created = i == ht->capacity;
+    if (*created) {
+        stat_t stat;
+        if (ht->growth_left == 0) {
+            /* Compact in place when at least half the slots are holes,
+             * so alternating inserts and removals do not keep growing */
+            size_t live = ht->size - (ht->null_elem != NULL);
+            size_t capacity = ht->capacity;
+            if (live >= ordered_max_load(capacity) / 2) {
+                if (capacity << 1 >= HASHMAP_MAX_CAPACITY)
+                    return ERR_CAPACITY_OVERFLOW;
+                capacity <<= 1;
             }
-            entry = next;
+            if ((stat = ordered_alloc(ht, capacity)))
+                return stat;
         }
-        ht->entries[i] = NULL;
+        /* The slot is not live yet, so an arena reallocation by key_store
+         * leaves it alone */
+        size_t e = ordered_used(ht);
+        stat = key_store(ht, ordered_slot(ht, e), key);
+        if (stat) return stat;
+        ordered_hash(ht, e) = hash;
+        ordered_live(ht)[e / 64] |= (uint64_t)1 << (e % 64);
+        uint32_t* index = ordered_index(ht);
+        i = (size_t)hash & (ht->capacity - 1);
+        while (index[i] != ORDERED_EMPTY) i = (i + 1) & (ht->capacity - 1);
+        index[i] = (uint32_t)(e + 1);
+        ht->growth_left--;
+        ht->size++;
     }
-    ht->size = 0;
+    *ret_elem = ordered_elem(ht, ordered_index(ht)[i] - 1);
+    return COMPLETE;
 }
 
 /**
- * Free the hashmap and its entries
+ * Remove a mapping from the ordered engine
  * 
  * @param ht Hashmap
+ * @param key Key to remove
+ * @param hash Hash of the key
+ * @param ret_val Pointer to the value to return
+ * @return COMPLETE on success, corresponding error code on failure
  */
-void hashmap_deinit(hashmap_t ht)
+static stat_t ordered_remove(hashmap_t ht, void* key, uint64_t hash, void* ret_val)
 {
-    hashmap_clear(ht);
-    if (ht->free_fn) {
-        ht->free_fn(ht->entries);
-    } else {
-        free(ht->entries);
-    }
-    free(ht);
+    size_t i = ordered_find(ht, key, hash);
+    if (i == ht->capacity) return ERR_INVALID_OPERATION;
+    ordered_erase(ht, i, ret_val);
+    return COMPLETE;
+}
+
+/**
+ * Free the slot an index entry points at, leaving a tombstone and a hole
+ * 
+ * @param ht Hashmap
+ * @param i Index entry
+ * @param ret_val Pointer to the value to return
+ */
+static void ordered_erase(hashmap_t ht, size_t i, void* ret_val)
+{
+    uint32_t* index = ordered_index(ht);
+    size_t e = index[i] - 1;
+    key_release(ht, ordered_slot(ht, e));
+    if (ret_val)
+        memcpy(ret_val, ordered_elem(ht, e), ht->elem_size);
+    index[i] = ORDERED_DUMMY;
+    ordered_live(ht)[e / 64] &= ~((uint64_t)1 << (e % 64));
+    ht->size--;
 }
 
 /**
@@ -700,6 +5687,19 @@ static size_t roundup_pow2(size_t n)
     return n;
 } 
 
+/**
+ * Get the alignment implied by the size of an object
+ * 
+ * @param size Size of the object
+ * @return Largest power of 2 dividing the size, capped at HASHMAP_MAX_ALIGN
+ */
+static size_t size_align(size_t size)
+{
+    size_t align = size & (~size + 1);
+    if (align == 0) return 1;
+    return align > HASHMAP_MAX_ALIGN ? HASHMAP_MAX_ALIGN : align;
+}
+
 uint64_t djb2hash64(const char* s, size_t len)
 {
     uint64_t hash = 5381;
@@ -708,6 +5708,40 @@ uint64_t djb2hash64(const char* s, size_t len)
     return hash;
 }
 
+/**
+ * Multiply two 64-bit integers into a 128-bit product
+ * 
+ * @param a First factor
+ * @param b Second factor
+ * @param lo Low 64 bits of the product
+ * @param hi High 64 bits of the product
+ */
+static void mul128(uint64_t a, uint64_t b, uint64_t* lo, uint64_t* hi)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    *lo = (uint64_t)r;
+    *hi = (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    *lo = _umul128(a, b, hi);
+#else
+    uint64_t ll = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hl = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t lh = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hh = (a >> 32) * (b >> 32);
+    uint64_t cross = (ll >> 32) + (hl & 0xFFFFFFFF) + lh;
+    *hi = (hl >> 32) + (cross >> 32) + hh;
+    *lo = (cross << 32) | (ll & 0xFFFFFFFF);
+#endif
+}
+
+uint64_t intmix64(uint64_t x, uint64_t seed)
+{
+    uint64_t lo, hi;
+    mul128(x ^ seed ^ 0x2d358dccaa6c78a5ULL, 0x9E3779B97F4A7C15ULL, &lo, &hi);
+    return lo ^ hi;
+}
+
 /***********************************************************************************
  * Original code from cityhash-c - MIT license
  * Copyright (c) 2011-2012, Alexander Nusov
@@ -888,3 +5922,328 @@ uint64_t cityhash64(const char *s, size_t len)
     return hashlen16(hashlen16(v.first, w.first) + shiftmix(y) * k1 + z,
                      hashlen16(v.second, w.second) + x);
 }
+
+static uint64_t cityhash64_seed(const char *s, size_t len, uint64_t seed)
+{
+    return hashlen16(cityhash64(s, len) - k2, seed);
+}
+
+/***********************************************************************************
+ * Original code from xxHash - BSD 2-Clause license
+ * Copyright (c) 2012-2021 Yann Collet
+ * See: https://github.com/Cyan4973/xxHash
+ * 
+ * Simplified scalar version with only the XXH3_64bits_withSeed
+ **********************************************************************************/
+
+#define XXH_PRIME32_1 0x9E3779B1U
+#define XXH_PRIME32_2 0x85EBCA77U
+#define XXH_PRIME32_3 0xC2B2AE3DU
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1 0x165667919E3779F9ULL
+#define XXH_PRIME_MX2 0x9FB21C651E98DF25ULL
+
+#define XXH_SECRET_SIZE 192
+#define XXH_STRIPE_LEN 64
+#define XXH_SECRET_CONSUME_RATE 8
+#define XXH_MIDSIZE_STARTOFFSET 3
+#define XXH_MIDSIZE_LASTOFFSET 17
+#define XXH_SECRET_LASTACC_START 7
+#define XXH_SECRET_MERGEACCS_START 11
+
+static const uint8_t xxh_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static uint64_t xxh_read64(const uint8_t* p)
+{
+    return fetch64((const char*)p);
+}
+
+static uint32_t xxh_read32(const uint8_t* p)
+{
+    return fetch32((const char*)p);
+}
+
+static uint64_t xxh_rotl64(uint64_t x, int r)
+{
+    return (x << r) | (x >> (64 - r));
+}
+
+static uint32_t xxh_swap32(uint32_t x)
+{
+    return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) |
+           ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+static uint64_t xxh_swap64(uint64_t x)
+{
+    return ((uint64_t)xxh_swap32((uint32_t)x) << 32) | xxh_swap32((uint32_t)(x >> 32));
+}
+
+static uint64_t xxh_mul128_fold64(uint64_t lhs, uint64_t rhs)
+{
+    uint64_t lo, hi;
+    mul128(lhs, rhs, &lo, &hi);
+    return lo ^ hi;
+}
+
+static uint64_t xxh64_avalanche(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xxh3_avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len)
+{
+    h ^= xxh_rotl64(h, 49) ^ xxh_rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t xxh3_len0to16(const uint8_t* p, size_t len, uint64_t seed)
+{
+    const uint8_t* secret = xxh_secret;
+    if (len > 8) {
+        uint64_t bitflip1 = (xxh_read64(secret + 24) ^ xxh_read64(secret + 32)) + seed;
+        uint64_t bitflip2 = (xxh_read64(secret + 40) ^ xxh_read64(secret + 48)) - seed;
+        uint64_t lo = xxh_read64(p) ^ bitflip1;
+        uint64_t hi = xxh_read64(p + len - 8) ^ bitflip2;
+        uint64_t acc = len + xxh_swap64(lo) + hi + xxh_mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+    if (len >= 4) {
+        seed ^= (uint64_t)xxh_swap32((uint32_t)seed) << 32;
+        uint32_t in1 = xxh_read32(p);
+        uint32_t in2 = xxh_read32(p + len - 4);
+        uint64_t bitflip = (xxh_read64(secret + 8) ^ xxh_read64(secret + 16)) - seed;
+        uint64_t keyed = (in2 + ((uint64_t)in1 << 32)) ^ bitflip;
+        return xxh3_rrmxmx(keyed, len);
+    }
+    if (len > 0) {
+        uint32_t c1 = p[0];
+        uint32_t c2 = p[len >> 1];
+        uint32_t c3 = p[len - 1];
+        uint32_t combined = (c1 << 16) | (c2 << 24) | c3 | ((uint32_t)len << 8);
+        uint64_t bitflip = (xxh_read32(secret) ^ xxh_read32(secret + 4)) + seed;
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+    return xxh64_avalanche(seed ^ xxh_read64(secret + 56) ^ xxh_read64(secret + 64));
+}
+
+static uint64_t xxh3_mix16(const uint8_t* p, const uint8_t* secret, uint64_t seed)
+{
+    uint64_t lo = xxh_read64(p);
+    uint64_t hi = xxh_read64(p + 8);
+    return xxh_mul128_fold64(lo ^ (xxh_read64(secret) + seed),
+                             hi ^ (xxh_read64(secret + 8) - seed));
+}
+
+static uint64_t xxh3_len17to128(const uint8_t* p, size_t len, uint64_t seed)
+{
+    const uint8_t* secret = xxh_secret;
+    uint64_t acc = len * XXH_PRIME64_1;
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) {
+                acc += xxh3_mix16(p + 48, secret + 96, seed);
+                acc += xxh3_mix16(p + len - 64, secret + 112, seed);
+            }
+            acc += xxh3_mix16(p + 32, secret + 64, seed);
+            acc += xxh3_mix16(p + len - 48, secret + 80, seed);
+        }
+        acc += xxh3_mix16(p + 16, secret + 32, seed);
+        acc += xxh3_mix16(p + len - 32, secret + 48, seed);
+    }
+    acc += xxh3_mix16(p, secret, seed);
+    acc += xxh3_mix16(p + len - 16, secret + 16, seed);
+    return xxh3_avalanche(acc);
+}
+
+static uint64_t xxh3_len129to240(const uint8_t* p, size_t len, uint64_t seed)
+{
+    const uint8_t* secret = xxh_secret;
+    uint64_t acc = len * XXH_PRIME64_1;
+    size_t rounds = len / 16;
+    for (size_t i = 0; i < 8; i++)
+        acc += xxh3_mix16(p + 16 * i, secret + 16 * i, seed);
+    acc = xxh3_avalanche(acc);
+    for (size_t i = 8; i < rounds; i++)
+        acc += xxh3_mix16(p + 16 * i, secret + 16 * (i - 8) + XXH_MIDSIZE_STARTOFFSET, seed);
+    acc += xxh3_mix16(p + len - 16,
+                      secret + 136 - XXH_MIDSIZE_LASTOFFSET,
+                      seed);
+    return xxh3_avalanche(acc);
+}
+
+static void xxh3_accumulate512(uint64_t* acc, const uint8_t* p, const uint8_t* secret)
+{
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t data = xxh_read64(p + 8 * i);
+        uint64_t key = data ^ xxh_read64(secret + 8 * i);
+        acc[i ^ 1] += data;
+        acc[i] += (key & 0xFFFFFFFF) * (key >> 32);
+    }
+}
+
+static void xxh3_scramble(uint64_t* acc, const uint8_t* secret)
+{
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= xxh_read64(secret + 8 * i);
+        a *= XXH_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+static uint64_t xxh3_long(const uint8_t* p, size_t len, uint64_t seed)
+{
+    uint8_t secret[XXH_SECRET_SIZE];
+    for (size_t i = 0; i < XXH_SECRET_SIZE; i += 16) {
+        uint64_t lo = xxh_read64(xxh_secret + i) + seed;
+        uint64_t hi = xxh_read64(xxh_secret + i + 8) - seed;
+        memcpy(secret + i, &lo, 8);
+        memcpy(secret + i + 8, &hi, 8);
+    }
+
+    uint64_t acc[8] = {
+        XXH_PRIME32_3, XXH_PRIME64_1, XXH_PRIME64_2, XXH_PRIME64_3,
+        XXH_PRIME64_4, XXH_PRIME32_2, XXH_PRIME64_5, XXH_PRIME32_1
+    };
+    size_t stripes_per_block = (XXH_SECRET_SIZE - XXH_STRIPE_LEN) / XXH_SECRET_CONSUME_RATE;
+    size_t block_len = XXH_STRIPE_LEN * stripes_per_block;
+    size_t blocks = (len - 1) / block_len;
+
+    for (size_t n = 0; n < blocks; n++) {
+        for (size_t s = 0; s < stripes_per_block; s++)
+            xxh3_accumulate512(acc,
+                               p + n * block_len + s * XXH_STRIPE_LEN,
+                               secret + s * XXH_SECRET_CONSUME_RATE);
+        xxh3_scramble(acc, secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN);
+    }
+
+    size_t stripes = ((len - 1) - block_len * blocks) / XXH_STRIPE_LEN;
+    for (size_t s = 0; s < stripes; s++)
+        xxh3_accumulate512(acc,
+                           p + blocks * block_len + s * XXH_STRIPE_LEN,
+                           secret + s * XXH_SECRET_CONSUME_RATE);
+    xxh3_accumulate512(acc,
+                       p + len - XXH_STRIPE_LEN,
+                       secret + XXH_SECRET_SIZE - XXH_STRIPE_LEN - XXH_SECRET_LASTACC_START);
+
+    uint64_t result = len * XXH_PRIME64_1;
+    for (size_t i = 0; i < 4; i++) {
+        const uint8_t* key = secret + XXH_SECRET_MERGEACCS_START + 16 * i;
+        result += xxh_mul128_fold64(acc[2 * i] ^ xxh_read64(key),
+                                    acc[2 * i + 1] ^ xxh_read64(key + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+uint64_t xxh3hash64(const char* s, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)s;
+    if (len <= 16) return xxh3_len0to16(p, len, seed);
+    if (len <= 128) return xxh3_len17to128(p, len, seed);
+    if (len <= 240) return xxh3_len129to240(p, len, seed);
+    return xxh3_long(p, len, seed);
+}
+
+/***********************************************************************************
+ * Original code from wyhash - The Unlicense
+ * Copyright (c) 2019-2023 Wang Yi
+ * See: https://github.com/wangyi-fudan/wyhash
+ * 
+ * Simplified version with only the final4 wyhash and its default secret
+ **********************************************************************************/
+
+static const uint64_t wy_secret[4] = {
+    0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL,
+    0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+};
+
+static uint64_t wy_mix(uint64_t a, uint64_t b)
+{
+    uint64_t lo, hi;
+    mul128(a, b, &lo, &hi);
+    return lo ^ hi;
+}
+
+static uint64_t wy_read3(const uint8_t* p, size_t k)
+{
+    return ((uint64_t)p[0] << 16) | ((uint64_t)p[k >> 1] << 8) | p[k - 1];
+}
+
+uint64_t wyhash64(const char* s, size_t len, uint64_t seed)
+{
+    const uint8_t* p = (const uint8_t*)s;
+    uint64_t a, b;
+
+    seed ^= wy_mix(seed ^ wy_secret[0], wy_secret[1]);
+    if (len <= 16) {
+        if (len >= 4) {
+            a = ((uint64_t)xxh_read32(p) << 32) | xxh_read32(p + ((len >> 3) << 2));
+            b = ((uint64_t)xxh_read32(p + len - 4) << 32) |
+                xxh_read32(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wy_read3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i >= 48) {
+            uint64_t see1 = seed, see2 = seed;
+            do {
+                seed = wy_mix(xxh_read64(p) ^ wy_secret[1], xxh_read64(p + 8) ^ seed);
+                see1 = wy_mix(xxh_read64(p + 16) ^ wy_secret[2], xxh_read64(p + 24) ^ see1);
+                see2 = wy_mix(xxh_read64(p + 32) ^ wy_secret[3], xxh_read64(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wy_mix(xxh_read64(p) ^ wy_secret[1], xxh_read64(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = xxh_read64(p + i - 16);
+        b = xxh_read64(p + i - 8);
+    }
+    a ^= wy_secret[1];
+    b ^= seed;
+    mul128(a, b, &a, &b);
+    return wy_mix(a ^ wy_secret[0] ^ len, b ^ wy_secret[1]);
+}
@@ -0,0 +1,41 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+/* Private hashmap entry points for the modules built on top of it, not installed */
+
+#ifndef __CAT_HASHMAP_INTERNAL_H__
+#define __CAT_HASHMAP_INTERNAL_H__
+
+#include "cat_hashmap.h"
+
+uint64_t _hashmap_hash(hashmap_t ht, void* key);
+void* _hashmap_find_hashed(hashmap_t ht, void* key, uint64_t hash);
+void* _hashmap_emplace_hashed(hashmap_t ht, void* key, uint64_t hash, int* created);
+void* _hashmap_elem_key(hashmap_t ht, void* elem);
+stat_t _hashmap_assign_hashed(hashmap_t ht, void* key, uint64_t hash, void* val);
+stat_t _hashmap_remove_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+stat_t _hashmap_query_hashed(hashmap_t ht, void* key, uint64_t hash, void* ret_val);
+hashmap_t _hashmap_init_like(hashmap_t ht, size_t capacity);
+int _hashmap_compatible(hashmap_t a, hashmap_t b);
+
+#endif
@@ -0,0 +1,349 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#include "cat_hashset.h"
+#include "cat_hashmap_internal.h"
+
+#include <stdlib.h>
+
+/* A hashset is a hashmap whose values are zero bytes long, so entries and
+ * slots hold nothing but the key and value copies move no bytes */
+#define set_map(set) ((hashmap_t)(set))
+
+/* Value passed for every member, never read or written */
+static char no_value;
+
+static hashset_t set_init_like(hashset_t set, size_t size);
+static stat_t set_filter(hashset_t* dst, hashset_t like, hashset_t from, hashset_t by, int keep);
+
+/**
+ * Get the number of members of the hashset
+ * 
+ * @param set Hashset
+ * @return Size of the hashset
+ */
+size_t hashset_size(hashset_t set)
+{
+    return hashmap_size(set_map(set));
+}
+
+/**
+ * Get the capacity of the hashset
+ * 
+ * @param set Hashset
+ * @return Capacity of the hashset
+ */
+size_t hashset_capacity(hashset_t set)
+{
+    return hashmap_capacity(set_map(set));
+}
+
+/**
+ * Check if the hashset is empty
+ * 
+ * @param set Hashset
+ * @return 1 if the hashset is empty, 0 otherwise
+ */
+int hashset_is_empty(hashset_t set)
+{
+    return hashmap_is_empty(set_map(set));
+}
+
+/**
+ * Check if a key is a member of the hashset
+ * 
+ * @param set Hashset
+ * @param key Key to check
+ * @return 1 if the key is a member, 0 otherwise
+ */
+int hashset_contains(hashset_t set, void* key)
+{
+    return hashmap_contains_key(set_map(set), key);
+}
+
+/**
+ * Initialize a hashset
+ * 
+ * @param capacity Initial capacity of the hashset
+ * @param key_len Length of the key
+ * @param flags Same as _hashmap_init
+ * @param hash_fn Hash function, NULL for the one selected by flags
+ * @param cmp_fn Comparison function, NULL for default memcmp
+ * @param alloc_fn Allocation function, NULL for default malloc
+ * @param free_fn Free function, NULL for default free
+ * @return Initialized hashset on success, NULL on failure
+ */
+hashset_t _hashset_init(size_t capacity,
+                        size_t key_len,
+                        unsigned flags,
+                        uint64_t (*hash_fn)(const char*),
+                        int (*cmp_fn)(const void*, const void*),
+                        void* (*alloc_fn)(size_t),
+                        void (*free_fn)(void*))
+{
+    return (hashset_t)_hashmap_init(capacity,
+                                    key_len,
+                                    0,
+                                    flags,
+                                    hash_fn,
+                                    cmp_fn,
+                                    alloc_fn,
+                                    free_fn);
+}
+
+/**
+ * Reserve memory for the hashset
+ * 
+ * @param set Hashset
+ * @param capacity Capacity of the buffer to reserve
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_reserve(hashset_t set, size_t capacity)
+{
+    return hashmap_reserve(set_map(set), capacity);
+}
+
+/**
+ * Add a key to the hashset, adding a member again has no effect
+ * 
+ * @param set Hashset
+ * @param key Key to add
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_add(hashset_t set, void* key)
+{
+    return hashmap_assign(set_map(set), key, &no_value);
+}
+
+/**
+ * Remove a key from the hashset
+ * 
+ * @param set Hashset
+ * @param key Key to remove
+ * @return COMPLETE on success, ERR_INVALID_OPERATION if the key is not a member
+ */
+stat_t hashset_remove(hashset_t set, void* key)
+{
+    return hashmap_remove(set_map(set), key, NULL);
+}
+
+/**
+ * Copy a hashset
+ * 
+ * @param dst Pointer to the copy to return
+ * @param src Hashset to copy
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_copy(hashset_t* dst, hashset_t src)
+{
+    return hashmap_copy((hashmap_t*)dst, set_map(src));
+}
+
+/**
+ * Build the union of two hashsets, a copy of the larger one
+ * that the members of the smaller one are added to
+ * 
+ * @param dst Pointer to the union to return
+ * @param a Hashset
+ * @param b Hashset with keys of the same kind
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_union(hashset_t* dst, hashset_t a, hashset_t b)
+{
+    if (!_hashmap_compatible(set_map(a), set_map(b)))
+        return ERR_INVALID_OPERATION;
+    hashset_t small = hashset_size(a) < hashset_size(b) ? a : b;
+    stat_t stat = hashset_copy(dst, small == a ? b : a);
+    if (stat) return stat;
+
+    hashset_iter_t it;
+    void* key;
+    hashset_iter_init(&it, small);
+    while (hashset_iter_next(&it, &key)) {
+        stat = hashset_add(*dst, key);
+        if (stat) {
+            hashset_deinit(*dst);
+            return stat;
+        }
+    }
+    return COMPLETE;
+}
+
+/**
+ * Build the intersection of two hashsets by looking up the members
+ * of the smaller one in the larger one, a copy when both are the same
+ * 
+ * @param dst Pointer to the intersection to return, configured like a
+ * @param a Hashset
+ * @param b Hashset with keys of the same kind
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_intersection(hashset_t* dst, hashset_t a, hashset_t b)
+{
+    if (!_hashmap_compatible(set_map(a), set_map(b)))
+        return ERR_INVALID_OPERATION;
+    if (a == b) return hashset_copy(dst, a);
+    if (hashset_size(a) <= hashset_size(b))
+        return set_filter(dst, a, a, b, 1);
+    return set_filter(dst, a, b, a, 1);
+}
+
+/**
+ * Build the difference of two hashsets, the members of a that are not in b.
+ * When a is the smaller one its members are looked up in b, otherwise a is
+ * copied and the members of b are removed from the copy. The difference of
+ * a hashset with itself is empty
+ * 
+ * @param dst Pointer to the difference to return, configured like a
+ * @param a Hashset
+ * @param b Hashset with keys of the same kind
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_difference(hashset_t* dst, hashset_t a, hashset_t b)
+{
+    if (!_hashmap_compatible(set_map(a), set_map(b)))
+        return ERR_INVALID_OPERATION;
+    if (a == b) {
+        *dst = set_init_like(a, 0);
+        return *dst ? COMPLETE : ERR_MEMORY_ALLOCATION;
+    }
+    if (hashset_size(a) <= hashset_size(b))
+        return set_filter(dst, a, a, b, 0);
+
+    stat_t stat = hashset_copy(dst, a);
+    if (stat) return stat;
+    hashset_iter_t it;
+    void* key;
+    hashset_iter_init(&it, b);
+    while (hashset_iter_next(&it, &key))
+        hashset_remove(*dst, key);
+    return COMPLETE;
+}
+
+/**
+ * Build a hashset of the members of one hashset that are, or are not,
+ * members of another
+ * 
+ * @param dst Pointer to the hashset to return
+ * @param like Hashset to take the configuration from
+ * @param from Hashset whose members are visited
+ * @param by Hashset the members are looked up in
+ * @param keep 1 to keep the members found in by, 0 to keep the others
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static stat_t set_filter(hashset_t* dst, hashset_t like, hashset_t from, hashset_t by, int keep)
+{
+    *dst = set_init_like(like, hashset_size(from));
+    if (!*dst) return ERR_MEMORY_ALLOCATION;
+
+    hashset_iter_t it;
+    void* key;
+    hashset_iter_init(&it, from);
+    while (hashset_iter_next(&it, &key)) {
+        if (hashset_contains(by, key) != keep) continue;
+        stat_t stat = hashset_add(*dst, key);
+        if (stat) {
+            hashset_deinit(*dst);
+            return stat;
+        }
+    }
+    return COMPLETE;
+}
+
+/**
+ * Initialize an empty hashset configured like another one,
+ * with room for a number of members
+ * 
+ * @param set Hashset to take the configuration from
+ * @param size Number of members to make room for
+ * @return Initialized hashset on success, NULL on failure
+ */
+static hashset_t set_init_like(hashset_t set, size_t size)
+{
+    return (hashset_t)_hashmap_init_like(set_map(set), size + size / 3 + 1);
+}
+
+/**
+ * Apply a function to every member of the hashset
+ * 
+ * @param set Hashset
+ * @param fn Function to apply to each key
+ */
+void hashset_map(hashset_t set, void (*fn)(void*))
+{
+    hashmap_key_map(set_map(set), fn);
+}
+
+/**
+ * Initialize a cursor over the members of the hashset
+ * 
+ * @param it Cursor to initialize
+ * @param set Hashset
+ */
+void hashset_iter_init(hashset_iter_t* it, hashset_t set)
+{
+    hashmap_iter_init(it, set_map(set));
+}
+
+/**
+ * Advance a cursor to the next member
+ * 
+ * @param it Cursor
+ * @param key Pointer to the key to return, NULL for the member NULL
+ * @return 1 if a member is returned, 0 at the end of the hashset
+ */
+int hashset_iter_next(hashset_iter_t* it, void** key)
+{
+    return hashmap_iter_next(it, key, NULL);
+}
+
+/**
+ * Remove the member a cursor is at
+ * 
+ * @param it Cursor
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+stat_t hashset_iter_remove(hashset_iter_t* it)
+{
+    return hashmap_iter_remove(it, NULL);
+}
+
+/**
+ * Clear the hashset
+ * 
+ * @param set Hashset
+ */
+void hashset_clear(hashset_t set)
+{
+    hashmap_clear(set_map(set));
+}
+
+/**
+ * Deinitialize the hashset
+ * 
+ * @param set Hashset
+ */
+void hashset_deinit(hashset_t set)
+{
+    hashmap_deinit(set_map(set));
+}
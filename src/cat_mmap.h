@@ -0,0 +1,119 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+
+/* Private read-only file mapping shim over POSIX and Win32, not installed */
+
+#ifndef __CAT_MMAP_H__
+#define __CAT_MMAP_H__
+
+#include <stddef.h>
+#include "cat_error.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    const char* addr;
+    size_t      len;
+#ifdef _WIN32
+    HANDLE      file;
+    HANDLE      mapping;
+#endif
+} cat_mmap_t;
+
+/**
+ * Map a whole file read-only
+ * 
+ * @param map Mapping to set
+ * @param path Path of the file
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static inline stat_t cat_mmap_open(cat_mmap_t* map, const char* path)
+{
+#ifdef _WIN32
+    LARGE_INTEGER size;
+    map->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (map->file == INVALID_HANDLE_VALUE) return ERR_FILE_IO;
+    if (!GetFileSizeEx(map->file, &size) || size.QuadPart == 0 ||
+        (unsigned long long)size.QuadPart > (size_t)-1) {
+        CloseHandle(map->file);
+        return ERR_FILE_IO;
+    }
+    map->mapping = CreateFileMappingA(map->file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!map->mapping) {
+        CloseHandle(map->file);
+        return ERR_FILE_IO;
+    }
+    map->addr = MapViewOfFile(map->mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!map->addr) {
+        CloseHandle(map->mapping);
+        CloseHandle(map->file);
+        return ERR_FILE_IO;
+    }
+    map->len = (size_t)size.QuadPart;
+    return COMPLETE;
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return ERR_FILE_IO;
+    if (fstat(fd, &st) || st.st_size <= 0 || (unsigned long long)st.st_size > (size_t)-1) {
+        close(fd);
+        return ERR_FILE_IO;
+    }
+    void* addr = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return ERR_FILE_IO;
+    map->addr = addr;
+    map->len = (size_t)st.st_size;
+    return COMPLETE;
+#endif
+}
+
+/**
+ * Unmap a file mapped by cat_mmap_open
+ * 
+ * @param map Mapping to release
+ */
+static inline void cat_mmap_close(cat_mmap_t* map)
+{
+#ifdef _WIN32
+    UnmapViewOfFile(map->addr);
+    CloseHandle(map->mapping);
+    CloseHandle(map->file);
+#else
+    munmap((void*)map->addr, map->len);
+#endif
+}
+
+#endif
@@ -0,0 +1,248 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+/* Private threading shim over pthreads and Win32, not installed */
+
+#ifndef __CAT_THREAD_H__
+#define __CAT_THREAD_H__
+
+#include <stdlib.h>
+#include "cat_error.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#include <process.h>
+
+typedef SRWLOCK cat_mutex_t;
+typedef HANDLE cat_thread_t;
+#define CAT_MUTEX_INITIALIZER SRWLOCK_INIT
+#else
+#include <pthread.h>
+#include <sched.h>
+
+typedef pthread_mutex_t cat_mutex_t;
+typedef pthread_t cat_thread_t;
+#define CAT_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CAT_THREAD_LOCAL __declspec(thread)
+#else
+#define CAT_THREAD_LOCAL _Thread_local
+#endif
+
+/* Atomic accesses: pointer loads acquire and stores release, size_t
+ * counters are sequentially consistent. MSVC does not alias by type,
+ * so its versions go through void* and size_t views of the object */
+#if defined(__GNUC__) || defined(__clang__)
+#define cat_atomic_load_ptr(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define cat_atomic_store_ptr(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define cat_atomic_load_size(p) __atomic_load_n((p), __ATOMIC_SEQ_CST)
+#define cat_atomic_store_size(p, v) __atomic_store_n((p), (v), __ATOMIC_SEQ_CST)
+#define cat_atomic_fetch_add_size(p, v) __atomic_fetch_add((p), (v), __ATOMIC_SEQ_CST)
+#define cat_atomic_fetch_sub_size(p, v) __atomic_fetch_sub((p), (v), __ATOMIC_RELEASE)
+#elif defined(_MSC_VER)
+static inline void* cat_msvc_load_ptr(void* volatile* p)
+{
+#if defined(_M_ARM64)
+    return (void*)__ldar64((volatile unsigned __int64*)p);
+#else
+    void* v = *p;
+    _ReadWriteBarrier();
+    return v;
+#endif
+}
+
+static inline void cat_msvc_store_ptr(void* volatile* p, void* v)
+{
+#if defined(_M_ARM64)
+    __stlr64((volatile unsigned __int64*)p, (unsigned __int64)v);
+#else
+    _ReadWriteBarrier();
+    *p = v;
+#endif
+}
+
+static inline size_t cat_msvc_fetch_add_size(volatile size_t* p, size_t v)
+{
+#ifdef _WIN64
+    return (size_t)_InterlockedExchangeAdd64((volatile __int64*)p, (__int64)v);
+#else
+    return (size_t)_InterlockedExchangeAdd((volatile long*)p, (long)v);
+#endif
+}
+
+#define cat_atomic_load_ptr(p) cat_msvc_load_ptr((void* volatile*)(p))
+#define cat_atomic_store_ptr(p, v) cat_msvc_store_ptr((void* volatile*)(p), (void*)(v))
+static inline void cat_msvc_store_size(volatile size_t* p, size_t v)
+{
+#ifdef _WIN64
+    _InterlockedExchange64((volatile __int64*)p, (__int64)v);
+#else
+    _InterlockedExchange((volatile long*)p, (long)v);
+#endif
+}
+
+#define cat_atomic_load_size(p) cat_msvc_fetch_add_size((volatile size_t*)(p), 0)
+#define cat_atomic_store_size(p, v) cat_msvc_store_size((volatile size_t*)(p), (v))
+#define cat_atomic_fetch_add_size(p, v) cat_msvc_fetch_add_size((volatile size_t*)(p), (v))
+#define cat_atomic_fetch_sub_size(p, v) \
+    cat_msvc_fetch_add_size((volatile size_t*)(p), (size_t)0 - (v))
+#endif
+
+/**
+ * Initialize a mutex
+ * 
+ * @param mutex Mutex to initialize
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static inline stat_t cat_mutex_init(cat_mutex_t* mutex)
+{
+#ifdef _WIN32
+    InitializeSRWLock(mutex);
+    return COMPLETE;
+#else
+    return pthread_mutex_init(mutex, NULL) ? ERR_MEMORY_ALLOCATION : COMPLETE;
+#endif
+}
+
+/**
+ * Lock a mutex, blocking until it is available
+ * 
+ * @param mutex Mutex to lock
+ */
+static inline void cat_mutex_lock(cat_mutex_t* mutex)
+{
+#ifdef _WIN32
+    AcquireSRWLockExclusive(mutex);
+#else
+    pthread_mutex_lock(mutex);
+#endif
+}
+
+/**
+ * Unlock a mutex held by the calling thread
+ * 
+ * @param mutex Mutex to unlock
+ */
+static inline void cat_mutex_unlock(cat_mutex_t* mutex)
+{
+#ifdef _WIN32
+    ReleaseSRWLockExclusive(mutex);
+#else
+    pthread_mutex_unlock(mutex);
+#endif
+}
+
+/**
+ * Release the resources of a mutex
+ * 
+ * @param mutex Mutex to destroy
+ */
+static inline void cat_mutex_destroy(cat_mutex_t* mutex)
+{
+#ifdef _WIN32
+    (void)mutex;
+#else
+    pthread_mutex_destroy(mutex);
+#endif
+}
+
+/**
+ * Give up the rest of the time slice of the calling thread
+ */
+static inline void cat_thread_yield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+/* Function and argument handed to a new thread */
+typedef struct {
+    void (*fn)(void*);
+    void* arg;
+} cat_thread_start_t;
+
+#ifdef _WIN32
+static inline unsigned __stdcall cat_thread_main(void* p)
+#else
+static inline void* cat_thread_main(void* p)
+#endif
+{
+    cat_thread_start_t start = *(cat_thread_start_t*)p;
+    free(p);
+    start.fn(start.arg);
+#ifdef _WIN32
+    return 0;
+#else
+    return NULL;
+#endif
+}
+
+/**
+ * Start a thread
+ * 
+ * @param thread Thread handle to set
+ * @param fn Function to run in the thread
+ * @param arg Argument of the function
+ * @return COMPLETE on success, corresponding error code on failure
+ */
+static inline stat_t cat_thread_create(cat_thread_t* thread, void (*fn)(void*), void* arg)
+{
+    cat_thread_start_t* start = malloc(sizeof(cat_thread_start_t));
+    if (!start) return ERR_MEMORY_ALLOCATION;
+    start->fn = fn;
+    start->arg = arg;
+#ifdef _WIN32
+    *thread = (HANDLE)_beginthreadex(NULL, 0, cat_thread_main, start, 0, NULL);
+    if (*thread) return COMPLETE;
+#else
+    if (!pthread_create(thread, NULL, cat_thread_main, start)) return COMPLETE;
+#endif
+    free(start);
+    return ERR_MEMORY_ALLOCATION;
+}
+
+/**
+ * Wait for a thread to finish
+ * 
+ * @param thread Thread to join
+ */
+static inline void cat_thread_join(cat_thread_t thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+#else
+    pthread_join(thread, NULL);
+#endif
+}
+
+#endif
@@ -0,0 +1,105 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef __CAT_CACHE_H__
+#define __CAT_CACHE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cat_error.h"
+#include "cat_hashmap.h"
+
+/* Hashmap holding at most a fixed number of mappings, evicting by a policy */
+typedef struct cache_s* cache_t;
+
+/* Eviction policies of _cache_init */
+enum {
+    CACHE_LRU            = 0,   /* least recently used */
+    CACHE_CLOCK          = 1,   /* second chance, a hit only sets a reference bit */
+    CACHE_TINYLFU        = 2,   /* W-TinyLFU, an LRU window in front of a segmented
+                                   LRU admitting by estimated access frequency */
+};
+
+size_t cache_size(cache_t cache);
+size_t cache_capacity(cache_t cache);
+size_t cache_hits(cache_t cache);
+size_t cache_misses(cache_t cache);
+size_t cache_evictions(cache_t cache);
+
+int cache_contains(cache_t cache, void* key);
+
+cache_t _cache_init(size_t capacity,
+                    size_t key_len,
+                    size_t elem_size,
+                    int policy,
+                    unsigned flags,
+                    uint64_t (*hash_fn)(const char*),
+                    int (*cmp_fn)(const void*, const void*),
+                    void* (*alloc_fn)(size_t),
+                    void (*free_fn)(void*));
+void cache_set_evict_fn(cache_t cache, void (*evict_fn)(void*, void*));
+stat_t cache_put(cache_t cache, void* key, void* val);
+stat_t cache_get(cache_t cache, void* key, void* ret_val);
+stat_t cache_remove(cache_t cache, void* key, void* ret_val);
+void cache_clear(cache_t cache);
+void cache_deinit(cache_t cache);
+
+#define cache(key_type, val_type, capacity, policy) \
+    _cache_init(capacity, \
+                sizeof(key_type), \
+                sizeof(val_type), \
+                policy, \
+                HASHMAP_CHAINED, \
+                NULL, \
+                NULL, \
+                NULL, \
+                NULL)
+
+#define cache_flags(key_type, val_type, capacity, policy, flags) \
+    _cache_init(capacity, \
+                sizeof(key_type), \
+                sizeof(val_type), \
+                policy, \
+                flags, \
+                NULL, \
+                NULL, \
+                NULL, \
+                NULL)
+
+#define cache_custom(key_type, val_type, capacity, policy, ...) \
+    _cache_init(capacity, \
+                sizeof(key_type), \
+                sizeof(val_type), \
+                policy, \
+                HASHMAP_CHAINED, \
+                ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,102 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef __CAT_CHASHMAP_H__
+#define __CAT_CHASHMAP_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cat_error.h"
+#include "cat_hashmap.h"
+
+/* Hashmap split into independently locked shards, safe to share between threads */
+typedef struct chashmap_s* chashmap_t;
+
+#define CHASHMAP_DEFAULT_SHARDS 64
+
+size_t chashmap_size(chashmap_t ht);
+size_t chashmap_capacity(chashmap_t ht);
+size_t chashmap_shards(chashmap_t ht);
+
+int chashmap_is_empty(chashmap_t ht);
+int chashmap_contains_key(chashmap_t ht, void* key);
+
+chashmap_t _chashmap_init(size_t shards,
+                          size_t capacity,
+                          size_t key_len,
+                          size_t elem_size,
+                          unsigned flags,
+                          uint64_t (*hash_fn)(const char*),
+                          int (*cmp_fn)(const void*, const void*),
+                          void* (*alloc_fn)(size_t),
+                          void (*free_fn)(void*));
+stat_t chashmap_reserve(chashmap_t ht, size_t capacity);
+stat_t chashmap_assign(chashmap_t ht, void* key, void* val);
+stat_t chashmap_remove(chashmap_t ht, void* key, void* ret_val);
+stat_t chashmap_query(chashmap_t ht, void* key, void* ret_val);
+
+void chashmap_map(chashmap_t ht, void (*fn)(void*, void*));
+void chashmap_key_map(chashmap_t ht, void (*fn)(void*));
+void chashmap_val_map(chashmap_t ht, void (*fn)(void*));
+void chashmap_clear(chashmap_t ht);
+void chashmap_deinit(chashmap_t ht);
+
+#define chashmap(key_type, val_type, capacity) \
+    _chashmap_init(CHASHMAP_DEFAULT_SHARDS, \
+                   capacity, \
+                   sizeof(key_type), \
+                   sizeof(val_type), \
+                   HASHMAP_CHAINED, \
+                   NULL, \
+                   NULL, \
+                   NULL, \
+                   NULL)
+
+#define chashmap_flags(key_type, val_type, capacity, shards, flags) \
+    _chashmap_init(shards, \
+                   capacity, \
+                   sizeof(key_type), \
+                   sizeof(val_type), \
+                   flags, \
+                   NULL, \
+                   NULL, \
+                   NULL, \
+                   NULL)
+
+#define chashmap_custom(key_type, val_type, capacity, shards, flags, ...) \
+    _chashmap_init(shards, \
+                   capacity, \
+                   sizeof(key_type), \
+                   sizeof(val_type), \
+                   flags, \
+                   ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
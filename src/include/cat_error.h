@@ -30,6 +30,7 @@ typedef enum {
     ERR_MEMORY_ALLOCATION  = 2,
     ERR_CAPACITY_OVERFLOW  = 3,
     ERR_INDEX_OUT_OF_RANGE = 4,
+    ERR_FILE_IO            = 5,
 } stat_t;
 
 #endif
\ No newline at end of file
@@ -34,9 +34,87 @@ extern "C" {
 
 typedef struct hashmap_s* hashmap_t;
 
+/* Variable-length key of a HASHMAP_STRING_KEYS hashmap */
+typedef struct {
+    const char* str;
+    size_t      len;
+} hashmap_str_t;
+
+/* Cursor over the mappings of a hashmap, set up with hashmap_iter_init,
+ * its fields are private */
+typedef struct {
+    hashmap_t       ht;
+    void*           link;
+    size_t          index;
+    int             state;
+    hashmap_str_t   view;
+} hashmap_iter_t;
+
+/* Storage engines and options, selected with the flags of _hashmap_init */
+enum {
+    HASHMAP_CHAINED      = 0x0000,  /* separate chaining (default) */
+    HASHMAP_SWISS        = 0x0001,  /* open addressing probed by control byte groups */
+    HASHMAP_ROBIN        = 0x0002,  /* Robin Hood open addressing with inline hashes */
+    HASHMAP_ORDERED      = 0x0003,  /* insertion-ordered slots under an index of 32-bit positions */
+    HASHMAP_ENGINE_MASK  = 0x000F,
+
+    HASHMAP_INCREMENTAL  = 0x0010,  /* chained: spread resizes over later insertions and removals */
+    HASHMAP_CHAIN_GUARD  = 0x0020,  /* chained, seeded hash: reseed and rehash when a chain grows too long */
+    HASHMAP_STRING_KEYS  = 0x0040,  /* keys are hashmap_str_t, their bytes kept in a key arena */
+    HASHMAP_LOCKFREE_READ = 0x0080, /* chained: wait-free queries, writers locked internally */
+
+    HASHMAP_HASH_AUTO    = 0x0000,  /* integer mixer for 4 and 8 byte keys, cityhash otherwise */
+    HASHMAP_HASH_CITY    = 0x0100,  /* cityhash64 */
+    HASHMAP_HASH_XXH3    = 0x0200,  /* xxh3hash64 */
+    HASHMAP_HASH_WYHASH  = 0x0300,  /* wyhash64 */
+    HASHMAP_HASH_INT     = 0x0400,  /* intmix64, only for 4 and 8 byte keys */
+    HASHMAP_HASH_MASK    = 0x0F00,
+
+    HASHMAP_FILTER       = 0x1000,  /* blocked Bloom filter rejecting most misses in one cache line */
+};
+
+/* Operation types counted by hashmap_stats */
+enum {
+    HASHMAP_OP_QUERY     = 0,   /* query, find and contains_key */
+    HASHMAP_OP_INSERT    = 1,   /* assign and emplace */
+    HASHMAP_OP_REMOVE    = 2,
+    HASHMAP_OP_COUNT     = 3,
+};
+
+#define HASHMAP_STATS_HISTOGRAM 16
+
+/* Diagnostics of a hashmap, filled by hashmap_stats when the library is
+ * built with CAT_HASHMAP_STATS */
+typedef struct {
+    size_t      ops[HASHMAP_OP_COUNT];          /* operations of each type */
+    size_t      probes[HASHMAP_OP_COUNT];       /* entries or slot groups visited */
+    size_t      compares[HASHMAP_OP_COUNT];     /* keys compared after a hash match */
+    size_t      histogram[HASHMAP_STATS_HISTOGRAM]; /* buckets by chain length, or
+                                                       slots by probe length in groups,
+                                                       or by probe distance for Robin Hood
+                                                       and ordered, every mapping of
+                                                       a frozen hashmap at 0,
+                                                       the last counts every longer one */
+    size_t      resizes;                        /* resizes and rehashes */
+    uint64_t    resize_ns;                      /* time spent in them */
+    size_t      bytes_allocated;                /* bytes requested from the allocator */
+    size_t      filter_rejects;                 /* lookups of absent keys the filter answered */
+    size_t      filter_false_positives;         /* lookups the filter passed that missed */
+} hashmap_stats_t;
+
+/* Which value hashmap_from_arrays keeps for a repeated key */
+enum {
+    HASHMAP_LAST_WINS    = 0,
+    HASHMAP_FIRST_WINS   = 1,
+};
+
 size_t hashmap_size(hashmap_t ht);
 size_t hashmap_capacity(hashmap_t ht);
 double hashmap_load(hashmap_t ht);
+uint64_t hashmap_seed(hashmap_t ht);
+stat_t hashmap_stats(hashmap_t ht, hashmap_stats_t* stats);
+void hashmap_stats_reset(hashmap_t ht);
+double hashmap_filter_fpr(hashmap_t ht);
 
 int hashmap_is_empty(hashmap_t ht);
 int hashmap_contains_key(hashmap_t ht, void* key);
@@ -45,30 +123,113 @@ size_t hashmap_contains_val(hashmap_t ht, void* val);
 hashmap_t _hashmap_init(size_t capacity,
                         size_t key_len,
                         size_t elem_size,
+                        unsigned flags,
                         uint64_t (*hash_fn)(const char*),
                         int (*cmp_fn)(const void*, const void*),
                         void* (*alloc_fn)(size_t),
                         void (*free_fn)(void*));
+hashmap_t _hashmap_init_seeded(size_t capacity,
+                               size_t key_len,
+                               size_t elem_size,
+                               unsigned flags,
+                               uint64_t (*hash_fn)(const void*, size_t, uint64_t),
+                               int (*cmp_fn)(const void*, const void*),
+                               void* (*alloc_fn)(size_t),
+                               void (*free_fn)(void*));
+hashmap_t _hashmap_from_arrays(const void* keys,
+                               const void* vals,
+                               size_t n,
+                               int policy,
+                               size_t threads,
+                               size_t key_len,
+                               size_t elem_size,
+                               unsigned flags,
+                               uint64_t (*hash_fn)(const char*),
+                               int (*cmp_fn)(const void*, const void*),
+                               void* (*alloc_fn)(size_t),
+                               void (*free_fn)(void*));
 stat_t hashmap_reserve(hashmap_t ht, size_t capacity);
+stat_t hashmap_shrink_to_fit(hashmap_t ht);
+stat_t hashmap_set_low_water(hashmap_t ht, double low_water);
+stat_t hashmap_set_threads(hashmap_t ht, size_t threads);
 stat_t hashmap_assign(hashmap_t ht, void* key, void* val);
 stat_t hashmap_remove(hashmap_t ht, void* key, void* ret_val);
 stat_t hashmap_query(hashmap_t ht, void* key, void* ret_val);
+void* hashmap_find(hashmap_t ht, void* key);
+void* hashmap_emplace(hashmap_t ht, void* key, int* created);
+stat_t hashmap_aggregate(hashmap_t ht,
+                         void* key,
+                         void* val,
+                         void (*combine_fn)(void*, const void*));
+stat_t hashmap_partials(hashmap_t ht, hashmap_t* partials, size_t n);
+stat_t hashmap_merge(hashmap_t ht,
+                     hashmap_t* partials,
+                     size_t n,
+                     void (*combine_fn)(void*, const void*));
+size_t hashmap_assign_batch(hashmap_t ht,
+                            void* keys,
+                            void* vals,
+                            size_t n,
+                            stat_t* stats);
+size_t hashmap_query_batch(hashmap_t ht,
+                           void* keys,
+                           void* ret_vals,
+                           size_t n,
+                           stat_t* stats);
 
 stat_t hashmap_copy(hashmap_t* dst, hashmap_t src);
+stat_t hashmap_save(hashmap_t ht, const char* path);
+hashmap_t hashmap_load_mmap(const char* path);
+stat_t hashmap_freeze(hashmap_t ht);
+
+/* A multimap is a hashmap mapping each key to a run of values, read and
+ * written through these functions; the value accessors of the hashmap
+ * return ERR_INVALID_OPERATION or NULL on it, and the values iteration
+ * hands out are runs not to be modified */
+hashmap_t _hashmap_multi_init(size_t capacity,
+                              size_t key_len,
+                              size_t val_size,
+                              unsigned flags,
+                              uint64_t (*hash_fn)(const char*),
+                              int (*cmp_fn)(const void*, const void*),
+                              void* (*alloc_fn)(size_t),
+                              void (*free_fn)(void*));
+stat_t hashmap_multi_append(hashmap_t ht, void* key, void* val);
+void* hashmap_multi_values(hashmap_t ht, void* key, size_t* count);
+size_t hashmap_multi_count(hashmap_t ht, void* key);
+stat_t hashmap_multi_remove(hashmap_t ht, void* key, void* val);
+stat_t hashmap_multi_remove_all(hashmap_t ht, void* key);
 
 void hashmap_map(hashmap_t ht, void (*fn)(void*, void*));
 void hashmap_key_map(hashmap_t ht, void (*fn)(void*));
 void hashmap_val_map(hashmap_t ht, void (*fn)(void*));
+void hashmap_iter_init(hashmap_iter_t* it, hashmap_t ht);
+int hashmap_iter_next(hashmap_iter_t* it, void** key, void** val);
+stat_t hashmap_iter_remove(hashmap_iter_t* it, void* ret_val);
 void hashmap_clear(hashmap_t ht);
 void hashmap_deinit(hashmap_t ht);
 
 uint64_t cityhash64(const char *s, size_t len);
 uint64_t djb2hash64(const char *s, size_t len);
+uint64_t xxh3hash64(const char *s, size_t len, uint64_t seed);
+uint64_t wyhash64(const char *s, size_t len, uint64_t seed);
+uint64_t intmix64(uint64_t x, uint64_t seed);
 
 #define hashmap(key_type, val_type, capacity) \
     _hashmap_init(capacity, \
                   sizeof(key_type), \
                   sizeof(val_type), \
+                  HASHMAP_CHAINED, \
+                  NULL, \
+                  NULL, \
+                  NULL, \
+                  NULL)
+
+#define hashmap_flags(key_type, val_type, capacity, flags) \
+    _hashmap_init(capacity, \
+                  sizeof(key_type), \
+                  sizeof(val_type), \
+                  flags, \
                   NULL, \
                   NULL, \
                   NULL, \
@@ -78,8 +239,99 @@ uint64_t djb2hash64(const char *s, size_t len);
     _hashmap_init(capacity, \
                   sizeof(key_type), \
                   sizeof(val_type), \
+                  HASHMAP_CHAINED, \
+                  ##__VA_ARGS__)
+
+#define hashmap_custom_flags(key_type, val_type, capacity, flags, ...) \
+    _hashmap_init(capacity, \
+                  sizeof(key_type), \
+                  sizeof(val_type), \
+                  flags, \
                   ##__VA_ARGS__)
 
+#define hashmap_seeded(key_type, val_type, capacity, flags) \
+    _hashmap_init_seeded(capacity, \
+                         sizeof(key_type), \
+                         sizeof(val_type), \
+                         flags, \
+                         NULL, \
+                         NULL, \
+                         NULL, \
+                         NULL)
+
+#define hashmap_seeded_custom(key_type, val_type, capacity, flags, ...) \
+    _hashmap_init_seeded(capacity, \
+                         sizeof(key_type), \
+                         sizeof(val_type), \
+                         flags, \
+                         ##__VA_ARGS__)
+
+#define hashmap_multi(key_type, val_type, capacity) \
+    _hashmap_multi_init(capacity, \
+                        sizeof(key_type), \
+                        sizeof(val_type), \
+                        HASHMAP_CHAINED, \
+                        NULL, \
+                        NULL, \
+                        NULL, \
+                        NULL)
+
+#define hashmap_multi_flags(key_type, val_type, capacity, flags) \
+    _hashmap_multi_init(capacity, \
+                        sizeof(key_type), \
+                        sizeof(val_type), \
+                        flags, \
+                        NULL, \
+                        NULL, \
+                        NULL, \
+                        NULL)
+
+#define hashmap_multi_custom_flags(key_type, val_type, capacity, flags, ...) \
+    _hashmap_multi_init(capacity, \
+                        sizeof(key_type), \
+                        sizeof(val_type), \
+                        flags, \
+                        ##__VA_ARGS__)
+
+#define hashmap_from_arrays(key_type, val_type, keys, vals, n, policy, flags) \
+    _hashmap_from_arrays(keys, \
+                         vals, \
+                         n, \
+                         policy, \
+                         1, \
+                         sizeof(key_type), \
+                         sizeof(val_type), \
+                         flags, \
+                         NULL, \
+                         NULL, \
+                         NULL, \
+                         NULL)
+
+#define hashmap_from_arrays_parallel(key_type, val_type, keys, vals, n, policy, flags, threads) \
+    _hashmap_from_arrays(keys, \
+                         vals, \
+                         n, \
+                         policy, \
+                         threads, \
+                         sizeof(key_type), \
+                         sizeof(val_type), \
+                         flags, \
+                         NULL, \
+                         NULL, \
+                         NULL, \
+                         NULL)
+
+#define hashmap_from_arrays_custom(key_type, val_type, keys, vals, n, policy, flags, ...) \
+    _hashmap_from_arrays(keys, \
+                         vals, \
+                         n, \
+                         policy, \
+                         1, \
+                         sizeof(key_type), \
+                         sizeof(val_type), \
+                         flags, \
+                         ##__VA_ARGS__)
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,105 @@
+/* The MIT License
+
+   Copyright (c) 2024 hessian-mat
+
+   Permission is hereby granted, free of charge, to any person obtaining a copy
+   of this software and associated documentation files (the "Software"), to deal
+   in the Software without restriction, including without limitation the rights
+   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+   copies of the Software, and to permit persons to whom the Software is
+   furnished to do so, subject to the following conditions:
+
+   The above copyright notice and this permission notice shall be included in
+   all copies or substantial portions of the Software.
+
+   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+   THE SOFTWARE.
+*/
+
+#ifndef __CAT_HASHSET_H__
+#define __CAT_HASHSET_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cat_error.h"
+#include "cat_hashmap.h"
+
+/* Set of keys stored by the hashmap engines without any value */
+typedef struct hashset_s* hashset_t;
+
+/* Cursor over the members of a hashset, set up with hashset_iter_init */
+typedef hashmap_iter_t hashset_iter_t;
+
+size_t hashset_size(hashset_t set);
+size_t hashset_capacity(hashset_t set);
+
+int hashset_is_empty(hashset_t set);
+int hashset_contains(hashset_t set, void* key);
+
+hashset_t _hashset_init(size_t capacity,
+                        size_t key_len,
+                        unsigned flags,
+                        uint64_t (*hash_fn)(const char*),
+                        int (*cmp_fn)(const void*, const void*),
+                        void* (*alloc_fn)(size_t),
+                        void (*free_fn)(void*));
+stat_t hashset_reserve(hashset_t set, size_t capacity);
+stat_t hashset_add(hashset_t set, void* key);
+stat_t hashset_remove(hashset_t set, void* key);
+
+stat_t hashset_copy(hashset_t* dst, hashset_t src);
+stat_t hashset_union(hashset_t* dst, hashset_t a, hashset_t b);
+stat_t hashset_intersection(hashset_t* dst, hashset_t a, hashset_t b);
+stat_t hashset_difference(hashset_t* dst, hashset_t a, hashset_t b);
+
+void hashset_map(hashset_t set, void (*fn)(void*));
+void hashset_iter_init(hashset_iter_t* it, hashset_t set);
+int hashset_iter_next(hashset_iter_t* it, void** key);
+stat_t hashset_iter_remove(hashset_iter_t* it);
+void hashset_clear(hashset_t set);
+void hashset_deinit(hashset_t set);
+
+#define hashset(key_type, capacity) \
+    _hashset_init(capacity, \
+                  sizeof(key_type), \
+                  HASHMAP_CHAINED, \
+                  NULL, \
+                  NULL, \
+                  NULL, \
+                  NULL)
+
+#define hashset_flags(key_type, capacity, flags) \
+    _hashset_init(capacity, \
+                  sizeof(key_type), \
+                  flags, \
+                  NULL, \
+                  NULL, \
+                  NULL, \
+                  NULL)
+
+#define hashset_custom(key_type, capacity, ...) \
+    _hashset_init(capacity, \
+                  sizeof(key_type), \
+                  HASHMAP_CHAINED, \
+                  ##__VA_ARGS__)
+
+#define hashset_custom_flags(key_type, capacity, flags, ...) \
+    _hashset_init(capacity, \
+                  sizeof(key_type), \
+                  flags, \
+                  ##__VA_ARGS__)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
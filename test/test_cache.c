@@ -0,0 +1,184 @@
+#include <string.h>
+#include "cat_cache.h"
+#include "unity.h"
+
+void setUp() {}
+void tearDown() {}
+
+static int evicted[16];
+static size_t nevicted;
+
+static void record_evict(void* key, void* val)
+{
+    TEST_ASSERT_EQUAL_INT64(*(int*)key * 10L, *(long*)val);
+    if (nevicted < 16) evicted[nevicted] = *(int*)key;
+    nevicted++;
+}
+
+// LRU
+void test1()
+{
+    cache_t c = cache(int, long, 3, CACHE_LRU);
+    TEST_ASSERT_NOT_NULL(c);
+    cache_set_evict_fn(c, record_evict);
+    nevicted = 0;
+    for(int i = 1; i <= 3; i++) {
+        long v = i * 10L;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &i, &v));
+    }
+    long v;
+    int k = 1;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_get(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(10, v);
+    k = 4;
+    v = 40;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(1, nevicted);
+    TEST_ASSERT_EQUAL_INT(2, evicted[0]);
+    k = 2;
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, cache_get(c, &k, &v));
+    TEST_ASSERT_FALSE(cache_contains(c, &k));
+
+    /* Updating a key refreshes it without evicting */
+    k = 3;
+    v = 30;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(3, cache_size(c));
+    k = 5;
+    v = 50;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT(1, evicted[1]);
+    TEST_ASSERT_EQUAL_INT64(1, cache_hits(c));
+    TEST_ASSERT_EQUAL_INT64(1, cache_misses(c));
+    TEST_ASSERT_EQUAL_INT64(2, cache_evictions(c));
+
+    k = 4;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_remove(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(40, v);
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, cache_remove(c, &k, NULL));
+    TEST_ASSERT_EQUAL_INT64(2, cache_size(c));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, cache_put(c, NULL, &v));
+    cache_clear(c);
+    TEST_ASSERT_EQUAL_INT64(0, cache_size(c));
+    TEST_ASSERT_EQUAL_INT64(2, nevicted);
+    k = 3;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+    cache_deinit(c);
+
+    TEST_ASSERT_NULL(cache(int, long, 0, CACHE_LRU));
+    TEST_ASSERT_NULL(cache(int, long, 8, 3));
+    TEST_ASSERT_NULL(cache_flags(int, long, 8, CACHE_LRU, HASHMAP_SWISS));
+}
+
+// CLOCK
+void test2()
+{
+    cache_t c = cache_flags(int, long, 3, CACHE_CLOCK, HASHMAP_HASH_XXH3);
+    cache_set_evict_fn(c, record_evict);
+    nevicted = 0;
+    for(int i = 1; i <= 3; i++) {
+        long v = i * 10L;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &i, &v));
+    }
+    long v;
+    int k = 1;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_get(c, &k, &v));
+    /* 1 gets a second chance, then the hand moves on from 2 */
+    for(int i = 4; i <= 5; i++) {
+        v = i * 10L;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &i, &v));
+    }
+    TEST_ASSERT_EQUAL_INT64(2, nevicted);
+    TEST_ASSERT_EQUAL_INT(2, evicted[0]);
+    TEST_ASSERT_EQUAL_INT(3, evicted[1]);
+    TEST_ASSERT_TRUE(cache_contains(c, &k));
+    k = 4;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_remove(c, &k, NULL));
+    k = 6;
+    v = 60;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(3, cache_size(c));
+    cache_deinit(c);
+}
+
+// scan resistance of W-TinyLFU against LRU
+void test3()
+{
+    int policies[] = {CACHE_LRU, CACHE_TINYLFU};
+    size_t kept[2];
+    for(int p = 0; p < 2; p++) {
+        cache_t c = cache(int, long, 100, policies[p]);
+        long v = 0;
+        for(int r = 0; r < 5; r++) {
+            for(int i = 0; i < 50; i++) {
+                if (cache_get(c, &i, &v)) {
+                    v = i * 10L;
+                    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &i, &v));
+                }
+            }
+        }
+        for(int i = 1000; i < 5000; i++) {
+            v = i * 10L;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &i, &v));
+            TEST_ASSERT_TRUE(cache_size(c) <= 100);
+        }
+        kept[p] = 0;
+        for(int i = 0; i < 50; i++)
+            kept[p] += cache_contains(c, &i);
+        TEST_ASSERT_EQUAL_INT64(100, cache_size(c));
+        cache_deinit(c);
+    }
+    TEST_ASSERT_EQUAL_INT64(0, kept[0]);
+    TEST_ASSERT_TRUE(kept[1] >= 45);
+}
+
+// random workload
+void test4()
+{
+    int policies[] = {CACHE_LRU, CACHE_CLOCK, CACHE_TINYLFU};
+    for(int p = 0; p < 3; p++) {
+        size_t capacities[] = {1, 7, 64};
+        for(int ci = 0; ci < 3; ci++) {
+            cache_t c = cache(int, long, capacities[ci], policies[p]);
+            cache_set_evict_fn(c, record_evict);
+            nevicted = 0;
+            uint64_t state = 88172645463325252ULL;
+            size_t gets = 0;
+            for(int i = 0; i < 20000; i++) {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                int k = (int)(state % 200);
+                long v = k * 10L;
+                switch (state >> 62) {
+                case 0:
+                    cache_remove(c, &k, NULL);
+                    break;
+                case 1:
+                    gets++;
+                    if (cache_get(c, &k, &v) == COMPLETE)
+                        TEST_ASSERT_EQUAL_INT64(k * 10L, v);
+                    break;
+                default:
+                    TEST_ASSERT_EQUAL_INT(COMPLETE, cache_put(c, &k, &v));
+                    TEST_ASSERT_TRUE(cache_contains(c, &k));
+                    break;
+                }
+                TEST_ASSERT_TRUE(cache_size(c) <= capacities[ci]);
+            }
+            TEST_ASSERT_EQUAL_INT64(gets, cache_hits(c) + cache_misses(c));
+            TEST_ASSERT_EQUAL_INT64(nevicted, cache_evictions(c));
+            cache_deinit(c);
+        }
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test1);
+    RUN_TEST(test2);
+    RUN_TEST(test3);
+    RUN_TEST(test4);
+    return UNITY_END();
+}
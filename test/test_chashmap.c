@@ -0,0 +1,126 @@
+#include <string.h>
+#include "cat_chashmap.h"
+#include "../src/cat_thread.h"
+#include "unity.h"
+
+void setUp() {}
+void tearDown() {}
+
+#define THREADS 8
+#define PER_THREAD 20000
+
+typedef struct {
+    chashmap_t ht;
+    int id;
+    int errors;
+} worker_t;
+
+static void writer(void* arg)
+{
+    worker_t* w = arg;
+    for(int i = 0; i < PER_THREAD; i++) {
+        int k = w->id * PER_THREAD + i;
+        long v = k * 3L;
+        if (chashmap_assign(w->ht, &k, &v)) w->errors++;
+    }
+    for(int i = 0; i < PER_THREAD; i += 2) {
+        int k = w->id * PER_THREAD + i;
+        long v;
+        if (chashmap_remove(w->ht, &k, &v) || v != k * 3L) w->errors++;
+    }
+}
+
+static void reader(void* arg)
+{
+    worker_t* w = arg;
+    for(int r = 0; r < 4; r++) {
+        for(int k = 0; k < THREADS * PER_THREAD; k += 7) {
+            long v;
+            if (chashmap_query(w->ht, &k, &v) == COMPLETE && v != k * 3L) w->errors++;
+        }
+    }
+}
+
+static long val_sum;
+
+static void sum_val(void* val)
+{
+    val_sum += *(long*)val;
+}
+
+// basic
+void test1()
+{
+    chashmap_t ht = chashmap(int, long, 100);
+    TEST_ASSERT_NOT_NULL(ht);
+    TEST_ASSERT_EQUAL_INT64(CHASHMAP_DEFAULT_SHARDS, chashmap_shards(ht));
+    TEST_ASSERT_TRUE(chashmap_is_empty(ht));
+    for(int i = 0; i < 1000; i++) {
+        long v = i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, chashmap_assign(ht, &i, &v));
+    }
+    TEST_ASSERT_EQUAL_INT64(1000, chashmap_size(ht));
+    for(int i = 0; i < 1000; i++) {
+        long v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, chashmap_query(ht, &i, &v));
+        TEST_ASSERT_EQUAL_INT64(i, v);
+    }
+    int k = 1000;
+    TEST_ASSERT_FALSE(chashmap_contains_key(ht, &k));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, chashmap_remove(ht, &k, NULL));
+
+    long nv = -1;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, chashmap_assign(ht, NULL, &nv));
+    TEST_ASSERT_TRUE(chashmap_contains_key(ht, NULL));
+    val_sum = 0;
+    chashmap_val_map(ht, sum_val);
+    TEST_ASSERT_EQUAL_INT64(999 * 1000 / 2 - 1, val_sum);
+
+    chashmap_clear(ht);
+    TEST_ASSERT_TRUE(chashmap_is_empty(ht));
+    chashmap_deinit(ht);
+
+    TEST_ASSERT_NULL(chashmap_flags(int, long, 8, 4, HASHMAP_CHAIN_GUARD));
+    ht = chashmap_flags(int, long, 8, 3, HASHMAP_SWISS);
+    TEST_ASSERT_EQUAL_INT64(4, chashmap_shards(ht));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, chashmap_reserve(ht, 4096));
+    TEST_ASSERT_TRUE(chashmap_capacity(ht) >= 4096);
+    chashmap_deinit(ht);
+}
+
+// writers and readers on separate threads
+void test2()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL,
+                        HASHMAP_LOCKFREE_READ};
+    for(int f = 0; f < 4; f++) {
+        chashmap_t ht = chashmap_flags(int, long, 8, 16, flags[f]);
+        worker_t workers[THREADS * 2];
+        cat_thread_t threads[THREADS * 2];
+        for(int i = 0; i < THREADS * 2; i++) {
+            workers[i].ht = ht;
+            workers[i].id = i;
+            workers[i].errors = 0;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, cat_thread_create(&threads[i],
+                                                              i < THREADS ? writer : reader,
+                                                              &workers[i]));
+        }
+        for(int i = 0; i < THREADS * 2; i++) {
+            cat_thread_join(threads[i]);
+            TEST_ASSERT_EQUAL_INT(0, workers[i].errors);
+        }
+
+        TEST_ASSERT_EQUAL_INT64(THREADS * PER_THREAD / 2, chashmap_size(ht));
+        for(int k = 0; k < THREADS * PER_THREAD; k++)
+            TEST_ASSERT_EQUAL_INT(k % 2, chashmap_contains_key(ht, &k));
+        chashmap_deinit(ht);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test1);
+    RUN_TEST(test2);
+    return UNITY_END();
+}
@@ -1,5 +1,7 @@
+#include <stdio.h>
 #include <string.h>
 #include "cat_hashmap.h"
+#include "../src/cat_thread.h"
 #include "unity.h"
 
 void setUp() {}
@@ -254,6 +256,1754 @@ void test9()
     hashmap_deinit(ht);
 }
 
+// swiss basic
+void test10()
+{
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_SWISS);
+    TEST_ASSERT_NOT_NULL(ht);
+    TEST_ASSERT_EQUAL_INT64(16, hashmap_capacity(ht));
+
+    for(int i = 0; i < 1000; i++) {
+        int v = i * 10;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+    }
+    TEST_ASSERT_EQUAL_INT64(1000, hashmap_size(ht));
+    TEST_ASSERT_TRUE(hashmap_load(ht) <= 0.875);
+
+    int k = 7;
+    int v = 70;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(1000, hashmap_size(ht));
+    TEST_ASSERT_EQUAL_INT64(1, hashmap_contains_val(ht, &v));
+
+    for(int i = 0; i < 1000; i++) {
+        int r;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &i, &r));
+        TEST_ASSERT_EQUAL_INT(i == 7 ? 70 : i * 10, r);
+    }
+    k = 1000;
+    TEST_ASSERT_EQUAL_INT(0, hashmap_contains_key(ht, &k));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_query(ht, &k, &v));
+
+    hashmap_deinit(ht);
+}
+
+// swiss remove and reuse of deleted slots
+void test11()
+{
+    hashmap_t ht = hashmap_flags(int, int, 64, HASHMAP_SWISS);
+    const int N = 100000;
+
+    for(int round = 0; round < 3; round++) {
+        for(int i = 0; i < N; i++) {
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        }
+        TEST_ASSERT_EQUAL_INT64(N, hashmap_size(ht));
+        for(int i = 0; i < N; i += 2) {
+            int r;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, &r));
+            TEST_ASSERT_EQUAL_INT(i, r);
+        }
+        TEST_ASSERT_EQUAL_INT64(N / 2, hashmap_size(ht));
+        for(int i = 0; i < N; i++) {
+            TEST_ASSERT_EQUAL_INT(i % 2, hashmap_contains_key(ht, &i));
+        }
+    }
+    size_t capacity = hashmap_capacity(ht);
+    for(int i = 0; i < N; i++) {
+        hashmap_remove(ht, &i, NULL);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    }
+    TEST_ASSERT_EQUAL_INT64(capacity, hashmap_capacity(ht));
+
+    hashmap_clear(ht);
+    TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+    int k = 1;
+    TEST_ASSERT_EQUAL_INT(0, hashmap_contains_key(ht, &k));
+
+    hashmap_deinit(ht);
+}
+
+// swiss null key, custom functions and copy
+void test12()
+{
+    hashmap_t ht = hashmap_custom_flags(char*, char*, 4, HASHMAP_SWISS,
+                                        str_hash, str_cmp, NULL, NULL);
+    char* k[] = {"one", "two", "three"};
+    char* v[] = {"1", "2", "3"};
+    for(int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k[i], &v[i]));
+    }
+    char* nv = "null value";
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &nv));
+    TEST_ASSERT_EQUAL_INT64(4, hashmap_size(ht));
+
+    hashmap_t copy;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&copy, ht));
+    TEST_ASSERT_EQUAL_INT64(4, hashmap_size(copy));
+
+    char* r;
+    char* two = "two";
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(copy, &two, &r));
+    TEST_ASSERT_EQUAL_STRING("2", r);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(copy, NULL, &r));
+    TEST_ASSERT_EQUAL_STRING(nv, r);
+
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, NULL, &r));
+    TEST_ASSERT_EQUAL_STRING(nv, r);
+    TEST_ASSERT_EQUAL_INT(0, hashmap_contains_key(ht, NULL));
+    TEST_ASSERT_EQUAL_INT(1, hashmap_contains_key(copy, NULL));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(ht, NULL, NULL));
+
+    hashmap_deinit(ht);
+    hashmap_deinit(copy);
+}
+
+typedef struct { char tag[3]; } Tag;
+typedef struct { double weight; short rank; } Record;
+
+// keys and values of unaligned sizes stored inline
+void test13()
+{
+    unsigned engines[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_ROBIN, HASHMAP_ORDERED};
+    for(int e = 0; e < 4; e++) {
+        hashmap_t ht = hashmap_flags(Tag, Record, 8, engines[e]);
+        for(int i = 0; i < 5000; i++) {
+            Tag k = {{(char)(i & 0xFF), (char)(i >> 8), 'x'}};
+            Record v = {i * 0.5, (short)i};
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+        }
+        for(int i = 0; i < 5000; i++) {
+            Tag k = {{(char)(i & 0xFF), (char)(i >> 8), 'x'}};
+            Record r;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &r));
+            TEST_ASSERT_TRUE(r.weight == i * 0.5);
+            TEST_ASSERT_EQUAL_INT(i, r.rank);
+            if (i % 3 == 0)
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+        }
+        TEST_ASSERT_EQUAL_INT64(5000 - 1667, hashmap_size(ht));
+        hashmap_deinit(ht);
+    }
+}
+
+// incremental rehash
+void test14()
+{
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_INCREMENTAL);
+    TEST_ASSERT_NOT_NULL(ht);
+    const int N = 50000;
+
+    for(int i = 0; i < N; i++) {
+        int v = i * 10;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+        if (i % 7 == 0) {
+            int r;
+            int k = i / 2;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &r));
+            TEST_ASSERT_EQUAL_INT(k * 10, r);
+        }
+    }
+    TEST_ASSERT_EQUAL_INT64(N, hashmap_size(ht));
+    TEST_ASSERT_TRUE(hashmap_load(ht) < 0.75);
+
+    for(int i = 0; i < N; i += 2) {
+        int r;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, &r));
+        TEST_ASSERT_EQUAL_INT(i * 10, r);
+    }
+    for(int i = 0; i < N; i++) {
+        TEST_ASSERT_EQUAL_INT(i % 2, hashmap_contains_key(ht, &i));
+    }
+    int v = 10;
+    TEST_ASSERT_EQUAL_INT64(1, hashmap_contains_val(ht, &v));
+
+    hashmap_t copy;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&copy, ht));
+    TEST_ASSERT_EQUAL_INT64(N / 2, hashmap_size(copy));
+
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_reserve(ht, 4 * hashmap_capacity(ht)));
+    for(int i = 1; i < N; i += 2) {
+        int r;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &i, &r));
+        TEST_ASSERT_EQUAL_INT(i * 10, r);
+    }
+
+    hashmap_deinit(ht);
+    hashmap_deinit(copy);
+
+    TEST_ASSERT_NULL(hashmap_flags(int, int, 8, HASHMAP_SWISS | HASHMAP_INCREMENTAL));
+}
+
+// batch assign and query
+void test15()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL};
+    enum { N = 1000 };
+    int keys[N];
+    int vals[N];
+    int ret[N];
+    stat_t stats[N];
+
+    for(int f = 0; f < 3; f++) {
+        hashmap_t ht = hashmap_flags(int, int, 8, flags[f]);
+        for(int i = 0; i < N; i++) {
+            keys[i] = i * 3;
+            vals[i] = i;
+        }
+        TEST_ASSERT_EQUAL_INT64(N, hashmap_assign_batch(ht, keys, vals, N, stats));
+        TEST_ASSERT_EQUAL_INT64(N, hashmap_size(ht));
+        for(int i = 0; i < N; i++) {
+            TEST_ASSERT_EQUAL_INT(COMPLETE, stats[i]);
+            keys[i] = i;
+            ret[i] = -1;
+        }
+
+        TEST_ASSERT_EQUAL_INT64(334, hashmap_query_batch(ht, keys, ret, N, stats));
+        for(int i = 0; i < N; i++) {
+            if (i % 3 == 0) {
+                TEST_ASSERT_EQUAL_INT(COMPLETE, stats[i]);
+                TEST_ASSERT_EQUAL_INT(i / 3, ret[i]);
+            } else {
+                TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, stats[i]);
+                TEST_ASSERT_EQUAL_INT(-1, ret[i]);
+            }
+        }
+        TEST_ASSERT_EQUAL_INT64(334, hashmap_query_batch(ht, keys, ret, N, NULL));
+        hashmap_deinit(ht);
+    }
+}
+
+// find and emplace
+void test16()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL};
+    for(int f = 0; f < 3; f++) {
+        hashmap_t ht = hashmap_flags(int, long, 8, flags[f]);
+        for(int i = 0; i < 10000; i++) {
+            int k = i % 100;
+            int created;
+            long* count = hashmap_emplace(ht, &k, &created);
+            TEST_ASSERT_NOT_NULL(count);
+            TEST_ASSERT_EQUAL_INT(i < 100, created);
+            (*count)++;
+        }
+        TEST_ASSERT_EQUAL_INT64(100, hashmap_size(ht));
+
+        for(int k = 0; k < 100; k++) {
+            long* count = hashmap_find(ht, &k);
+            TEST_ASSERT_NOT_NULL(count);
+            TEST_ASSERT_EQUAL_INT64(100, *count);
+            *count = k;
+            long r;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &r));
+            TEST_ASSERT_EQUAL_INT64(k, r);
+        }
+        int k = 100;
+        TEST_ASSERT_NULL(hashmap_find(ht, &k));
+
+        TEST_ASSERT_NULL(hashmap_find(ht, NULL));
+        long* nv = hashmap_emplace(ht, NULL, NULL);
+        TEST_ASSERT_NOT_NULL(nv);
+        TEST_ASSERT_EQUAL_INT64(0, *nv);
+        *nv = 42;
+        TEST_ASSERT_EQUAL_INT64(42, *(long*)hashmap_find(ht, NULL));
+        TEST_ASSERT_EQUAL_INT64(101, hashmap_size(ht));
+
+        hashmap_deinit(ht);
+    }
+}
+
+void test17()
+{
+    unsigned hashes[] = {HASHMAP_HASH_AUTO, HASHMAP_HASH_CITY, HASHMAP_HASH_XXH3,
+                         HASHMAP_HASH_WYHASH, HASHMAP_HASH_INT};
+    for(int h = 0; h < 5; h++) {
+        for(int e = 0; e < 2; e++) {
+            hashmap_t ht = hashmap_flags(uint64_t, int, 8, hashes[h] | (unsigned)e);
+            TEST_ASSERT_NOT_NULL(ht);
+            for(uint64_t i = 0; i < 5000; i++) {
+                uint64_t k = i << 32;
+                int v = (int)i;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+            }
+            for(uint64_t i = 0; i < 5000; i++) {
+                uint64_t k = i << 32;
+                int v;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+                TEST_ASSERT_EQUAL_INT((int)i, v);
+            }
+            hashmap_t cp;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+            uint64_t k = (uint64_t)4999 << 32;
+            TEST_ASSERT_TRUE(hashmap_contains_key(cp, &k));
+            hashmap_deinit(cp);
+            hashmap_deinit(ht);
+        }
+    }
+
+    /* Integer mixer needs 4 or 8 byte keys */
+    TEST_ASSERT_NULL(hashmap_flags(Tag, int, 8, HASHMAP_HASH_INT));
+    hashmap_t ht = hashmap_flags(Tag, int, 8, HASHMAP_HASH_WYHASH);
+    for(int i = 0; i < 1000; i++) {
+        Tag t = {{(char)i, (char)(i >> 8), 'x'}};
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &t, &i));
+    }
+    TEST_ASSERT_EQUAL_INT64(1000, hashmap_size(ht));
+    hashmap_deinit(ht);
+
+    const char* msg = "the quick brown fox jumps over the lazy dog";
+    size_t len = strlen(msg);
+    TEST_ASSERT_TRUE(xxh3hash64(msg, len, 0) == xxh3hash64(msg, len, 0));
+    TEST_ASSERT_TRUE(xxh3hash64(msg, len, 0) != xxh3hash64(msg, len, 1));
+    TEST_ASSERT_TRUE(wyhash64(msg, len, 0) != wyhash64(msg, len, 1));
+    TEST_ASSERT_TRUE(intmix64(1, 0) != intmix64(2, 0));
+    TEST_ASSERT_TRUE(intmix64(1, 0) != intmix64(1, 1));
+    TEST_ASSERT_EQUAL_HEX64(0x2D06800538D394C2ULL, xxh3hash64("", 0, 0));
+    TEST_ASSERT_EQUAL_HEX64(0x93228a4de0eec5a2ULL, wyhash64("", 0, 0));
+}
+
+static uint64_t hostile_seed;
+static size_t hostile_len;
+
+static uint64_t hostile_hash(const void* key, size_t len, uint64_t seed)
+{
+    if (!hostile_seed) hostile_seed = seed;
+    hostile_len = len;
+    if (seed == hostile_seed) return 0;
+    return wyhash64(key, len, seed);
+}
+
+void test18()
+{
+    hashmap_t a = hashmap_seeded(uint64_t, int, 8, HASHMAP_CHAINED);
+    hashmap_t b = hashmap_seeded(uint64_t, int, 8, HASHMAP_SWISS | HASHMAP_HASH_XXH3);
+    TEST_ASSERT_TRUE(hashmap_seed(a) != 0);
+    TEST_ASSERT_TRUE(hashmap_seed(a) != hashmap_seed(b));
+    for(uint64_t i = 0; i < 1000; i++) {
+        int v = (int)i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(a, &i, &v));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(b, &i, &v));
+    }
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, b));
+    TEST_ASSERT_TRUE(hashmap_seed(cp) == hashmap_seed(b));
+    for(uint64_t i = 0; i < 1000; i++) {
+        int v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(a, &i, &v));
+        TEST_ASSERT_EQUAL_INT((int)i, v);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &i, &v));
+        TEST_ASSERT_EQUAL_INT((int)i, v);
+    }
+    hashmap_deinit(a);
+    hashmap_deinit(b);
+    hashmap_deinit(cp);
+    TEST_ASSERT_NULL(hashmap_seeded(uint64_t, int, 8, HASHMAP_SWISS | HASHMAP_CHAIN_GUARD));
+    TEST_ASSERT_NULL(hashmap_custom_flags(int, int, 8, HASHMAP_CHAIN_GUARD, str_hash,
+                                          NULL, NULL, NULL));
+
+    /* Every key collides under the first seed, the guard has to reseed */
+    unsigned flags[] = {HASHMAP_CHAIN_GUARD, HASHMAP_CHAIN_GUARD | HASHMAP_INCREMENTAL, 0};
+    for(int f = 0; f < 3; f++) {
+        hostile_seed = 0;
+        hashmap_t ht = hashmap_seeded_custom(Tag, int, 8, flags[f], hostile_hash, NULL, NULL, NULL);
+        TEST_ASSERT_NOT_NULL(ht);
+        uint64_t first_seed = hashmap_seed(ht);
+        for(int i = 0; i < 2000; i++) {
+            Tag t = {{(char)i, (char)(i >> 8), 'k'}};
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &t, &i));
+        }
+        TEST_ASSERT_EQUAL_INT64(sizeof(Tag), hostile_len);
+        TEST_ASSERT_EQUAL_INT(flags[f] != 0, hashmap_seed(ht) != first_seed);
+        TEST_ASSERT_EQUAL_INT64(2000, hashmap_size(ht));
+        for(int i = 0; i < 2000; i++) {
+            Tag t = {{(char)i, (char)(i >> 8), 'k'}};
+            int v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &t, &v));
+            TEST_ASSERT_EQUAL_INT(i, v);
+        }
+        hashmap_deinit(ht);
+    }
+}
+
+static size_t key_bytes;
+
+static void count_key_bytes(void* key)
+{
+    if (key) key_bytes += ((hashmap_str_t*)key)->len;
+}
+
+void test19()
+{
+    static char words[6000][16];
+    hashmap_str_t keys[6000];
+    for(int i = 0; i < 6000; i++) {
+        keys[i].len = (size_t)snprintf(words[i], sizeof(words[i]), "w%d", i * 7919);
+        keys[i].str = words[i];
+    }
+
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL, HASHMAP_ROBIN,
+                        HASHMAP_ORDERED};
+    for(int f = 0; f < 5; f++) {
+        hashmap_t ht = hashmap_flags(hashmap_str_t, int, 8, flags[f] | HASHMAP_STRING_KEYS);
+        TEST_ASSERT_NOT_NULL(ht);
+        for(int i = 0; i < 6000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &keys[i], &i));
+
+        /* Lookups go through a different buffer with the same bytes */
+        for(int i = 0; i < 6000; i++) {
+            char probe[16];
+            memcpy(probe, words[i], keys[i].len);
+            hashmap_str_t k = {probe, keys[i].len};
+            int v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+            TEST_ASSERT_EQUAL_INT(i, v);
+        }
+        hashmap_str_t prefix = {"w7", 1};
+        TEST_ASSERT_FALSE(hashmap_contains_key(ht, &prefix));
+
+        /* Removed keys leave garbage in the arena until it is reallocated */
+        for(int i = 0; i < 6000; i += 2)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &keys[i], NULL));
+        for(int r = 0; r < 4; r++) {
+            for(int i = 0; i < 6000; i += 2) {
+                int v = -i;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &keys[i], &v));
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &keys[i], NULL));
+            }
+        }
+        TEST_ASSERT_EQUAL_INT64(3000, hashmap_size(ht));
+
+        hashmap_str_t empty = {NULL, 0};
+        int e = 77;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &empty, &e));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &e));
+
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+        size_t expected = 0;
+        for(int i = 1; i < 6000; i += 2) {
+            int v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &keys[i], &v));
+            TEST_ASSERT_EQUAL_INT(i, v);
+            expected += keys[i].len;
+        }
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &empty, &e));
+        TEST_ASSERT_EQUAL_INT(77, e);
+        key_bytes = 0;
+        hashmap_key_map(cp, count_key_bytes);
+        TEST_ASSERT_EQUAL_INT64(expected, key_bytes);
+
+        int vals[6000];
+        stat_t stats[6000];
+        TEST_ASSERT_EQUAL_INT64(3000, hashmap_query_batch(cp, keys, vals, 6000, stats));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, stats[0]);
+        TEST_ASSERT_EQUAL_INT(1, vals[1]);
+
+        hashmap_clear(ht);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &keys[5], &e));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &keys[5], &e));
+        hashmap_deinit(cp);
+        hashmap_deinit(ht);
+    }
+    TEST_ASSERT_NULL(hashmap_flags(char*, int, 8, HASHMAP_STRING_KEYS));
+}
+
+#define RCU_KEYS 4096
+#define RCU_ROUNDS 8
+
+typedef struct {
+    hashmap_t ht;
+    int errors;
+} rcu_worker_t;
+
+/* Values always encode their key, whatever round wrote them */
+static void rcu_writer(void* arg)
+{
+    rcu_worker_t* w = arg;
+    for(long r = 0; r < RCU_ROUNDS; r++) {
+        for(int k = 0; k < RCU_KEYS; k++) {
+            long v = r * RCU_KEYS + k;
+            if (hashmap_assign(w->ht, &k, &v)) w->errors++;
+        }
+        for(int k = (int)(r & 1); k < RCU_KEYS; k += 2) {
+            if (hashmap_remove(w->ht, &k, NULL)) w->errors++;
+        }
+    }
+}
+
+static void rcu_reader(void* arg)
+{
+    rcu_worker_t* w = arg;
+    for(int r = 0; r < RCU_ROUNDS; r++) {
+        for(int k = 0; k < RCU_KEYS; k++) {
+            long v;
+            if (hashmap_query(w->ht, &k, &v) == COMPLETE && v % RCU_KEYS != k) w->errors++;
+        }
+    }
+}
+
+// lock-free reads
+void test20()
+{
+    hashmap_t ht = hashmap_flags(int, long, 8, HASHMAP_LOCKFREE_READ);
+    TEST_ASSERT_NOT_NULL(ht);
+    for(int i = 0; i < 1000; i++) {
+        long v = i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+    }
+    for(int i = 0; i < 1000; i += 2) {
+        long v = -i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+    }
+    TEST_ASSERT_EQUAL_INT64(1000, hashmap_size(ht));
+    for(int i = 0; i < 1000; i++) {
+        long v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &i, &v));
+        TEST_ASSERT_EQUAL_INT64(i % 2 ? i : -i, v);
+    }
+    int k = 3;
+    long v;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(3, v);
+    TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(ht, &k, NULL));
+
+    /* In-place access and the NULL key would bypass the copy-on-write entries */
+    TEST_ASSERT_NULL(hashmap_find(ht, &k));
+    TEST_ASSERT_NULL(hashmap_emplace(ht, &k, NULL));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_assign(ht, NULL, &v));
+    TEST_ASSERT_NULL(hashmap_find(ht, NULL));
+    TEST_ASSERT_NULL(hashmap_emplace(ht, NULL, NULL));
+
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+    TEST_ASSERT_EQUAL_INT64(999, hashmap_size(cp));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_reserve(ht, 8192));
+    TEST_ASSERT_EQUAL_INT64(8192, hashmap_capacity(ht));
+    k = 998;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT64(-998, v);
+    hashmap_clear(ht);
+    TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &k, &v));
+    hashmap_deinit(cp);
+
+    /* One writer churning and resizing under readers that never lock */
+    rcu_worker_t workers[5];
+    cat_thread_t threads[5];
+    for(int i = 0; i < 5; i++) {
+        workers[i].ht = ht;
+        workers[i].errors = 0;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, cat_thread_create(&threads[i],
+                                                          i ? rcu_reader : rcu_writer,
+                                                          &workers[i]));
+    }
+    for(int i = 0; i < 5; i++) {
+        cat_thread_join(threads[i]);
+        TEST_ASSERT_EQUAL_INT(0, workers[i].errors);
+    }
+    TEST_ASSERT_EQUAL_INT64(RCU_KEYS / 2, hashmap_size(ht));
+    hashmap_deinit(ht);
+
+    TEST_ASSERT_NULL(hashmap_flags(int, long, 8, HASHMAP_LOCKFREE_READ | HASHMAP_SWISS));
+    TEST_ASSERT_NULL(hashmap_flags(int, long, 8, HASHMAP_LOCKFREE_READ | HASHMAP_INCREMENTAL));
+}
+
+// cursor iteration
+void test21()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL,
+                        HASHMAP_LOCKFREE_READ, HASHMAP_ROBIN, HASHMAP_ORDERED};
+    for(int f = 0; f < 6; f++) {
+        hashmap_t ht = hashmap_flags(int, int, 8, flags[f]);
+        for(int i = 0; i < 10000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        int nv = -1;
+        if (flags[f] != HASHMAP_LOCKFREE_READ)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &nv));
+
+        /* Remove the odd keys and NULL while walking */
+        static char seen[10000];
+        memset(seen, 0, sizeof(seen));
+        hashmap_iter_t it;
+        void* key;
+        void* val;
+        size_t visited = 0;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, &key, &val)) {
+            visited++;
+            if (!key) {
+                TEST_ASSERT_EQUAL_INT(-1, *(int*)val);
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+                continue;
+            }
+            int k = *(int*)key;
+            TEST_ASSERT_EQUAL_INT(k, *(int*)val);
+            TEST_ASSERT_FALSE(seen[k]);
+            seen[k] = 1;
+            if (k % 2) {
+                int v;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, &v));
+                TEST_ASSERT_EQUAL_INT(k, v);
+                TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_iter_remove(&it, NULL));
+            }
+        }
+        TEST_ASSERT_FALSE(hashmap_iter_next(&it, NULL, NULL));
+        TEST_ASSERT_EQUAL_INT64(10000 + (flags[f] != HASHMAP_LOCKFREE_READ), visited);
+        TEST_ASSERT_EQUAL_INT64(5000, hashmap_size(ht));
+
+        visited = 0;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, &key, NULL)) {
+            TEST_ASSERT_NOT_NULL(key);
+            TEST_ASSERT_EQUAL_INT(0, *(int*)key % 2);
+            visited++;
+        }
+        TEST_ASSERT_EQUAL_INT64(5000, visited);
+
+        /* Emptied by the cursor, the hashmap keeps working */
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, NULL, NULL))
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+        TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+        int k = 42;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &k));
+        TEST_ASSERT_TRUE(hashmap_contains_key(ht, &k));
+        hashmap_deinit(ht);
+    }
+
+    /* A sparse hashmap only visits its mappings */
+    hashmap_t ht = hashmap(int, int, 1 << 20);
+    int keys[] = {7, 1 << 19, 123456};
+    for(int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &keys[i], &i));
+    hashmap_iter_t it;
+    void* val;
+    int sum = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &val))
+        sum += *(int*)val + 1;
+    TEST_ASSERT_EQUAL_INT(6, sum);
+    int two = 2;
+    TEST_ASSERT_EQUAL_INT64(1, hashmap_contains_val(ht, &two));
+    TEST_ASSERT_EQUAL_INT64(0, hashmap_contains_val(ht, &sum));
+    hashmap_deinit(ht);
+}
+
+// shrinking
+void test22()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL, HASHMAP_LOCKFREE_READ};
+    for(int f = 0; f < 4; f++) {
+        hashmap_t ht = hashmap_flags(int, int, 8, flags[f]);
+        for(int i = 0; i < 100000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        size_t grown = hashmap_capacity(ht);
+        for(int i = 100; i < 100000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+        TEST_ASSERT_EQUAL_INT64(grown, hashmap_capacity(ht));
+
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(ht));
+        TEST_ASSERT_EQUAL_INT64(flags[f] == HASHMAP_SWISS ? 128 : 256, hashmap_capacity(ht));
+        for(int i = 0; i < 100; i++) {
+            int v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &i, &v));
+            TEST_ASSERT_EQUAL_INT(i, v);
+        }
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(ht));
+        TEST_ASSERT_EQUAL_INT64(flags[f] == HASHMAP_SWISS ? 128 : 256, hashmap_capacity(ht));
+
+        /* Past the mark the capacity follows removals down */
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_set_low_water(ht, 0.5));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_set_low_water(ht, 0.125));
+        for(int i = 100; i < 100000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        for(int i = 10; i < 100000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+        TEST_ASSERT_TRUE(hashmap_capacity(ht) <= 128);
+        for(int i = 0; i < 10; i++)
+            TEST_ASSERT_TRUE(hashmap_contains_key(ht, &i));
+
+        /* Going back and forth over a boundary does not resize every time */
+        size_t capacity = hashmap_capacity(ht);
+        for(int r = 0; r < 100; r++) {
+            int k = 1000;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &k));
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+            TEST_ASSERT_EQUAL_INT64(capacity, hashmap_capacity(ht));
+        }
+        hashmap_deinit(ht);
+    }
+
+    hashmap_str_t key = {"a long enough string key", 24};
+    hashmap_t ht = hashmap_flags(hashmap_str_t, int, 8, HASHMAP_STRING_KEYS);
+    for(int i = 0; i < 1000; i++) {
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &key, &i));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &key, NULL));
+    }
+    int one = 1;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &key, &one));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(ht));
+    TEST_ASSERT_TRUE(hashmap_contains_key(ht, &key));
+    hashmap_deinit(ht);
+}
+
+// structure-preserving copy
+void test23()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL,
+                        HASHMAP_LOCKFREE_READ, HASHMAP_CHAIN_GUARD};
+    for(int f = 0; f < 5; f++) {
+        hashmap_t ht = hashmap_seeded(int, int, 8, flags[f]);
+        for(int i = 0; i < 5000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        for(int i = 0; i < 5000; i += 3)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+        TEST_ASSERT_EQUAL_INT64(hashmap_size(ht), hashmap_size(cp));
+        TEST_ASSERT_EQUAL_INT64(hashmap_capacity(ht), hashmap_capacity(cp));
+        TEST_ASSERT_EQUAL_INT64(hashmap_seed(ht), hashmap_seed(cp));
+
+        /* Both walks see the same mappings in the same order */
+        hashmap_iter_t a, b;
+        void *ka, *kb, *va, *vb;
+        hashmap_iter_init(&a, ht);
+        hashmap_iter_init(&b, cp);
+        while (hashmap_iter_next(&a, &ka, &va)) {
+            TEST_ASSERT_TRUE(hashmap_iter_next(&b, &kb, &vb));
+            TEST_ASSERT_EQUAL_INT(*(int*)ka, *(int*)kb);
+            TEST_ASSERT_EQUAL_INT(*(int*)va, *(int*)vb);
+            TEST_ASSERT_TRUE(va != vb);
+        }
+        TEST_ASSERT_FALSE(hashmap_iter_next(&b, NULL, NULL));
+
+        /* The copy is independent of the source */
+        for(int i = 0; i < 5000; i++) {
+            int v = -i;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(cp, &i, &v));
+        }
+        for(int i = 0; i < 5000; i++) {
+            int v;
+            TEST_ASSERT_EQUAL_INT(i % 3 ? COMPLETE : ERR_INVALID_OPERATION,
+                                  hashmap_query(ht, &i, &v));
+            if (i % 3) TEST_ASSERT_EQUAL_INT(i, v);
+        }
+        hashmap_deinit(ht);
+        hashmap_deinit(cp);
+    }
+}
+
+static uint64_t first_byte_hash(const char* key)
+{
+    return (uint8_t)key[0];
+}
+
+// snapshots
+void test24()
+{
+    const char* path = "test_hashmap.snapshot";
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL | HASHMAP_HASH_XXH3};
+    for(int f = 0; f < 3; f++) {
+        hashmap_t ht = hashmap_seeded(int, long, 8, flags[f]);
+        for(int i = 0; i < 20000; i++) {
+            long v = i * 7L;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+        }
+        long nv = -5;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &nv));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_save(ht, path));
+
+        hashmap_t mp = hashmap_load_mmap(path);
+        TEST_ASSERT_NOT_NULL(mp);
+        TEST_ASSERT_EQUAL_INT64(hashmap_size(ht), hashmap_size(mp));
+        TEST_ASSERT_EQUAL_INT64(hashmap_seed(ht), hashmap_seed(mp));
+        for(int i = -100; i < 20100; i++) {
+            long v;
+            TEST_ASSERT_EQUAL_INT(i >= 0 && i < 20000 ? COMPLETE : ERR_INVALID_OPERATION,
+                                  hashmap_query(mp, &i, &v));
+            if (i >= 0 && i < 20000) TEST_ASSERT_EQUAL_INT64(i * 7L, v);
+        }
+        long v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(mp, NULL, &v));
+        TEST_ASSERT_EQUAL_INT64(-5, v);
+        int keys[] = {3, 40000};
+        long vals[2];
+        stat_t stats[2];
+        TEST_ASSERT_EQUAL_INT64(1, hashmap_query_batch(mp, keys, vals, 2, stats));
+        TEST_ASSERT_EQUAL_INT64(21, vals[0]);
+
+        /* Read-only */
+        int k = 1;
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_assign(mp, &k, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(mp, &k, NULL));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(mp, NULL, NULL));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_reserve(mp, 1 << 20));
+        TEST_ASSERT_NULL(hashmap_find(mp, &k));
+        TEST_ASSERT_NULL(hashmap_find(mp, NULL));
+        TEST_ASSERT_NULL(hashmap_emplace(mp, &k, NULL));
+        TEST_ASSERT_TRUE(hashmap_contains_key(mp, &k));
+        hashmap_clear(mp);
+        TEST_ASSERT_TRUE(hashmap_contains_key(mp, &k));
+
+        hashmap_iter_t it;
+        void* key;
+        size_t visited = 0;
+        hashmap_iter_init(&it, mp);
+        while (hashmap_iter_next(&it, &key, NULL)) {
+            visited++;
+            TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_iter_remove(&it, NULL));
+        }
+        TEST_ASSERT_EQUAL_INT64(20001, visited);
+
+        /* A copy is writable */
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, mp));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(cp, &k, NULL));
+        for(int i = 20000; i < 30000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(cp, &i, &v));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &keys[0], &v));
+        TEST_ASSERT_EQUAL_INT64(21, v);
+        TEST_ASSERT_EQUAL_INT64(30000, hashmap_size(cp));
+        hashmap_deinit(cp);
+        hashmap_deinit(mp);
+        hashmap_deinit(ht);
+    }
+
+    hashmap_str_t words[] = {{"alpha", 5}, {"beta", 4}, {"", 0}, {"gamma delta", 11}};
+    hashmap_t ht = hashmap_flags(hashmap_str_t, int, 8, HASHMAP_STRING_KEYS);
+    for(int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &words[i], &i));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &words[1], NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_save(ht, path));
+    hashmap_deinit(ht);
+    ht = hashmap_load_mmap(path);
+    TEST_ASSERT_NOT_NULL(ht);
+    char probe[] = "gamma delta";
+    hashmap_str_t k = {probe, 11};
+    int v;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT(3, v);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &words[2], &v));
+    TEST_ASSERT_EQUAL_INT(2, v);
+    TEST_ASSERT_FALSE(hashmap_contains_key(ht, &words[1]));
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(cp, &words[1], &v));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &words[0], &v));
+    TEST_ASSERT_EQUAL_INT(0, v);
+    hashmap_deinit(cp);
+    hashmap_deinit(ht);
+
+    /* Damaged files and custom callbacks are refused */
+    FILE* fp = fopen(path, "r+b");
+    TEST_ASSERT_NOT_NULL(fp);
+    fputc('X', fp);
+    fclose(fp);
+    TEST_ASSERT_NULL(hashmap_load_mmap(path));
+    TEST_ASSERT_NULL(hashmap_load_mmap("no/such/file"));
+    ht = hashmap_custom(int, int, 8, first_byte_hash, NULL, NULL, NULL);
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_save(ht, path));
+    hashmap_deinit(ht);
+    ht = hashmap(int, int, 8);
+    TEST_ASSERT_EQUAL_INT(ERR_FILE_IO, hashmap_save(ht, "no/such/dir/file"));
+    hashmap_deinit(ht);
+    remove(path);
+}
+
+// bulk construction from arrays
+void test25()
+{
+    enum { N = 5000 };
+    int* keys = malloc((N + 2) * sizeof(int));
+    long* vals = malloc((N + 2) * sizeof(long));
+    for(int i = 0; i < N; i++) {
+        keys[i] = i * 3;
+        vals[i] = i;
+    }
+    /* Repeated keys at the end */
+    keys[N] = 0;
+    vals[N] = -1;
+    keys[N + 1] = 3;
+    vals[N + 1] = -2;
+
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_CHAINED | HASHMAP_INCREMENTAL,
+                        HASHMAP_CHAINED | HASHMAP_CHAIN_GUARD, HASHMAP_CHAINED | HASHMAP_LOCKFREE_READ};
+    for(int f = 0; f < 5; f++) {
+        for(int policy = HASHMAP_LAST_WINS; policy <= HASHMAP_FIRST_WINS; policy++) {
+            hashmap_t ht = hashmap_from_arrays(int, long, keys, vals, N + 2, policy, flags[f]);
+            TEST_ASSERT_NOT_NULL(ht);
+            TEST_ASSERT_EQUAL_INT64(N, hashmap_size(ht));
+            long v;
+            for(int i = 0; i < N; i++) {
+                int k = i * 3;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+                if (i < 2 && policy == HASHMAP_LAST_WINS) {
+                    TEST_ASSERT_EQUAL_INT64(-1 - i, v);
+                } else {
+                    TEST_ASSERT_EQUAL_INT64(i, v);
+                }
+            }
+            int k = 1;
+            TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+
+            /* Still an ordinary map */
+            for(int i = 0; i < N; i += 2) {
+                k = i * 3;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+            }
+            for(int i = 0; i < N; i++) {
+                k = i * 3 + 1;
+                v = i;
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+            }
+            TEST_ASSERT_EQUAL_INT64(N + N / 2, hashmap_size(ht));
+            k = 9;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+            TEST_ASSERT_EQUAL_INT64(3, v);
+            hashmap_clear(ht);
+            TEST_ASSERT_EQUAL_INT64(0, hashmap_size(ht));
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+            hashmap_deinit(ht);
+        }
+    }
+    free(keys);
+    free(vals);
+
+    hashmap_str_t words[] = {{"alpha", 5}, {"beta", 4}, {"", 0}, {"alpha", 5}};
+    int nums[] = {1, 2, 3, 4};
+    hashmap_t ht = hashmap_from_arrays(hashmap_str_t, int, words, nums, 4, HASHMAP_FIRST_WINS,
+                                       HASHMAP_STRING_KEYS);
+    TEST_ASSERT_NOT_NULL(ht);
+    TEST_ASSERT_EQUAL_INT64(3, hashmap_size(ht));
+    char probe[] = "alpha";
+    hashmap_str_t k = {probe, 5};
+    int v;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT(1, v);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &words[2], &v));
+    TEST_ASSERT_EQUAL_INT(3, v);
+    hashmap_deinit(ht);
+
+    ht = hashmap_from_arrays(int, int, NULL, NULL, 0, HASHMAP_LAST_WINS, HASHMAP_SWISS);
+    TEST_ASSERT_NOT_NULL(ht);
+    TEST_ASSERT_EQUAL_INT64(0, hashmap_size(ht));
+    hashmap_deinit(ht);
+    TEST_ASSERT_NULL(hashmap_from_arrays(int, int, nums, nums, 4, 2, 0));
+}
+
+// diagnostics
+void test26()
+{
+    enum { SWISS_GROUP = 16 };
+    hashmap_stats_t st;
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_CHAINED);
+#ifndef CAT_HASHMAP_STATS
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_stats(ht, &st));
+    hashmap_deinit(ht);
+#else
+    for(int i = 0; i < 1000; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    int v;
+    for(int i = 0; i < 2000; i++)
+        hashmap_query(ht, &i, &v);
+    int k = 5;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+    TEST_ASSERT_EQUAL_INT64(1000, st.ops[HASHMAP_OP_INSERT]);
+    TEST_ASSERT_EQUAL_INT64(2000, st.ops[HASHMAP_OP_QUERY]);
+    TEST_ASSERT_EQUAL_INT64(1, st.ops[HASHMAP_OP_REMOVE]);
+    /* Every hit compares its key once, misses only on hash collisions */
+    TEST_ASSERT_TRUE(st.compares[HASHMAP_OP_QUERY] >= 1000);
+    TEST_ASSERT_TRUE(st.probes[HASHMAP_OP_QUERY] >= st.compares[HASHMAP_OP_QUERY]);
+    TEST_ASSERT_EQUAL_INT64(1, st.compares[HASHMAP_OP_REMOVE]);
+    TEST_ASSERT_EQUAL_INT64(8, st.resizes);
+    TEST_ASSERT_TRUE(st.bytes_allocated >= 999 * sizeof(int) * 2);
+    size_t buckets = 0, entries = 0;
+    for(size_t i = 0; i < HASHMAP_STATS_HISTOGRAM; i++) {
+        buckets += st.histogram[i];
+        entries += i * st.histogram[i];
+    }
+    TEST_ASSERT_EQUAL_INT64(hashmap_capacity(ht), buckets);
+    TEST_ASSERT_EQUAL_INT64(999, entries);
+    hashmap_stats_reset(ht);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+    TEST_ASSERT_EQUAL_INT64(0, st.ops[HASHMAP_OP_QUERY]);
+    TEST_ASSERT_EQUAL_INT64(0, st.resizes);
+    hashmap_deinit(ht);
+
+    /* A constant hash puts every key in one chain or one probe sequence */
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS};
+    for(int f = 0; f < 2; f++) {
+        ht = hashmap_custom_flags(int, int, 8, flags[f], first_byte_hash, NULL, NULL, NULL);
+        for(int i = 0; i < 40; i++) {
+            int key = i << 8;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &key, &i));
+        }
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+        if (flags[f] == HASHMAP_SWISS) {
+            TEST_ASSERT_EQUAL_INT64(SWISS_GROUP, st.histogram[0]);
+        } else {
+            TEST_ASSERT_EQUAL_INT64(1, st.histogram[HASHMAP_STATS_HISTOGRAM - 1]);
+        }
+        k = 39 << 8;
+        size_t before = st.compares[HASHMAP_OP_QUERY];
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+        TEST_ASSERT_TRUE(st.compares[HASHMAP_OP_QUERY] - before >= (f ? 2 : 1));
+        hashmap_deinit(ht);
+    }
+#endif
+}
+
+static uint64_t same_hash(const char* key)
+{
+    (void)key;
+    return 12345;
+}
+
+static uint64_t high_hash(const char* key)
+{
+    return (uint64_t)*(const int*)key << 40;
+}
+
+// robin hood engine
+void test27()
+{
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_ROBIN);
+    TEST_ASSERT_NOT_NULL(ht);
+    for(int i = 0; i < 20000; i++) {
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+        TEST_ASSERT_TRUE(hashmap_load(ht) <= 0.9);
+    }
+    TEST_ASSERT_EQUAL_INT64(32768, hashmap_capacity(ht));
+    for(int i = 0; i < 40000; i++)
+        TEST_ASSERT_EQUAL_INT(i < 20000, hashmap_contains_key(ht, &i));
+
+    /* Backward shifts keep every run reachable without tombstones */
+    for(int i = 0; i < 20000; i += 3)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+    for(int i = 0; i < 20000; i++) {
+        int v = -1;
+        TEST_ASSERT_EQUAL_INT(i % 3 ? COMPLETE : ERR_INVALID_OPERATION,
+                              hashmap_query(ht, &i, &v));
+        if (i % 3) TEST_ASSERT_EQUAL_INT(i, v);
+    }
+    for(int i = 0; i < 20000; i += 3)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    TEST_ASSERT_EQUAL_INT64(20000, hashmap_size(ht));
+    TEST_ASSERT_EQUAL_INT64(32768, hashmap_capacity(ht));
+
+#ifdef CAT_HASHMAP_STATS
+    hashmap_stats_t st;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+    size_t slots = 0;
+    for(int i = 0; i < HASHMAP_STATS_HISTOGRAM; i++)
+        slots += st.histogram[i];
+    TEST_ASSERT_EQUAL_INT64(20000, slots);
+    TEST_ASSERT_TRUE(st.histogram[0] > st.histogram[HASHMAP_STATS_HISTOGRAM - 1]);
+#endif
+
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+    hashmap_clear(ht);
+    TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+    for(int i = 0; i < 20000; i++) {
+        int v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &i, &v));
+        TEST_ASSERT_EQUAL_INT(i, v);
+        TEST_ASSERT_FALSE(hashmap_contains_key(ht, &i));
+    }
+
+    /* Shrinking and reserving move the runs into another table */
+    for(int i = 100; i < 20000; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(cp, &i, NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(cp));
+    TEST_ASSERT_EQUAL_INT64(128, hashmap_capacity(cp));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_reserve(cp, 4096));
+    TEST_ASSERT_EQUAL_INT64(4096, hashmap_capacity(cp));
+    for(int i = 0; i < 100; i++)
+        TEST_ASSERT_TRUE(hashmap_contains_key(cp, &i));
+    hashmap_deinit(cp);
+    hashmap_deinit(ht);
+
+    /* Colliding hashes fill a single run until its distances run out */
+    ht = hashmap_custom_flags(int, int, 8, HASHMAP_ROBIN, same_hash, NULL, NULL, NULL);
+    int i = 0;
+    while (hashmap_assign(ht, &i, &i) == COMPLETE) i++;
+    TEST_ASSERT_EQUAL_INT(255, i);
+    TEST_ASSERT_EQUAL_INT(ERR_CAPACITY_OVERFLOW, hashmap_assign(ht, &i, &i));
+    for(int j = 0; j < 255; j++)
+        TEST_ASSERT_TRUE(hashmap_contains_key(ht, &j));
+    int k = 7;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    TEST_ASSERT_EQUAL_INT64(255, hashmap_size(ht));
+    hashmap_deinit(ht);
+
+    /* Hashes that differ only in their high bits still get their own homes */
+    ht = hashmap_custom_flags(int, int, 8, HASHMAP_ROBIN, high_hash, NULL, NULL, NULL);
+    for(i = 0; i < 100000; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    TEST_ASSERT_EQUAL_INT64(131072, hashmap_capacity(ht));
+    for(i = 0; i < 100000; i++) {
+        int v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &i, &v));
+        TEST_ASSERT_EQUAL_INT(i, v);
+    }
+    hashmap_deinit(ht);
+}
+
+// parallel resize and bulk load
+void test28()
+{
+    enum { N = 200000 };
+    hashmap_t ht = hashmap(int, int, 8);
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_set_threads(ht, 0));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_set_threads(ht, 65));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_set_threads(ht, 4));
+    for(int i = 0; i < N; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_reserve(ht, 4 * N));
+    for(int i = 0; i < N; i += 2)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(ht));
+    TEST_ASSERT_EQUAL_INT64(N / 2, hashmap_size(ht));
+    TEST_ASSERT_EQUAL_INT64(262144, hashmap_capacity(ht));
+    for(int i = 0; i < N; i++) {
+        int v = -1;
+        TEST_ASSERT_EQUAL_INT(i % 2 ? COMPLETE : ERR_INVALID_OPERATION, hashmap_query(ht, &i, &v));
+        if (i % 2) TEST_ASSERT_EQUAL_INT(i, v);
+    }
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+    for(int i = N; i < 2 * N; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(cp, &i, &i));
+    TEST_ASSERT_EQUAL_INT64(N / 2 + N, hashmap_size(cp));
+    hashmap_deinit(cp);
+    hashmap_deinit(ht);
+
+    /* Every repeated key lands in one partition, which keeps the input order */
+    int* keys = malloc(N * sizeof(int));
+    int* vals = malloc(N * sizeof(int));
+    for(int i = 0; i < N; i++) {
+        keys[i] = i % (N / 4);
+        vals[i] = i;
+    }
+    for(int policy = HASHMAP_LAST_WINS; policy <= HASHMAP_FIRST_WINS; policy++) {
+        ht = hashmap_from_arrays_parallel(int, int, keys, vals, N, policy, HASHMAP_CHAINED, 8);
+        TEST_ASSERT_NOT_NULL(ht);
+        TEST_ASSERT_EQUAL_INT64(N / 4, hashmap_size(ht));
+        for(int k = 0; k < N / 4; k++) {
+            int v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+            TEST_ASSERT_EQUAL_INT(policy == HASHMAP_LAST_WINS ? k + 3 * (N / 4) : k, v);
+        }
+        hashmap_iter_t it;
+        size_t visited = 0;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, NULL, NULL))
+            visited++;
+        TEST_ASSERT_EQUAL_INT64(N / 4, visited);
+        hashmap_deinit(ht);
+    }
+    ht = hashmap_from_arrays_parallel(int, int, keys, vals, N, HASHMAP_LAST_WINS, HASHMAP_SWISS, 3);
+    TEST_ASSERT_NOT_NULL(ht);
+    TEST_ASSERT_EQUAL_INT64(N / 4, hashmap_size(ht));
+    hashmap_deinit(ht);
+    TEST_ASSERT_NULL(hashmap_from_arrays_parallel(int, int, keys, vals, N, HASHMAP_LAST_WINS,
+                                                  HASHMAP_CHAINED, 0));
+    free(keys);
+    free(vals);
+}
+
+static void add_long(void* acc, const void* val)
+{
+    *(long*)acc += *(const long*)val;
+}
+
+typedef struct {
+    hashmap_t partial;
+    int begin;
+    int end;
+} agg_worker_t;
+
+static void agg_run(void* arg)
+{
+    agg_worker_t* w = (agg_worker_t*)arg;
+    for(int i = w->begin; i < w->end; i++) {
+        int k = i % 40000;
+        long one = 1;
+        hashmap_aggregate(w->partial, &k, &one, add_long);
+    }
+}
+
+// aggregation and merging of partial maps
+void test29()
+{
+    unsigned engines[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_ROBIN, HASHMAP_ORDERED};
+    for(int e = 0; e < 4; e++) {
+        hashmap_t ht = hashmap_flags(int, long, 8, engines[e]);
+        for(long i = 0; i < 10000; i++) {
+            int k = (int)(i % 100);
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_aggregate(ht, &k, &i, add_long));
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_aggregate(ht, NULL, &i, add_long));
+        }
+        TEST_ASSERT_EQUAL_INT64(101, hashmap_size(ht));
+        for(int k = 0; k < 100; k++) {
+            long v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+            TEST_ASSERT_EQUAL_INT64(100 * k + 100 * 99 * 50, v);
+        }
+        TEST_ASSERT_EQUAL_INT64(10000L * 9999 / 2, *(long*)hashmap_find(ht, NULL));
+
+        /* Partials filled on their own threads, then merged by bucket range */
+        enum { EVENTS = 200000, PARTS = 4 };
+        hashmap_t partials[PARTS];
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_set_threads(ht, 4));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_partials(ht, partials, PARTS));
+        agg_worker_t workers[PARTS];
+        cat_thread_t threads[PARTS];
+        for(int t = 0; t < PARTS; t++) {
+            workers[t].partial = partials[t];
+            workers[t].begin = t * (EVENTS / PARTS);
+            workers[t].end = (t + 1) * (EVENTS / PARTS);
+            TEST_ASSERT_EQUAL_INT(COMPLETE, cat_thread_create(&threads[t], agg_run, &workers[t]));
+        }
+        for(int t = 0; t < PARTS; t++)
+            cat_thread_join(threads[t]);
+        long one = 1;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_aggregate(partials[1], NULL, &one, add_long));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_merge(ht, partials, PARTS, add_long));
+        TEST_ASSERT_EQUAL_INT64(40001, hashmap_size(ht));
+        for(int k = 0; k < 40000; k++) {
+            long v;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+            TEST_ASSERT_EQUAL_INT64(k < 100 ? 5 + 100 * k + 100 * 99 * 50 : 5, v);
+        }
+        TEST_ASSERT_EQUAL_INT64(10000L * 9999 / 2 + 1, *(long*)hashmap_find(ht, NULL));
+        hashmap_deinit(ht);
+    }
+
+    /* String keys are copied into the arena of the destination */
+    hashmap_t words = hashmap_flags(hashmap_str_t, long, 8, HASHMAP_STRING_KEYS);
+    hashmap_t parts[2];
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_partials(words, parts, 2));
+    char* text[] = {"to", "be", "or", "not", "to", "be"};
+    for(int i = 0; i < 6; i++) {
+        char buf[8];
+        strcpy(buf, text[i]);
+        hashmap_str_t k = {buf, strlen(buf)};
+        long one = 1;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_aggregate(parts[i % 2], &k, &one, add_long));
+    }
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_merge(words, parts, 2, add_long));
+    hashmap_str_t to = {"to", 2};
+    long v;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(words, &to, &v));
+    TEST_ASSERT_EQUAL_INT64(2, v);
+    TEST_ASSERT_EQUAL_INT64(4, hashmap_size(words));
+
+    /* Partials must hash and store keys like the destination */
+    hashmap_t other = hashmap(int, long, 8);
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_merge(words, &other, 1, add_long));
+    hashmap_t seeded = hashmap_seeded(int, long, 8, HASHMAP_CHAINED);
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_merge(seeded, &other, 1, add_long));
+    hashmap_deinit(seeded);
+    hashmap_deinit(other);
+    hashmap_deinit(words);
+}
+
+// insertion-ordered engine
+void test30()
+{
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_ORDERED);
+    TEST_ASSERT_NOT_NULL(ht);
+    /* Keys go in scrambled, so any other order would show */
+    for(int i = 0; i < 20000; i++) {
+        int k = (int)((i * 7919u) % 20000);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &i));
+        TEST_ASSERT_TRUE(hashmap_load(ht) <= 0.75);
+    }
+    TEST_ASSERT_EQUAL_INT64(32768, hashmap_capacity(ht));
+
+    hashmap_iter_t it;
+    void* key;
+    void* val;
+    int n = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, &val)) {
+        TEST_ASSERT_EQUAL_INT(n, *(int*)val);
+        TEST_ASSERT_EQUAL_INT((int)((n * 7919u) % 20000), *(int*)key);
+        n++;
+    }
+    TEST_ASSERT_EQUAL_INT(20000, n);
+
+    /* Updates keep their place, removals leave holes the walk skips */
+    int k = (int)((5u * 7919u) % 20000);
+    int v = -5;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &v));
+    for(int i = 0; i < 20000; i += 2) {
+        k = (int)((i * 7919u) % 20000);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+    }
+    int next = 1;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &val)) {
+        TEST_ASSERT_EQUAL_INT(next == 5 ? -5 : next, *(int*)val);
+        next += 2;
+    }
+    TEST_ASSERT_EQUAL_INT(20001, next);
+
+    /* Reinserted keys go to the back, compacting the holes once slots run out */
+    for(int i = 0; i < 20000; i += 2) {
+        k = (int)((i * 7919u) % 20000);
+        int w = 20000 + i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &w));
+    }
+    TEST_ASSERT_EQUAL_INT64(20000, hashmap_size(ht));
+    TEST_ASSERT_EQUAL_INT64(65536, hashmap_capacity(ht));
+    int prev = 0;
+    n = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, NULL, &val)) {
+        if (*(int*)val != -5) {
+            TEST_ASSERT_TRUE(*(int*)val > prev);
+            prev = *(int*)val;
+        }
+        n++;
+    }
+    TEST_ASSERT_EQUAL_INT(20000, n);
+
+#ifdef CAT_HASHMAP_STATS
+    hashmap_stats_t st;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+    size_t slots = 0;
+    for(int i = 0; i < HASHMAP_STATS_HISTOGRAM; i++)
+        slots += st.histogram[i];
+    TEST_ASSERT_EQUAL_INT64(20000, slots);
+#endif
+
+    /* Copies keep the order, walking removals and shrinking keep it too */
+    hashmap_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+    hashmap_iter_init(&it, cp);
+    n = 0;
+    while (hashmap_iter_next(&it, NULL, &val))
+        if (n++ >= 100) TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+    TEST_ASSERT_EQUAL_INT64(100, hashmap_size(cp));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(cp));
+    TEST_ASSERT_EQUAL_INT64(256, hashmap_capacity(cp));
+    hashmap_iter_t a, b;
+    void* va;
+    void* vb;
+    hashmap_iter_init(&a, ht);
+    hashmap_iter_init(&b, cp);
+    for(int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(hashmap_iter_next(&a, NULL, &va));
+        TEST_ASSERT_TRUE(hashmap_iter_next(&b, NULL, &vb));
+        TEST_ASSERT_EQUAL_INT(*(int*)va, *(int*)vb);
+    }
+    TEST_ASSERT_FALSE(hashmap_iter_next(&b, NULL, &vb));
+    hashmap_deinit(cp);
+
+    hashmap_clear(ht);
+    TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+    k = 3;
+    TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &k));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &v));
+    TEST_ASSERT_EQUAL_INT(3, v);
+    hashmap_deinit(ht);
+}
+
+// frozen hashmaps
+void test31()
+{
+    const char* path = "test_hashmap.frozen";
+    unsigned engines[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_ROBIN, HASHMAP_ORDERED};
+    for(int e = 0; e < 4; e++) {
+        hashmap_t ht = hashmap_seeded(int, long, 8, engines[e]);
+        for(int i = 0; i < 50000; i++) {
+            long v = i * 3L;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+        }
+        long nv = -9;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &nv));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_freeze(ht));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_freeze(ht));
+        TEST_ASSERT_EQUAL_INT64(50001, hashmap_size(ht));
+        for(int i = -100; i < 50100; i++) {
+            long v;
+            TEST_ASSERT_EQUAL_INT(i >= 0 && i < 50000 ? COMPLETE : ERR_INVALID_OPERATION,
+                                  hashmap_query(ht, &i, &v));
+            if (i >= 0 && i < 50000) TEST_ASSERT_EQUAL_INT64(i * 3L, v);
+        }
+        long v;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, NULL, &v));
+        TEST_ASSERT_EQUAL_INT64(-9, v);
+        int keys[] = {7, 60000, 49999};
+        long vals[3];
+        stat_t stats[3];
+        TEST_ASSERT_EQUAL_INT64(2, hashmap_query_batch(ht, keys, vals, 3, stats));
+        TEST_ASSERT_EQUAL_INT64(21, vals[0]);
+        TEST_ASSERT_EQUAL_INT64(49999 * 3L, vals[2]);
+
+        /* Read-only, but iterable and copyable */
+        int k = 1;
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_assign(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(ht, &k, NULL));
+        hashmap_iter_t it;
+        void* key;
+        void* val;
+        long sum = 0;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, &key, &val))
+            if (key) sum += *(long*)val;
+        TEST_ASSERT_EQUAL_INT64(3L * 50000 * 49999 / 2, sum);
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(cp, &k, NULL));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(cp, &keys[0], &v));
+        TEST_ASSERT_EQUAL_INT64(21, v);
+        TEST_ASSERT_EQUAL_INT64(50000, hashmap_size(cp));
+        hashmap_deinit(cp);
+
+#ifdef CAT_HASHMAP_STATS
+        hashmap_stats_t st;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+        TEST_ASSERT_EQUAL_INT64(50000, st.histogram[0]);
+#endif
+
+        /* The image is the file */
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_save(ht, path));
+        hashmap_t mp = hashmap_load_mmap(path);
+        TEST_ASSERT_NOT_NULL(mp);
+        TEST_ASSERT_EQUAL_INT64(50001, hashmap_size(mp));
+        for(int i = 0; i < 50000; i += 7) {
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(mp, &i, &v));
+            TEST_ASSERT_EQUAL_INT64(i * 3L, v);
+        }
+        k = 50000;
+        TEST_ASSERT_FALSE(hashmap_contains_key(mp, &k));
+        hashmap_deinit(mp);
+        hashmap_deinit(ht);
+    }
+
+    hashmap_str_t words[] = {{"alpha", 5}, {"beta", 4}, {"", 0}, {"gamma delta", 11}};
+    hashmap_t ht = hashmap_flags(hashmap_str_t, int, 8, HASHMAP_STRING_KEYS);
+    for(int i = 0; i < 4; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &words[i], &i));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &words[1], NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_freeze(ht));
+    char probe[] = "gamma delta";
+    hashmap_str_t sk = {probe, 11};
+    int iv;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &sk, &iv));
+    TEST_ASSERT_EQUAL_INT(3, iv);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &words[2], &iv));
+    TEST_ASSERT_EQUAL_INT(2, iv);
+    TEST_ASSERT_FALSE(hashmap_contains_key(ht, &words[1]));
+    hashmap_deinit(ht);
+
+    /* Empty hashmaps freeze, keys of the same hash cannot be told apart */
+    ht = hashmap(int, int, 8);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_freeze(ht));
+    int k = 0;
+    TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+    TEST_ASSERT_TRUE(hashmap_is_empty(ht));
+    hashmap_deinit(ht);
+    ht = hashmap_custom(int, int, 8, same_hash, NULL, NULL, NULL);
+    for(int i = 0; i < 10; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &i));
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_freeze(ht));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &k));
+    TEST_ASSERT_EQUAL_INT64(10, hashmap_size(ht));
+    hashmap_deinit(ht);
+    remove(path);
+}
+
+void test32()
+{
+    unsigned engines[] = {HASHMAP_CHAINED | HASHMAP_INCREMENTAL, HASHMAP_SWISS,
+                          HASHMAP_ROBIN, HASHMAP_ORDERED};
+    for(int e = 0; e < 4; e++) {
+        hashmap_t ht = hashmap_seeded(int, long, 8, engines[e] | HASHMAP_FILTER);
+        TEST_ASSERT_NOT_NULL(ht);
+        for(int i = 0; i < 20000; i++) {
+            long v = i * 3L;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+        }
+        long nv = -9;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, NULL, &nv));
+        double fpr = hashmap_filter_fpr(ht);
+        TEST_ASSERT_TRUE(fpr > 0 && fpr < 0.01);
+
+        /* Every present key passes, and almost every absent one is rejected */
+        hashmap_stats_reset(ht);
+        for(int i = 0; i < 120000; i++) {
+            long v;
+            TEST_ASSERT_EQUAL_INT(i < 20000 ? COMPLETE : ERR_INVALID_OPERATION,
+                                  hashmap_query(ht, &i, &v));
+            if (i < 20000) TEST_ASSERT_EQUAL_INT64(i * 3L, v);
+        }
+        TEST_ASSERT_TRUE(hashmap_contains_key(ht, NULL));
+#ifdef CAT_HASHMAP_STATS
+        hashmap_stats_t st;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_stats(ht, &st));
+        TEST_ASSERT_EQUAL_INT64(100000, st.filter_rejects + st.filter_false_positives);
+        TEST_ASSERT_TRUE(st.filter_false_positives < 1000);
+#endif
+
+        /* Removals are counted until the filter is rebuilt without them */
+        for(int i = 0; i < 20000; i += 2)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &i, NULL));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(ht, &(int){4}, NULL));
+        TEST_ASSERT_TRUE(hashmap_filter_fpr(ht) < fpr);
+        hashmap_iter_t it;
+        void* key;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, &key, NULL))
+            if (key && *(int*)key % 4 == 1)
+                TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+        for(int i = 0; i < 20000; i++)
+            TEST_ASSERT_EQUAL_INT(i % 4 == 3, hashmap_contains_key(ht, &i));
+
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+        for(int i = 0; i < 20000; i++)
+            TEST_ASSERT_EQUAL_INT(i % 4 == 3, hashmap_contains_key(cp, &i));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_shrink_to_fit(cp));
+        for(int i = 0; i < 20000; i++)
+            TEST_ASSERT_EQUAL_INT(i % 4 == 3, hashmap_contains_key(cp, &i));
+        hashmap_deinit(cp);
+
+        hashmap_clear(ht);
+        TEST_ASSERT_EQUAL_INT64(0, hashmap_size(ht));
+        TEST_ASSERT_TRUE(hashmap_filter_fpr(ht) == 0);
+        int k = 11;
+        TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &k, &nv));
+        TEST_ASSERT_TRUE(hashmap_contains_key(ht, &k));
+        hashmap_deinit(ht);
+    }
+
+    /* Built maps fill the filter once, and every hashed caller goes through it */
+    int keys[5000];
+    long vals[5000];
+    for(int i = 0; i < 5000; i++) {
+        keys[i] = i * 7;
+        vals[i] = i;
+    }
+    hashmap_t ht = hashmap_from_arrays(int, long, keys, vals, 5000, HASHMAP_LAST_WINS,
+                                       HASHMAP_SWISS | HASHMAP_FILTER);
+    TEST_ASSERT_NOT_NULL(ht);
+    for(int i = 0; i < 35000; i++)
+        TEST_ASSERT_EQUAL_INT(i % 7 == 0, hashmap_contains_key(ht, &i));
+    TEST_ASSERT_TRUE(hashmap_filter_fpr(ht) > 0);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_freeze(ht));
+    TEST_ASSERT_TRUE(hashmap_filter_fpr(ht) == 0);
+    TEST_ASSERT_TRUE(hashmap_contains_key(ht, &(int){49}));
+    hashmap_deinit(ht);
+
+    TEST_ASSERT_NULL(hashmap_flags(int, long, 8, HASHMAP_LOCKFREE_READ | HASHMAP_FILTER));
+    ht = hashmap(int, long, 8);
+    TEST_ASSERT_TRUE(hashmap_filter_fpr(ht) == 0);
+    hashmap_deinit(ht);
+}
+
+void test33()
+{
+    unsigned engines[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_ROBIN,
+                          HASHMAP_ORDERED | HASHMAP_FILTER};
+    for(int e = 0; e < 4; e++) {
+        hashmap_t ht = hashmap_multi_flags(int, long, 8, engines[e]);
+        TEST_ASSERT_NOT_NULL(ht);
+        for(int i = 0; i < 10000; i++) {
+            int k = i % 1000;
+            long v = i;
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_append(ht, &k, &v));
+        }
+        long nv = -1;
+        for(int i = 0; i < 3; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_append(ht, NULL, &nv));
+        TEST_ASSERT_EQUAL_INT64(1001, hashmap_size(ht));
+        TEST_ASSERT_EQUAL_INT64(3, hashmap_multi_count(ht, NULL));
+
+        /* Values of a key are contiguous, in the order they were appended */
+        for(int k = 0; k < 1000; k++) {
+            size_t count;
+            long* vals = hashmap_multi_values(ht, &k, &count);
+            TEST_ASSERT_EQUAL_INT64(10, count);
+            for(int j = 0; j < 10; j++)
+                TEST_ASSERT_EQUAL_INT64(k + j * 1000L, vals[j]);
+        }
+        int k = 1000;
+        size_t count = 7;
+        TEST_ASSERT_NULL(hashmap_multi_values(ht, &k, &count));
+        TEST_ASSERT_EQUAL_INT64(0, count);
+        TEST_ASSERT_EQUAL_INT64(0, hashmap_multi_count(ht, &k));
+
+        /* Removing one value keeps the others in order, the last takes the key */
+        k = 5;
+        long v = 3005;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_remove(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_multi_remove(ht, &k, &v));
+        long* vals = hashmap_multi_values(ht, &k, &count);
+        TEST_ASSERT_EQUAL_INT64(9, count);
+        TEST_ASSERT_EQUAL_INT64(2005, vals[2]);
+        TEST_ASSERT_EQUAL_INT64(4005, vals[3]);
+        for(int j = 0; j < 10; j++) {
+            v = k + j * 1000L;
+            if (j != 3) TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_remove(ht, &k, &v));
+        }
+        TEST_ASSERT_FALSE(hashmap_contains_key(ht, &k));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_multi_remove(ht, &k, &v));
+        k = 6;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_remove_all(ht, &k));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_multi_remove_all(ht, &k));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_remove_all(ht, NULL));
+        TEST_ASSERT_EQUAL_INT64(998, hashmap_size(ht));
+
+        /* Generic removals free the values, and never hand out the run */
+        k = 7;
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_remove(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_remove(ht, &k, NULL));
+        hashmap_iter_t it;
+        void* key;
+        hashmap_iter_init(&it, ht);
+        while (hashmap_iter_next(&it, &key, NULL)) {
+            if (*(int*)key % 2) continue;
+            TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_iter_remove(&it, &v));
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+        }
+        TEST_ASSERT_EQUAL_INT64(498, hashmap_size(ht));
+
+        /* Copies own their values */
+        hashmap_t cp;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&cp, ht));
+        k = 9;
+        v = 42;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_append(cp, &k, &v));
+        TEST_ASSERT_EQUAL_INT64(11, hashmap_multi_count(cp, &k));
+        TEST_ASSERT_EQUAL_INT64(10, hashmap_multi_count(ht, &k));
+        hashmap_clear(cp);
+        TEST_ASSERT_EQUAL_INT64(0, hashmap_multi_count(cp, &k));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_multi_append(cp, &k, &v));
+        TEST_ASSERT_EQUAL_INT64(1, hashmap_multi_count(cp, &k));
+        hashmap_deinit(cp);
+        TEST_ASSERT_EQUAL_INT64(k + 9000L, ((long*)hashmap_multi_values(ht, &k, NULL))[9]);
+
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_freeze(ht));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_save(ht, "test_hashmap.multi"));
+
+        /* The run of a key is never copied in or out by the value accessors */
+        v = 77;
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_query(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT64(77, v);
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_query(ht, NULL, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_assign(ht, &k, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_assign(ht, NULL, &v));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_aggregate(ht, &k, &v, add_long));
+        TEST_ASSERT_NULL(hashmap_find(ht, &k));
+        TEST_ASSERT_NULL(hashmap_emplace(ht, &k, NULL));
+        stat_t st;
+        TEST_ASSERT_EQUAL_INT64(0, hashmap_query_batch(ht, &k, &v, 1, &st));
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, st);
+        TEST_ASSERT_EQUAL_INT64(0, hashmap_assign_batch(ht, &k, &v, 1, &st));
+        TEST_ASSERT_EQUAL_INT64(10, hashmap_multi_count(ht, &k));
+        hashmap_deinit(ht);
+    }
+
+    hashmap_t ht = hashmap(int, long, 8);
+    long v = 1;
+    TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashmap_multi_append(ht, &(int){1}, &v));
+    TEST_ASSERT_NULL(hashmap_multi_values(ht, &(int){1}, NULL));
+    hashmap_deinit(ht);
+    TEST_ASSERT_NULL(hashmap_multi_flags(int, long, 8, HASHMAP_LOCKFREE_READ));
+}
+
+// iteration, value scan and clear during an incremental rehash
+void test34()
+{
+    hashmap_t ht = hashmap_flags(int, int, 8, HASHMAP_INCREMENTAL);
+    TEST_ASSERT_NOT_NULL(ht);
+
+    /* Stop right after a resize starts, most buckets are still in the old table */
+    int n = 0;
+    size_t capacity = hashmap_capacity(ht);
+    while (capacity < 8192 || hashmap_capacity(ht) == capacity) {
+        capacity = hashmap_capacity(ht);
+        int v = n * 10;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &n, &v));
+        n++;
+    }
+    int v = n * 10;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &n, &v));
+    n++;
+
+    /* Lookups leave the resize where it is, so the cursor stays valid */
+    hashmap_iter_t it;
+    void *key, *val;
+    int count = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, &val)) {
+        int r, k = count % n;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_query(ht, &k, &r));
+        TEST_ASSERT_EQUAL_INT(k * 10, r);
+        TEST_ASSERT_TRUE(hashmap_contains_key(ht, key));
+        TEST_ASSERT_EQUAL_PTR(val, hashmap_find(ht, key));
+        count++;
+    }
+    TEST_ASSERT_EQUAL_INT(n, count);
+
+    char* seen = calloc(n, 1);
+    count = 0;
+    hashmap_iter_init(&it, ht);
+    while (hashmap_iter_next(&it, &key, &val)) {
+        int k = *(int*)key;
+        TEST_ASSERT_EQUAL_INT(0, seen[k]);
+        TEST_ASSERT_EQUAL_INT(k * 10, *(int*)val);
+        seen[k] = 1;
+        count++;
+        if (k % 2 == 0)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_iter_remove(&it, NULL));
+    }
+    TEST_ASSERT_EQUAL_INT(n, count);
+    TEST_ASSERT_EQUAL_INT64(n / 2, hashmap_size(ht));
+    for (int i = 0; i < n; i++)
+        TEST_ASSERT_EQUAL_INT(i % 2, hashmap_contains_key(ht, &i));
+    free(seen);
+
+    v = 10;
+    TEST_ASSERT_EQUAL_INT64(1, hashmap_contains_val(ht, &v));
+    v = 20;
+    TEST_ASSERT_EQUAL_INT64(0, hashmap_contains_val(ht, &v));
+
+    hashmap_t copy;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_copy(&copy, ht));
+    TEST_ASSERT_EQUAL_INT64(n / 2, hashmap_size(copy));
+    for (int i = 0; i < n; i++) {
+        int r;
+        TEST_ASSERT_EQUAL_INT(i % 2 ? COMPLETE : ERR_INVALID_OPERATION, hashmap_query(copy, &i, &r));
+        if (i % 2) TEST_ASSERT_EQUAL_INT(i * 10, r);
+    }
+    hashmap_deinit(copy);
+
+    hashmap_clear(ht);
+    TEST_ASSERT_EQUAL_INT64(0, hashmap_size(ht));
+    hashmap_iter_init(&it, ht);
+    TEST_ASSERT_EQUAL_INT(0, hashmap_iter_next(&it, NULL, NULL));
+    for (int i = 0; i < n; i++) {
+        v = i;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashmap_assign(ht, &i, &v));
+    }
+    TEST_ASSERT_EQUAL_INT64(n, hashmap_size(ht));
+    hashmap_deinit(ht);
+}
+
 int main()
 {
     UNITY_BEGIN();
@@ -266,5 +2016,30 @@ int main()
     RUN_TEST(test7);
     RUN_TEST(test8);
     RUN_TEST(test9);
+    RUN_TEST(test10);
+    RUN_TEST(test11);
+    RUN_TEST(test12);
+    RUN_TEST(test13);
+    RUN_TEST(test14);
+    RUN_TEST(test15);
+    RUN_TEST(test16);
+    RUN_TEST(test17);
+    RUN_TEST(test18);
+    RUN_TEST(test19);
+    RUN_TEST(test20);
+    RUN_TEST(test21);
+    RUN_TEST(test22);
+    RUN_TEST(test23);
+    RUN_TEST(test24);
+    RUN_TEST(test25);
+    RUN_TEST(test26);
+    RUN_TEST(test27);
+    RUN_TEST(test28);
+    RUN_TEST(test29);
+    RUN_TEST(test30);
+    RUN_TEST(test31);
+    RUN_TEST(test32);
+    RUN_TEST(test33);
+    RUN_TEST(test34);
     return UNITY_END();
 } 
\ No newline at end of file
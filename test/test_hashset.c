@@ -0,0 +1,173 @@
+#include <string.h>
+#include "cat_hashset.h"
+#include "unity.h"
+
+void setUp() {}
+void tearDown() {}
+
+static long key_sum;
+
+static void sum_key(void* key)
+{
+    key_sum += *(int*)key;
+}
+
+// basic
+void test1()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_CHAINED | HASHMAP_INCREMENTAL,
+                        HASHMAP_LOCKFREE_READ};
+    for(int f = 0; f < 4; f++) {
+        hashset_t set = hashset_flags(int, 8, flags[f]);
+        TEST_ASSERT_NOT_NULL(set);
+        TEST_ASSERT_TRUE(hashset_is_empty(set));
+        for(int i = 0; i < 1000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(set, &i));
+        for(int i = 0; i < 1000; i += 2)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(set, &i));
+        TEST_ASSERT_EQUAL_INT64(1000, hashset_size(set));
+        for(int i = 0; i < 1000; i += 3)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_remove(set, &i));
+        int k = 3;
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashset_remove(set, &k));
+        for(int i = -10; i < 1010; i++)
+            TEST_ASSERT_EQUAL_INT(i >= 0 && i < 1000 && i % 3, hashset_contains(set, &i));
+
+        key_sum = 0;
+        hashset_map(set, sum_key);
+        long expected = 0;
+        for(int i = 0; i < 1000; i++)
+            if (i % 3) expected += i;
+        TEST_ASSERT_EQUAL_INT64(expected, key_sum);
+        hashset_clear(set);
+        TEST_ASSERT_TRUE(hashset_is_empty(set));
+        hashset_deinit(set);
+    }
+
+    /* NULL is a member like any other key */
+    hashset_t set = hashset(int, 8);
+    TEST_ASSERT_FALSE(hashset_contains(set, NULL));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(set, NULL));
+    TEST_ASSERT_TRUE(hashset_contains(set, NULL));
+    hashset_iter_t it;
+    void* key;
+    hashset_iter_init(&it, set);
+    TEST_ASSERT_TRUE(hashset_iter_next(&it, &key));
+    TEST_ASSERT_NULL(key);
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_iter_remove(&it));
+    TEST_ASSERT_FALSE(hashset_iter_next(&it, &key));
+    TEST_ASSERT_TRUE(hashset_is_empty(set));
+    hashset_deinit(set);
+
+    hashmap_str_t words[] = {{"red", 3}, {"green", 5}, {"blue", 4}};
+    set = hashset_flags(hashmap_str_t, 8, HASHMAP_STRING_KEYS | HASHMAP_SWISS);
+    for(int i = 0; i < 3; i++)
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(set, &words[i]));
+    char probe[] = "green";
+    hashmap_str_t g = {probe, 5};
+    TEST_ASSERT_TRUE(hashset_contains(set, &g));
+    hashset_t cp;
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_copy(&cp, set));
+    TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_remove(set, &g));
+    TEST_ASSERT_TRUE(hashset_contains(cp, &g));
+    hashset_deinit(cp);
+    hashset_deinit(set);
+}
+
+// set algebra
+void test2()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS};
+    for(int f = 0; f < 2; f++) {
+        /* Multiples of 2 below 2000 and of 3 below 300 */
+        hashset_t a = hashset_flags(int, 8, flags[f]);
+        hashset_t b = hashset_flags(int, 8, flags[1 - f]);
+        for(int i = 0; i < 2000; i += 2)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(a, &i));
+        for(int i = 0; i < 300; i += 3)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(b, &i));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(b, NULL));
+
+        hashset_t u, n, d1, d2;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_union(&u, a, b));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_intersection(&n, b, a));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_difference(&d1, a, b));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_difference(&d2, b, a));
+        for(int i = -3; i < 2003; i++) {
+            int in_a = i >= 0 && i < 2000 && i % 2 == 0;
+            int in_b = i >= 0 && i < 300 && i % 3 == 0;
+            TEST_ASSERT_EQUAL_INT(in_a || in_b, hashset_contains(u, &i));
+            TEST_ASSERT_EQUAL_INT(in_a && in_b, hashset_contains(n, &i));
+            TEST_ASSERT_EQUAL_INT(in_a && !in_b, hashset_contains(d1, &i));
+            TEST_ASSERT_EQUAL_INT(in_b && !in_a, hashset_contains(d2, &i));
+        }
+        TEST_ASSERT_EQUAL_INT64(1000 + 50 + 1, hashset_size(u));
+        TEST_ASSERT_EQUAL_INT64(50, hashset_size(n));
+        TEST_ASSERT_EQUAL_INT64(950, hashset_size(d1));
+        TEST_ASSERT_EQUAL_INT64(51, hashset_size(d2));
+        TEST_ASSERT_TRUE(hashset_contains(u, NULL));
+        TEST_ASSERT_FALSE(hashset_contains(n, NULL));
+        TEST_ASSERT_TRUE(hashset_contains(d2, NULL));
+        /* The operands are left untouched */
+        TEST_ASSERT_EQUAL_INT64(1000, hashset_size(a));
+        TEST_ASSERT_EQUAL_INT64(101, hashset_size(b));
+        hashset_deinit(u);
+        hashset_deinit(n);
+        hashset_deinit(d1);
+        hashset_deinit(d2);
+
+        hashset_t e = hashset(int, 8);
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_intersection(&n, a, e));
+        TEST_ASSERT_TRUE(hashset_is_empty(n));
+        hashset_deinit(n);
+        hashset_deinit(e);
+
+        hashset_t l = hashset(int64_t, 8);
+        TEST_ASSERT_EQUAL_INT(ERR_INVALID_OPERATION, hashset_union(&u, a, l));
+        hashset_deinit(l);
+        hashset_deinit(a);
+        hashset_deinit(b);
+    }
+}
+
+// set algebra of a hashset with itself
+void test3()
+{
+    unsigned flags[] = {HASHMAP_CHAINED, HASHMAP_SWISS, HASHMAP_INCREMENTAL};
+    for(int f = 0; f < 3; f++) {
+        hashset_t a = hashset_flags(int, 8, flags[f]);
+        for(int i = 0; i < 3000; i++)
+            TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(a, &i));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(a, NULL));
+
+        hashset_t u, n, d;
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_union(&u, a, a));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_intersection(&n, a, a));
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_difference(&d, a, a));
+        TEST_ASSERT_EQUAL_INT64(3001, hashset_size(u));
+        TEST_ASSERT_EQUAL_INT64(3001, hashset_size(n));
+        TEST_ASSERT_TRUE(hashset_is_empty(d));
+        for(int i = 0; i < 3000; i++) {
+            TEST_ASSERT_TRUE(hashset_contains(u, &i));
+            TEST_ASSERT_TRUE(hashset_contains(n, &i));
+        }
+        TEST_ASSERT_TRUE(hashset_contains(n, NULL));
+        TEST_ASSERT_FALSE(hashset_contains(d, NULL));
+        /* The result is a set of its own */
+        TEST_ASSERT_EQUAL_INT(COMPLETE, hashset_add(d, &(int){1}));
+        TEST_ASSERT_EQUAL_INT64(3001, hashset_size(a));
+        hashset_deinit(u);
+        hashset_deinit(n);
+        hashset_deinit(d);
+        hashset_deinit(a);
+    }
+}
+
+int main()
+{
+    UNITY_BEGIN();
+    RUN_TEST(test1);
+    RUN_TEST(test2);
+    RUN_TEST(test3);
+    return UNITY_END();
+}